@@ -0,0 +1,737 @@
+#pragma once
+#include "LatencyHarness.h"
+#include "WorkloadGenerator.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// ============================================================================
+// Machine-readable benchmark results and regression gating.
+//
+// A benchmark run fills BenchmarkMetrics. print() draws the usual table,
+// BenchmarkReport collects runs and writes them as JSON or CSV (by file
+// extension) so numbers can be tracked across commits.
+//
+// A baseline file is a JSON report plus two optional sections:
+//   "tolerance": {"throughput": 0.10, "latency": 0.25, "latency_floor_ns": 20,
+//                 "rss": 0.10, "rss_floor_bytes": 4194304}
+//   "sla": [{"benchmark": "SLA_P999_Latency", "engine": "*", "max_p999_ns": 100000}, ...]
+// compareResults() matches runs by (benchmark, engine) and flags throughput
+// drops and latency/RSS growth beyond the tolerance; latency changes smaller
+// than latency_floor_ns (RSS: rss_floor_bytes) are noise and never flagged. SLA
+// rules are absolute limits; a rule for a specific engine overrides "*".
+// Several runs with the same key (repeats) are reduced to the best one.
+//
+// The reader accepts the JSON this file writes (and any other plain JSON),
+// not a general-purpose parser: no \u escapes beyond ASCII.
+// ============================================================================
+
+struct BenchmarkMetrics {
+    std::string benchmark;  // ключ сравнения: "<тест>/<нагрузка>/<раскладка>/<команд>"
+    std::string engine_name;
+
+    // Параметры нагрузки (WorkloadConfig)
+    std::string workload = "default";
+    uint64_t seed = 0;
+    size_t num_symbols = 0;
+    double cancel_ratio = 0;
+    double modify_ratio = 0;
+    double aggressive_ratio = 0;
+    double market_ratio = 0;
+    double zipf_exponent = 0;
+
+    size_t total_orders = 0;
+    double avg_latency_ns = 0;
+    double p50_latency_ns = 0;
+    double p95_latency_ns = 0;
+    double p99_latency_ns = 0;
+    double p999_latency_ns = 0;
+    double max_latency_ns = 0;
+    double clock_overhead_ns = 0;  // вычтено из каждого замера
+    double throughput_ops_per_sec = 0;
+
+    // Рост RSS от создания движка до конца прогона, движок еще жив. Память,
+    // освобожденная прошлыми прогонами в том же процессе, может его занизить
+    uint64_t rss_growth_bytes = 0;
+    double cpu_seconds = 0;   // user + system за замеряемые циклы
+    std::vector<std::pair<std::string, double>> counters;  // аппаратные счетчики, если доступны
+
+    void setWorkload(const WorkloadConfig& config) {
+        workload = config.name;
+        seed = config.seed;
+        num_symbols = config.num_symbols;
+        cancel_ratio = config.cancel_ratio;
+        modify_ratio = config.modify_ratio;
+        aggressive_ratio = config.aggressive_ratio;
+        market_ratio = config.market_ratio;
+        zipf_exponent = config.zipf_exponent;
+    }
+
+    void setLatency(const LatencyRecorder& latency) {
+        avg_latency_ns = latency.meanNs();
+        p50_latency_ns = latency.percentileNs(50);
+        p95_latency_ns = latency.percentileNs(95);
+        p99_latency_ns = latency.percentileNs(99);
+        p999_latency_ns = latency.percentileNs(99.9);
+        max_latency_ns = latency.maxNs();
+        clock_overhead_ns = latency.overheadNs();
+    }
+
+    void print(const std::string& test_name) const {
+        std::cout << "\n╔════════════════════════════════════════════════════════════╗\n";
+        std::cout << "║ " << std::left << std::setw(56) << test_name << " ║\n";
+        std::cout << "║ Engine: " << std::left << std::setw(49) << engine_name << " ║\n";
+        std::cout << "╠════════════════════════════════════════════════════════════╣\n";
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "║ Total Orders:    " << std::setw(38) << total_orders << " ║\n";
+        std::cout << "╟────────────────────────────────────────────────────────────╢\n";
+        std::cout << "║ LATENCY (nanoseconds)                                      ║\n";
+        std::cout << "║   Average:       " << std::setw(38) << avg_latency_ns << " ns ║\n";
+        std::cout << "║   P50 (median):  " << std::setw(38) << p50_latency_ns << " ns ║\n";
+        std::cout << "║   P95:           " << std::setw(38) << p95_latency_ns << " ns ║\n";
+        std::cout << "║   P99:           " << std::setw(38) << p99_latency_ns << " ns ║\n";
+        std::cout << "║   P99.9:         " << std::setw(38) << p999_latency_ns << " ns ║\n";
+        std::cout << "║   Max:           " << std::setw(38) << max_latency_ns << " ns ║\n";
+        std::cout << "║   Clock cost:    " << std::setw(38) << clock_overhead_ns << " ns ║\n";
+        std::cout << "╟────────────────────────────────────────────────────────────╢\n";
+        std::cout << "║ THROUGHPUT                                                 ║\n";
+        std::cout << "║   " << std::setw(54) << throughput_ops_per_sec << " ops/sec ║\n";
+        std::cout << "╚════════════════════════════════════════════════════════════╝\n";
+    }
+};
+
+// Текущий RSS процесса
+inline uint64_t residentBytes() {
+    long pages = 0, resident = 0;
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    if (statm == nullptr) return 0;
+    if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    std::fclose(statm);
+    return static_cast<uint64_t>(resident) * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+// Процессорное время процесса, user + system
+inline double cpuSeconds() {
+    struct rusage usage{};
+    ::getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// ============================================================================
+// Minimal JSON value and reader
+// ============================================================================
+
+struct JsonValue {
+    enum class Type { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT };
+
+    Type type = Type::NUL;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    [[nodiscard]] const JsonValue* find(std::string_view key) const {
+        for (const auto& [name, value] : object) {
+            if (name == key) return &value;
+        }
+        return nullptr;
+    }
+
+    [[nodiscard]] double numberOr(std::string_view key, double fallback) const {
+        const JsonValue* value = find(key);
+        return value != nullptr && value->type == Type::NUMBER ? value->number : fallback;
+    }
+
+    [[nodiscard]] std::string stringOr(std::string_view key, std::string fallback) const {
+        const JsonValue* value = find(key);
+        return value != nullptr && value->type == Type::STRING ? value->string : fallback;
+    }
+};
+
+class JsonReader {
+public:
+    // false - синтаксическая ошибка, позиция и причина в error
+    static bool parse(std::string_view text, JsonValue& out, std::string& error) {
+        JsonReader reader(text);
+        if (!reader.value(out, 0)) {
+            error = reader.error_ + " at offset " + std::to_string(reader.pos_);
+            return false;
+        }
+        reader.skipSpace();
+        if (reader.pos_ != text.size()) {
+            error = "trailing characters at offset " + std::to_string(reader.pos_);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr int MAX_DEPTH = 64;
+
+    explicit JsonReader(std::string_view text) : text_(text) {}
+
+    void skipSpace() {
+        while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\n' || text_[pos_] == '\r' ||
+                                       text_[pos_] == '\t')) {
+            ++pos_;
+        }
+    }
+
+    bool fail(const char* message) {
+        error_ = message;
+        return false;
+    }
+
+    bool literal(std::string_view word) {
+        if (text_.substr(pos_, word.size()) != word) return fail("unexpected token");
+        pos_ += word.size();
+        return true;
+    }
+
+    bool value(JsonValue& out, int depth) {
+        if (depth > MAX_DEPTH) return fail("nesting too deep");
+        skipSpace();
+        if (pos_ == text_.size()) return fail("unexpected end");
+        const char c = text_[pos_];
+        if (c == '{') return object(out, depth);
+        if (c == '[') return array(out, depth);
+        if (c == '"') {
+            out.type = JsonValue::Type::STRING;
+            return string(out.string);
+        }
+        if (c == 't' || c == 'f') {
+            out.type = JsonValue::Type::BOOL;
+            out.boolean = c == 't';
+            return literal(out.boolean ? "true" : "false");
+        }
+        if (c == 'n') {
+            out.type = JsonValue::Type::NUL;
+            return literal("null");
+        }
+        out.type = JsonValue::Type::NUMBER;
+        const char* begin = text_.data() + pos_;
+        auto [end, ec] = std::from_chars(begin, text_.data() + text_.size(), out.number);
+        if (ec != std::errc()) return fail("bad number");
+        pos_ += static_cast<size_t>(end - begin);
+        return true;
+    }
+
+    bool string(std::string& out) {
+        ++pos_;  // "
+        while (pos_ < text_.size() && text_[pos_] != '"') {
+            char c = text_[pos_++];
+            if (c == '\\') {
+                if (pos_ == text_.size()) break;
+                const char escaped = text_[pos_++];
+                switch (escaped) {
+                    case 'n': c = '\n'; break;
+                    case 't': c = '\t'; break;
+                    case 'r': c = '\r'; break;
+                    case 'b': c = '\b'; break;
+                    case 'f': c = '\f'; break;
+                    case 'u': {
+                        unsigned code = 0;
+                        if (pos_ + 4 > text_.size() ||
+                            std::from_chars(text_.data() + pos_, text_.data() + pos_ + 4, code, 16).ec != std::errc()) {
+                            return fail("bad \\u escape");
+                        }
+                        pos_ += 4;
+                        c = code < 0x80 ? static_cast<char>(code) : '?';
+                        break;
+                    }
+                    default: c = escaped;  // \" \\ \/
+                }
+            }
+            out.push_back(c);
+        }
+        if (pos_ == text_.size()) return fail("unterminated string");
+        ++pos_;
+        return true;
+    }
+
+    bool array(JsonValue& out, int depth) {
+        out.type = JsonValue::Type::ARRAY;
+        ++pos_;  // [
+        skipSpace();
+        if (pos_ < text_.size() && text_[pos_] == ']') {
+            ++pos_;
+            return true;
+        }
+        while (true) {
+            out.array.emplace_back();
+            if (!value(out.array.back(), depth + 1)) return false;
+            skipSpace();
+            if (pos_ < text_.size() && text_[pos_] == ',') {
+                ++pos_;
+            } else if (pos_ < text_.size() && text_[pos_] == ']') {
+                ++pos_;
+                return true;
+            } else {
+                return fail("expected , or ]");
+            }
+        }
+    }
+
+    bool object(JsonValue& out, int depth) {
+        out.type = JsonValue::Type::OBJECT;
+        ++pos_;  // {
+        skipSpace();
+        if (pos_ < text_.size() && text_[pos_] == '}') {
+            ++pos_;
+            return true;
+        }
+        while (true) {
+            skipSpace();
+            if (pos_ == text_.size() || text_[pos_] != '"') return fail("expected key");
+            std::string key;
+            if (!string(key)) return false;
+            skipSpace();
+            if (pos_ == text_.size() || text_[pos_] != ':') return fail("expected :");
+            ++pos_;
+            out.object.emplace_back(std::move(key), JsonValue{});
+            if (!value(out.object.back().second, depth + 1)) return false;
+            skipSpace();
+            if (pos_ < text_.size() && text_[pos_] == ',') {
+                ++pos_;
+            } else if (pos_ < text_.size() && text_[pos_] == '}') {
+                ++pos_;
+                return true;
+            } else {
+                return fail("expected , or }");
+            }
+        }
+    }
+
+    std::string_view text_;
+    size_t pos_ = 0;
+    std::string error_;
+};
+
+// ============================================================================
+// Report: JSON / CSV writer and reader
+// ============================================================================
+
+class BenchmarkReport {
+public:
+    void add(BenchmarkMetrics metrics) {
+        results_.push_back(std::move(metrics));
+    }
+
+    [[nodiscard]] const std::vector<BenchmarkMetrics>& results() const {
+        return results_;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return results_.empty();
+    }
+
+    // Формат по расширению: .csv - CSV, иначе JSON
+    bool write(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) return false;
+        if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0) {
+            writeCsv(out);
+        } else {
+            writeJson(out);
+        }
+        return static_cast<bool>(out);
+    }
+
+    void writeJson(std::ostream& out) const {
+        out << "{\n  \"schema\": 1,\n  \"results\": [";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const BenchmarkMetrics& r = results_[i];
+            out << (i == 0 ? "\n" : ",\n") << "    {";
+            field(out, "benchmark", r.benchmark, true);
+            field(out, "engine", r.engine_name);
+            field(out, "workload", r.workload);
+            field(out, "seed", static_cast<double>(r.seed));
+            field(out, "symbols", static_cast<double>(r.num_symbols));
+            field(out, "cancel_ratio", r.cancel_ratio);
+            field(out, "modify_ratio", r.modify_ratio);
+            field(out, "aggressive_ratio", r.aggressive_ratio);
+            field(out, "market_ratio", r.market_ratio);
+            field(out, "zipf_exponent", r.zipf_exponent);
+            field(out, "commands", static_cast<double>(r.total_orders));
+            field(out, "throughput_ops_per_sec", r.throughput_ops_per_sec);
+            field(out, "avg_ns", r.avg_latency_ns);
+            field(out, "p50_ns", r.p50_latency_ns);
+            field(out, "p95_ns", r.p95_latency_ns);
+            field(out, "p99_ns", r.p99_latency_ns);
+            field(out, "p999_ns", r.p999_latency_ns);
+            field(out, "max_ns", r.max_latency_ns);
+            field(out, "clock_overhead_ns", r.clock_overhead_ns);
+            field(out, "rss_growth_bytes", static_cast<double>(r.rss_growth_bytes));
+            field(out, "cpu_seconds", r.cpu_seconds);
+            out << ", \"counters\": {";
+            for (size_t c = 0; c < r.counters.size(); ++c) {
+                field(out, r.counters[c].first, r.counters[c].second, c == 0);
+            }
+            out << "}}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    void writeCsv(std::ostream& out) const {
+        out << "benchmark,engine,workload,seed,symbols,cancel_ratio,modify_ratio,aggressive_ratio,market_ratio,"
+               "zipf_exponent,commands,throughput_ops_per_sec,avg_ns,p50_ns,p95_ns,p99_ns,p999_ns,max_ns,"
+               "clock_overhead_ns,rss_growth_bytes,cpu_seconds,counters\n";
+        for (const BenchmarkMetrics& r : results_) {
+            out << csv(r.benchmark) << ',' << csv(r.engine_name) << ',' << csv(r.workload) << ',' << r.seed << ','
+                << r.num_symbols << ',' << number(r.cancel_ratio) << ',' << number(r.modify_ratio) << ','
+                << number(r.aggressive_ratio) << ',' << number(r.market_ratio) << ',' << number(r.zipf_exponent)
+                << ',' << r.total_orders << ',' << number(r.throughput_ops_per_sec) << ','
+                << number(r.avg_latency_ns) << ',' << number(r.p50_latency_ns) << ',' << number(r.p95_latency_ns)
+                << ',' << number(r.p99_latency_ns) << ',' << number(r.p999_latency_ns) << ','
+                << number(r.max_latency_ns) << ',' << number(r.clock_overhead_ns) << ',' << r.rss_growth_bytes << ','
+                << number(r.cpu_seconds) << ',';
+            // name=value через пробел в одной колонке: набор счетчиков зависит от машины
+            std::string counters;
+            for (const auto& [name, value] : r.counters) {
+                if (!counters.empty()) counters += ' ';
+                counters += name + "=" + number(value);
+            }
+            out << csv(counters) << '\n';
+        }
+    }
+
+    // Читает "results" из JSON-отчета или базовой линии
+    static bool readResults(const JsonValue& document, std::vector<BenchmarkMetrics>& out, std::string& error) {
+        const JsonValue* results = document.find("results");
+        if (results == nullptr || results->type != JsonValue::Type::ARRAY) {
+            error = "no \"results\" array";
+            return false;
+        }
+        for (const JsonValue& entry : results->array) {
+            BenchmarkMetrics r;
+            r.benchmark = entry.stringOr("benchmark", "");
+            r.engine_name = entry.stringOr("engine", "");
+            if (r.benchmark.empty() || r.engine_name.empty()) {
+                error = "result without benchmark or engine";
+                return false;
+            }
+            r.workload = entry.stringOr("workload", "default");
+            r.seed = static_cast<uint64_t>(entry.numberOr("seed", 0));
+            r.num_symbols = static_cast<size_t>(entry.numberOr("symbols", 0));
+            r.cancel_ratio = entry.numberOr("cancel_ratio", 0);
+            r.modify_ratio = entry.numberOr("modify_ratio", 0);
+            r.aggressive_ratio = entry.numberOr("aggressive_ratio", 0);
+            r.market_ratio = entry.numberOr("market_ratio", 0);
+            r.zipf_exponent = entry.numberOr("zipf_exponent", 0);
+            r.total_orders = static_cast<size_t>(entry.numberOr("commands", 0));
+            r.throughput_ops_per_sec = entry.numberOr("throughput_ops_per_sec", 0);
+            r.avg_latency_ns = entry.numberOr("avg_ns", 0);
+            r.p50_latency_ns = entry.numberOr("p50_ns", 0);
+            r.p95_latency_ns = entry.numberOr("p95_ns", 0);
+            r.p99_latency_ns = entry.numberOr("p99_ns", 0);
+            r.p999_latency_ns = entry.numberOr("p999_ns", 0);
+            r.max_latency_ns = entry.numberOr("max_ns", 0);
+            r.clock_overhead_ns = entry.numberOr("clock_overhead_ns", 0);
+            r.rss_growth_bytes = static_cast<uint64_t>(entry.numberOr("rss_growth_bytes", 0));
+            r.cpu_seconds = entry.numberOr("cpu_seconds", 0);
+            if (const JsonValue* counters = entry.find("counters")) {
+                for (const auto& [name, value] : counters->object) {
+                    if (value.type == JsonValue::Type::NUMBER) r.counters.emplace_back(name, value.number);
+                }
+            }
+            out.push_back(std::move(r));
+        }
+        return true;
+    }
+
+private:
+    static std::string number(double value) {
+        if (!std::isfinite(value)) return "null";
+        if (value == std::floor(value) && std::fabs(value) < 9e15) return std::to_string(static_cast<int64_t>(value));
+        char buffer[32];
+        auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        return ec == std::errc() ? std::string(buffer, end) : "null";
+    }
+
+    static std::string quoted(std::string_view text) {
+        std::string out = "\"";
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            } else {
+                out += c;
+            }
+        }
+        return out + "\"";
+    }
+
+    static std::string csv(std::string_view text) {
+        if (text.find_first_of(",\"\n") == std::string_view::npos) return std::string(text);
+        std::string out = "\"";
+        for (char c : text) {
+            if (c == '"') out += '"';
+            out += c;
+        }
+        return out + "\"";
+    }
+
+    static void field(std::ostream& out, std::string_view key, std::string_view value, bool first = false) {
+        out << (first ? "" : ", ") << quoted(key) << ": " << quoted(value);
+    }
+
+    static void field(std::ostream& out, std::string_view key, double value, bool first = false) {
+        out << (first ? "" : ", ") << quoted(key) << ": " << number(value);
+    }
+
+    std::vector<BenchmarkMetrics> results_;
+};
+
+// ============================================================================
+// Baseline, SLA rules and comparison
+// ============================================================================
+
+struct RegressionTolerance {
+    double throughput = 0.10;       // допустимое падение, доля
+    double latency = 0.25;          // допустимый рост перцентилей, доля
+    double latency_floor_ns = 20;   // изменения меньше - шум, не регрессия
+    double rss = 0.10;
+    double rss_floor_bytes = 4 << 20;  // рост RSS меньше - шум аллокатора
+};
+
+// 0 - предел не задан
+struct SlaRule {
+    std::string benchmark;   // имя теста, первый сегмент ключа результата
+    std::string engine = "*";
+    double min_throughput_ops_per_sec = 0;
+    double max_p50_ns = 0;
+    double max_p99_ns = 0;
+    double max_p999_ns = 0;
+};
+
+// Первый сегмент ключа "<тест>/<нагрузка>/..."
+inline std::string_view benchmarkTestName(std::string_view benchmark) {
+    return benchmark.substr(0, benchmark.find('/'));
+}
+
+// Пустой список - предел соблюден
+inline std::vector<std::string> slaViolations(const SlaRule& rule, const BenchmarkMetrics& metrics) {
+    std::vector<std::string> violations;
+    auto check_max = [&](const char* label, double limit, double value) {
+        if (limit > 0 && value > limit) {
+            violations.push_back(std::string(label) + " " + std::to_string(value) + " > " + std::to_string(limit));
+        }
+    };
+    if (rule.min_throughput_ops_per_sec > 0 && metrics.throughput_ops_per_sec < rule.min_throughput_ops_per_sec) {
+        violations.push_back("throughput " + std::to_string(metrics.throughput_ops_per_sec) + " < " +
+                             std::to_string(rule.min_throughput_ops_per_sec));
+    }
+    check_max("p50 ns", rule.max_p50_ns, metrics.p50_latency_ns);
+    check_max("p99 ns", rule.max_p99_ns, metrics.p99_latency_ns);
+    check_max("p99.9 ns", rule.max_p999_ns, metrics.p999_latency_ns);
+    return violations;
+}
+
+class BenchmarkBaseline {
+public:
+    bool load(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) return fail("cannot open " + path);
+        std::stringstream text;
+        text << in.rdbuf();
+
+        JsonValue document;
+        std::string error;
+        if (!JsonReader::parse(text.str(), document, error)) return fail(path + ": " + error);
+        if (!BenchmarkReport::readResults(document, results_, error)) return fail(path + ": " + error);
+
+        if (const JsonValue* tolerance = document.find("tolerance")) {
+            tolerance_.throughput = tolerance->numberOr("throughput", tolerance_.throughput);
+            tolerance_.latency = tolerance->numberOr("latency", tolerance_.latency);
+            tolerance_.latency_floor_ns = tolerance->numberOr("latency_floor_ns", tolerance_.latency_floor_ns);
+            tolerance_.rss = tolerance->numberOr("rss", tolerance_.rss);
+            tolerance_.rss_floor_bytes = tolerance->numberOr("rss_floor_bytes", tolerance_.rss_floor_bytes);
+        }
+        if (const JsonValue* sla = document.find("sla")) {
+            for (const JsonValue& entry : sla->array) {
+                SlaRule rule;
+                rule.benchmark = entry.stringOr("benchmark", "");
+                rule.engine = entry.stringOr("engine", "*");
+                rule.min_throughput_ops_per_sec = entry.numberOr("min_throughput_ops_per_sec", 0);
+                rule.max_p50_ns = entry.numberOr("max_p50_ns", 0);
+                rule.max_p99_ns = entry.numberOr("max_p99_ns", 0);
+                rule.max_p999_ns = entry.numberOr("max_p999_ns", 0);
+                if (rule.benchmark.empty()) return fail(path + ": sla rule without benchmark");
+                sla_.push_back(std::move(rule));
+            }
+        }
+        return true;
+    }
+
+    // Правило для движка, иначе общее "*"; nullptr - правила нет
+    [[nodiscard]] const SlaRule* sla(std::string_view benchmark, std::string_view engine) const {
+        const SlaRule* fallback = nullptr;
+        for (const SlaRule& rule : sla_) {
+            if (rule.benchmark != benchmark) continue;
+            if (rule.engine == engine) return &rule;
+            if (rule.engine == "*") fallback = &rule;
+        }
+        return fallback;
+    }
+
+    [[nodiscard]] const std::vector<BenchmarkMetrics>& results() const {
+        return results_;
+    }
+
+    [[nodiscard]] const std::vector<SlaRule>& slaRules() const {
+        return sla_;
+    }
+
+    [[nodiscard]] const RegressionTolerance& tolerance() const {
+        return tolerance_;
+    }
+
+    RegressionTolerance& tolerance() {
+        return tolerance_;
+    }
+
+    [[nodiscard]] const std::string& error() const {
+        return error_;
+    }
+
+private:
+    bool fail(std::string message) {
+        error_ = std::move(message);
+        return false;
+    }
+
+    std::vector<BenchmarkMetrics> results_;
+    std::vector<SlaRule> sla_;
+    RegressionTolerance tolerance_;
+    std::string error_;
+};
+
+struct BenchmarkComparison {
+    enum class Status { OK, IMPROVED, REGRESSION, NEW, MISSING };
+
+    std::string benchmark;
+    std::string engine;
+    Status status = Status::OK;
+    const BenchmarkMetrics* baseline = nullptr;
+    const BenchmarkMetrics* current = nullptr;
+    std::vector<std::string> findings;  // что именно ухудшилось, включая нарушения SLA
+};
+
+inline const char* comparisonStatusName(BenchmarkComparison::Status status) {
+    switch (status) {
+        case BenchmarkComparison::Status::OK: return "ok";
+        case BenchmarkComparison::Status::IMPROVED: return "improved";
+        case BenchmarkComparison::Status::REGRESSION: return "REGRESSION";
+        case BenchmarkComparison::Status::NEW: return "new";
+        case BenchmarkComparison::Status::MISSING: return "missing";
+    }
+    return "?";
+}
+
+// Повторы одного ключа сводятся к лучшему по пропускной способности
+inline std::vector<const BenchmarkMetrics*> bestRuns(const std::vector<BenchmarkMetrics>& results) {
+    std::vector<const BenchmarkMetrics*> best;
+    for (const BenchmarkMetrics& r : results) {
+        auto same = std::find_if(best.begin(), best.end(), [&](const BenchmarkMetrics* b) {
+            return b->benchmark == r.benchmark && b->engine_name == r.engine_name;
+        });
+        if (same == best.end()) {
+            best.push_back(&r);
+        } else if (r.throughput_ops_per_sec > (*same)->throughput_ops_per_sec) {
+            *same = &r;
+        }
+    }
+    return best;
+}
+
+inline std::vector<BenchmarkComparison> compareResults(const BenchmarkBaseline& baseline,
+                                                       const std::vector<BenchmarkMetrics>& current) {
+    const RegressionTolerance& tolerance = baseline.tolerance();
+    const std::vector<const BenchmarkMetrics*> base_runs = bestRuns(baseline.results());
+    std::vector<BenchmarkComparison> comparisons;
+
+    for (const BenchmarkMetrics* now : bestRuns(current)) {
+        BenchmarkComparison comparison;
+        comparison.benchmark = now->benchmark;
+        comparison.engine = now->engine_name;
+        comparison.current = now;
+        auto base = std::find_if(base_runs.begin(), base_runs.end(), [&](const BenchmarkMetrics* b) {
+            return b->benchmark == now->benchmark && b->engine_name == now->engine_name;
+        });
+
+        if (base == base_runs.end()) {
+            comparison.status = BenchmarkComparison::Status::NEW;
+        } else {
+            const BenchmarkMetrics& was = **base;
+            comparison.baseline = &was;
+            bool better = false;
+            if (now->throughput_ops_per_sec < was.throughput_ops_per_sec * (1 - tolerance.throughput)) {
+                comparison.findings.push_back("throughput -" +
+                                              std::to_string(static_cast<int>(100 * (1 - now->throughput_ops_per_sec /
+                                                                                          was.throughput_ops_per_sec))) +
+                                              "%");
+            } else if (now->throughput_ops_per_sec > was.throughput_ops_per_sec * (1 + tolerance.throughput)) {
+                better = true;
+            }
+            auto latency = [&](const char* label, double before, double after) {
+                if (after > before * (1 + tolerance.latency) && after - before > tolerance.latency_floor_ns) {
+                    comparison.findings.push_back(std::string(label) + " " + std::to_string(static_cast<int>(before)) +
+                                                  " -> " + std::to_string(static_cast<int>(after)) + " ns");
+                }
+            };
+            latency("p50", was.p50_latency_ns, now->p50_latency_ns);
+            latency("p99", was.p99_latency_ns, now->p99_latency_ns);
+            latency("p99.9", was.p999_latency_ns, now->p999_latency_ns);
+            const auto rss_before = static_cast<double>(was.rss_growth_bytes);
+            const auto rss_after = static_cast<double>(now->rss_growth_bytes);
+            if (rss_after > rss_before * (1 + tolerance.rss) && rss_after - rss_before > tolerance.rss_floor_bytes) {
+                comparison.findings.push_back("rss growth " + std::to_string(was.rss_growth_bytes >> 20) + " -> " +
+                                              std::to_string(now->rss_growth_bytes >> 20) + " MiB");
+            }
+            comparison.status = !comparison.findings.empty() ? BenchmarkComparison::Status::REGRESSION
+                                : better                      ? BenchmarkComparison::Status::IMPROVED
+                                                              : BenchmarkComparison::Status::OK;
+        }
+
+        if (const SlaRule* rule = baseline.sla(benchmarkTestName(now->benchmark), now->engine_name)) {
+            for (std::string& violation : slaViolations(*rule, *now)) {
+                comparison.findings.push_back("SLA " + violation);
+                comparison.status = BenchmarkComparison::Status::REGRESSION;
+            }
+        }
+        comparisons.push_back(std::move(comparison));
+    }
+
+    for (const BenchmarkMetrics* was : base_runs) {
+        auto present = std::find_if(comparisons.begin(), comparisons.end(), [&](const BenchmarkComparison& c) {
+            return c.benchmark == was->benchmark && c.engine == was->engine_name;
+        });
+        if (present == comparisons.end()) {
+            BenchmarkComparison comparison;
+            comparison.benchmark = was->benchmark;
+            comparison.engine = was->engine_name;
+            comparison.status = BenchmarkComparison::Status::MISSING;
+            comparison.baseline = was;
+            comparisons.push_back(std::move(comparison));
+        }
+    }
+    return comparisons;
+}
@@ -0,0 +1,385 @@
+#include "../EnginImpl/V2/MatchingEngineV2.h"
+#include "../EnginImpl/V2_prealloc/MatchingEngineV2_prealloc.h"
+#include "../EnginImpl/V3/MatchingEngineV3.h"
+#include "../EnginImpl/V4/MatchingEngineV4.h"
+#include "../EnginImpl/V5/MatchingEngineV5.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// Order book primitive microbenchmarks (Google Benchmark).
+//
+// The engine-level benchmarks measure whole order flows; these call one book
+// operation at a time, so a regression shows up as the primitive that got
+// slower:
+//   AddNewLevel        addBuyOrder at a price with no level yet
+//   AddExistingLevel   addBuyOrder at the tail of an existing level
+//   GetBestSell        best ask lookup
+//   RemoveKeepLevel    removeSellOrder of the best level's head, the level
+//                      stays non-empty (no cached-best refresh)
+//   RemoveEmptyLevel   removeSellOrder of the last order of the best level,
+//                      the book finds the next best level `tick_gap` away
+//   SweepLevels        getBestSell + removeSellOrder until `levels` levels of
+//                      `depth` orders are gone, as an aggressive order does
+// Each runs on every book (V2, V2_prealloc, V3, V4, V5), parameterized on
+// level count and queue depth. Mutating benchmarks time a batch of
+// operations by hand and undo it outside the measured time, so every batch
+// sees the same book. Names are <primitive>/<engine>/<args>:
+//   book_microbench --benchmark_filter='RemoveEmptyLevel/.*/levels:1024'
+//   book_microbench --benchmark_out=book.json --benchmark_out_format=json
+// ============================================================================
+
+namespace {
+
+constexpr size_t BATCH = 256;  // операций в одном замере
+constexpr int BASE_PRICE = 100000;
+constexpr uint64_t QUANTITY = 10;
+
+// Единый доступ к книгам: книги V2/V2_prealloc/V3 владеют Order через
+// unique_ptr, V4 хранит указатели в пул, V5 - записи по значению
+template<typename Book>
+class OwningBookAccess {
+public:
+    using Ref = typename Book::OrderRef;
+
+    Ref addBuy(const OrderRecord& order) {
+        return book_.addBuyOrder(std::make_unique<Order>(order));
+    }
+
+    Ref addSell(const OrderRecord& order) {
+        return book_.addSellOrder(std::make_unique<Order>(order));
+    }
+
+    void cancelBuy(Ref ref) {
+        book_.cancelBuyOrder(ref);
+    }
+
+    auto* bestSell() {
+        return book_.getBestSell();
+    }
+
+    void removeSell(int price, uint64_t quantity) {
+        book_.removeSellOrder(price, quantity);
+    }
+
+    // Снятые ордера уже удалены книгой
+    void reclaimSells(int, size_t) {}
+
+private:
+    Book book_;
+};
+
+class PooledBookAccessV4 {
+public:
+    using Ref = OrderBookHashMapV4::OrderRef;
+
+    Ref addBuy(const OrderRecord& order) {
+        return book_.addBuyOrder(pool_.acquire(order));
+    }
+
+    Ref addSell(const OrderRecord& order) {
+        OrderRecord* record = pool_.acquire(order);
+        sells_[order.price].push_back(record);
+        return book_.addSellOrder(record);
+    }
+
+    void cancelBuy(Ref ref) {
+        pool_.release(book_.cancelBuyOrder(ref));
+    }
+
+    OrderRecord* bestSell() {
+        return book_.getBestSell();
+    }
+
+    // Как в движке: книга снимает голову уровня, запись возвращается в пул
+    // отдельно - здесь в reclaimSells, вне замера
+    void removeSell(int price, uint64_t quantity) {
+        book_.removeSellOrder(price, quantity);
+    }
+
+    void reclaimSells(int price, size_t count) {
+        std::deque<OrderRecord*>& queue = sells_[price];
+        for (size_t i = 0; i < count; ++i) {
+            pool_.release(queue.front());
+            queue.pop_front();
+        }
+    }
+
+private:
+    OrderBookHashMapV4 book_;
+    OrderPool<OrderRecord> pool_;
+    std::map<int, std::deque<OrderRecord*>> sells_;  // очереди продаж в порядке снятия
+};
+
+class LadderBookAccessV5 {
+public:
+    using Ref = OrderBookLadderV5::OrderRef;
+
+    Ref addBuy(const OrderRecord& order) {
+        return book_.addBuyOrder(order);
+    }
+
+    Ref addSell(const OrderRecord& order) {
+        return book_.addSellOrder(order);
+    }
+
+    void cancelBuy(Ref ref) {
+        book_.cancelBuyOrder(ref);
+    }
+
+    OrderRecord* bestSell() {
+        return book_.getBestSell();
+    }
+
+    // Снятие в лестнице всегда с лучшего уровня, цена не нужна
+    void removeSell(int, uint64_t quantity) {
+        book_.removeBestSell(quantity);
+    }
+
+    void reclaimSells(int, size_t) {}
+
+private:
+    OrderBookLadderV5 book_;
+};
+
+class OrderIds {
+public:
+    OrderRecord buy(int price) {
+        ++next_id_;
+        return makeOrderRecord(next_id_, 0, Side::BUY, OrderType::LIMIT, price, QUANTITY, next_id_);
+    }
+
+    OrderRecord sell(int price) {
+        ++next_id_;
+        return makeOrderRecord(next_id_, 0, Side::SELL, OrderType::LIMIT, price, QUANTITY, next_id_);
+    }
+
+private:
+    uint64_t next_id_ = 0;
+};
+
+// Время только замеряемой части итерации (UseManualTime): Pause/ResumeTiming
+// сами стоят сотни наносекунд и заметно искажали бы пачку из нескольких операций
+template<typename Fn>
+double timed(Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Покупки: levels уровней по depth ордеров вниз от BASE_PRICE через тик
+template<typename Access>
+void fillBuys(Access& access, OrderIds& ids, size_t levels, size_t depth) {
+    for (size_t level = 0; level < levels; ++level) {
+        for (size_t i = 0; i < depth; ++i) {
+            access.addBuy(ids.buy(BASE_PRICE - static_cast<int>(level)));
+        }
+    }
+}
+
+// Продажи: levels уровней вверх от BASE_PRICE через tick_gap тиков
+template<typename Access>
+void fillSells(Access& access, OrderIds& ids, size_t levels, size_t depth, int tick_gap = 1) {
+    for (size_t level = 0; level < levels; ++level) {
+        for (size_t i = 0; i < depth; ++i) {
+            access.addSell(ids.sell(BASE_PRICE + static_cast<int>(level) * tick_gap));
+        }
+    }
+}
+
+template<typename Access>
+void addNewLevel(benchmark::State& state) {
+    const auto levels = static_cast<size_t>(state.range(0));
+    const auto depth = static_cast<size_t>(state.range(1));
+    Access access;
+    OrderIds ids;
+    fillBuys(access, ids, levels, depth);
+
+    // Новые уровни - сразу за худшей ценой книги
+    const int worst = BASE_PRICE - static_cast<int>(levels);
+    std::vector<OrderRecord> orders;
+    std::vector<typename Access::Ref> refs;
+    refs.reserve(BATCH);
+    for (auto _ : state) {
+        orders.clear();
+        refs.clear();
+        for (size_t i = 0; i < BATCH; ++i) orders.push_back(ids.buy(worst - static_cast<int>(i)));
+
+        state.SetIterationTime(timed([&] {
+            for (const OrderRecord& order : orders) refs.push_back(access.addBuy(order));
+        }));
+
+        for (size_t i = refs.size(); i-- > 0;) access.cancelBuy(refs[i]);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * BATCH));
+}
+
+template<typename Access>
+void addExistingLevel(benchmark::State& state) {
+    const auto levels = static_cast<size_t>(state.range(0));
+    const auto depth = static_cast<size_t>(state.range(1));
+    Access access;
+    OrderIds ids;
+    fillBuys(access, ids, levels, depth);
+
+    std::vector<OrderRecord> orders;
+    std::vector<typename Access::Ref> refs;
+    refs.reserve(BATCH);
+    for (auto _ : state) {
+        orders.clear();
+        refs.clear();
+        for (size_t i = 0; i < BATCH; ++i) orders.push_back(ids.buy(BASE_PRICE - static_cast<int>(i % levels)));
+
+        state.SetIterationTime(timed([&] {
+            for (const OrderRecord& order : orders) refs.push_back(access.addBuy(order));
+        }));
+
+        // С хвоста: очереди уровней возвращаются к исходной длине
+        for (size_t i = refs.size(); i-- > 0;) access.cancelBuy(refs[i]);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * BATCH));
+}
+
+template<typename Access>
+void getBestSell(benchmark::State& state) {
+    Access access;
+    OrderIds ids;
+    fillSells(access, ids, static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(1)));
+
+    for (auto _ : state) {
+        auto* best = access.bestSell();
+        benchmark::DoNotOptimize(best);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+template<typename Access>
+void removeKeepLevel(benchmark::State& state) {
+    const auto levels = static_cast<size_t>(state.range(0));
+    const auto depth = static_cast<size_t>(state.range(1));
+    Access access;
+    OrderIds ids;
+    fillSells(access, ids, levels, depth);
+
+    // Последний ордер лучшего уровня не трогаем
+    const size_t batch = std::min(BATCH, depth - 1);
+    for (auto _ : state) {
+        state.SetIterationTime(timed([&] {
+            for (size_t i = 0; i < batch; ++i) access.removeSell(BASE_PRICE, QUANTITY);
+        }));
+
+        access.reclaimSells(BASE_PRICE, batch);
+        for (size_t i = 0; i < batch; ++i) access.addSell(ids.sell(BASE_PRICE));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch));
+}
+
+template<typename Access>
+void removeEmptyLevel(benchmark::State& state) {
+    const auto levels = static_cast<size_t>(state.range(0));
+    const auto tick_gap = static_cast<int>(state.range(1));
+    Access access;
+    OrderIds ids;
+    fillSells(access, ids, levels, 1, tick_gap);
+
+    // Каждое снятие опустошает лучший уровень, последний уровень остается
+    const size_t batch = std::min(BATCH, levels - 1);
+    for (auto _ : state) {
+        state.SetIterationTime(timed([&] {
+            for (size_t i = 0; i < batch; ++i) {
+                access.removeSell(BASE_PRICE + static_cast<int>(i) * tick_gap, QUANTITY);
+            }
+        }));
+
+        for (size_t i = batch; i-- > 0;) {
+            const int price = BASE_PRICE + static_cast<int>(i) * tick_gap;
+            access.reclaimSells(price, 1);
+            access.addSell(ids.sell(price));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch));
+}
+
+template<typename Access>
+void sweepLevels(benchmark::State& state) {
+    const auto swept = static_cast<size_t>(state.range(0));
+    const auto depth = static_cast<size_t>(state.range(1));
+    constexpr size_t RESERVE_LEVELS = 64;  // уровни за проходом: поиску следующего лучшего есть куда идти
+    Access access;
+    OrderIds ids;
+    fillSells(access, ids, swept + RESERVE_LEVELS, depth);
+
+    const size_t orders = swept * depth;
+    for (auto _ : state) {
+        state.SetIterationTime(timed([&] {
+            for (size_t i = 0; i < orders; ++i) {
+                auto* best = access.bestSell();
+                access.removeSell(best->price, best->quantity);
+            }
+        }));
+
+        for (size_t level = swept; level-- > 0;) {
+            const int price = BASE_PRICE + static_cast<int>(level);
+            access.reclaimSells(price, depth);
+            for (size_t i = 0; i < depth; ++i) access.addSell(ids.sell(price));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * orders));
+    state.counters["levels_per_sec"] = benchmark::Counter(static_cast<double>(state.iterations() * swept),
+                                                          benchmark::Counter::kIsRate);
+}
+
+template<typename Access>
+void registerBook(const std::string& engine) {
+    const std::vector<int64_t> levels = {1, 16, 256, 1024};
+    auto name = [&engine](const char* primitive) {
+        return std::string(primitive) + "/" + engine;
+    };
+
+    benchmark::RegisterBenchmark(name("AddNewLevel").c_str(), addNewLevel<Access>)
+            ->ArgsProduct({levels, {1, 8, 64}})
+            ->ArgNames({"levels", "depth"})
+            ->UseManualTime();
+    benchmark::RegisterBenchmark(name("AddExistingLevel").c_str(), addExistingLevel<Access>)
+            ->ArgsProduct({levels, {1, 8, 64}})
+            ->ArgNames({"levels", "depth"})
+            ->UseManualTime();
+    benchmark::RegisterBenchmark(name("GetBestSell").c_str(), getBestSell<Access>)
+            ->ArgsProduct({levels, {1, 64}})
+            ->ArgNames({"levels", "depth"});
+    benchmark::RegisterBenchmark(name("RemoveKeepLevel").c_str(), removeKeepLevel<Access>)
+            ->ArgsProduct({levels, {8, 64, 512}})
+            ->ArgNames({"levels", "depth"})
+            ->UseManualTime();
+    benchmark::RegisterBenchmark(name("RemoveEmptyLevel").c_str(), removeEmptyLevel<Access>)
+            ->ArgsProduct({{16, 256, 1024}, {1, 8, 64}})
+            ->ArgNames({"levels", "tick_gap"})
+            ->UseManualTime();
+    benchmark::RegisterBenchmark(name("SweepLevels").c_str(), sweepLevels<Access>)
+            ->ArgsProduct({{1, 4, 16, 64}, {1, 8, 64}})
+            ->ArgNames({"levels", "depth"})
+            ->UseManualTime();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    registerBook<OwningBookAccess<OrderBookHashMap>>("V2");
+    registerBook<OwningBookAccess<OrderBookHashMapPrealloc>>("V2_prealloc");
+    registerBook<OwningBookAccess<OrderBookHashMapV3>>("V3");
+    registerBook<PooledBookAccessV4>("V4");
+    registerBook<LadderBookAccessV5>("V5");
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
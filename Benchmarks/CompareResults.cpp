@@ -0,0 +1,174 @@
+#include "BenchmarkResults.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// ============================================================================
+// Benchmark regression gate.
+//
+//   bench_compare <baseline.json> <results.json> [options]
+//     --throughput <fraction>   allowed throughput drop (default: baseline file)
+//     --latency <fraction>      allowed p50/p99/p99.9 growth
+//     --write-baseline <path>   store results.json as the new baseline, keeping
+//                               the tolerance and SLA sections of the old one
+//
+// Results come from `myapp out.json` or BENCHMARK_RESULTS=out.json with the
+// performance tests. Exit status 1 on any regression or SLA violation, so the
+// tool can gate CI; new and missing benchmarks are reported, not failed.
+// Exit status 2 on unreadable input or a bad option, including an option
+// without a value or a fraction that does not parse as a number.
+// ============================================================================
+
+namespace {
+
+// Доля допуска: число целиком, конечное и неотрицательное
+bool parseFraction(const char* text, double& value) {
+    char* end = nullptr;
+    errno = 0;
+    const double parsed = std::strtod(text, &end);
+    if (end == text || *end != '\0' || errno != 0 || !std::isfinite(parsed) || parsed < 0.0) return false;
+    value = parsed;
+    return true;
+}
+
+bool readReport(const std::string& path, std::vector<BenchmarkMetrics>& results) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "cannot open " << path << "\n";
+        return false;
+    }
+    std::stringstream text;
+    text << in.rdbuf();
+    JsonValue document;
+    std::string error;
+    if (!JsonReader::parse(text.str(), document, error) || !BenchmarkReport::readResults(document, results, error)) {
+        std::cerr << path << ": " << error << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool writeBaseline(const std::string& path, const BenchmarkBaseline& old, const std::vector<BenchmarkMetrics>& results) {
+    BenchmarkReport report;
+    for (const BenchmarkMetrics* best : bestRuns(results)) report.add(*best);
+    std::stringstream body;
+    report.writeJson(body);
+
+    // Отчет плюс секции порогов старой базовой линии, перед "results"
+    std::string text = body.str();
+    const RegressionTolerance& t = old.tolerance();
+    std::ostringstream sections;
+    sections << "\"tolerance\": {\"throughput\": " << t.throughput << ", \"latency\": " << t.latency
+             << ", \"latency_floor_ns\": " << t.latency_floor_ns << ", \"rss\": " << t.rss
+             << ", \"rss_floor_bytes\": " << static_cast<uint64_t>(t.rss_floor_bytes) << "},\n  \"sla\": [";
+    for (size_t i = 0; i < old.slaRules().size(); ++i) {
+        const SlaRule& rule = old.slaRules()[i];
+        sections << (i == 0 ? "\n" : ",\n") << "    {\"benchmark\": \"" << rule.benchmark << "\", \"engine\": \""
+                 << rule.engine << "\"";
+        if (rule.min_throughput_ops_per_sec > 0) {
+            sections << ", \"min_throughput_ops_per_sec\": " << rule.min_throughput_ops_per_sec;
+        }
+        if (rule.max_p50_ns > 0) sections << ", \"max_p50_ns\": " << rule.max_p50_ns;
+        if (rule.max_p99_ns > 0) sections << ", \"max_p99_ns\": " << rule.max_p99_ns;
+        if (rule.max_p999_ns > 0) sections << ", \"max_p999_ns\": " << rule.max_p999_ns;
+        sections << "}";
+    }
+    sections << "\n  ],\n  ";
+    text.insert(text.find("\"results\""), sections.str());
+
+    std::ofstream out(path);
+    out << text;
+    return static_cast<bool>(out);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0]
+                  << " <baseline.json> <results.json> [--throughput f] [--latency f] [--write-baseline path]\n";
+        return 2;
+    }
+
+    BenchmarkBaseline baseline;
+    if (!baseline.load(argv[1])) {
+        std::cerr << baseline.error() << "\n";
+        return 2;
+    }
+    std::vector<BenchmarkMetrics> current;
+    if (!readReport(argv[2], current)) return 2;
+
+    std::string new_baseline;
+    for (int i = 3; i < argc; i += 2) {
+        if (i + 1 == argc) {
+            std::cerr << "option " << argv[i] << " needs a value\n";
+            return 2;
+        }
+        bool parsed = true;
+        if (std::strcmp(argv[i], "--throughput") == 0) {
+            parsed = parseFraction(argv[i + 1], baseline.tolerance().throughput);
+        } else if (std::strcmp(argv[i], "--latency") == 0) {
+            parsed = parseFraction(argv[i + 1], baseline.tolerance().latency);
+        } else if (std::strcmp(argv[i], "--write-baseline") == 0) {
+            new_baseline = argv[i + 1];
+        } else {
+            std::cerr << "unknown option " << argv[i] << "\n";
+            return 2;
+        }
+        if (!parsed) {
+            std::cerr << "bad value for " << argv[i] << ": " << argv[i + 1] << "\n";
+            return 2;
+        }
+    }
+
+    const std::vector<BenchmarkComparison> comparisons = compareResults(baseline, current);
+    std::cout << "Tolerance: throughput -" << baseline.tolerance().throughput * 100 << "%, latency +"
+              << baseline.tolerance().latency * 100 << "% (floor " << baseline.tolerance().latency_floor_ns
+              << " ns), rss +" << baseline.tolerance().rss * 100 << "%\n\n"
+              << std::left << std::setw(56) << "Benchmark" << std::setw(28) << "Engine" << std::right
+              << std::setw(14) << "ops/s" << std::setw(10) << "change" << std::setw(10) << "p99 ns"
+              << "  status\n";
+
+    size_t regressions = 0;
+    for (const BenchmarkComparison& c : comparisons) {
+        std::cout << std::left << std::setw(56) << c.benchmark << std::setw(28) << c.engine << std::right
+                  << std::fixed;
+        if (c.current != nullptr) {
+            std::cout << std::setprecision(0) << std::setw(14) << c.current->throughput_ops_per_sec;
+        } else {
+            std::cout << std::setw(14) << "-";
+        }
+        if (c.current != nullptr && c.baseline != nullptr && c.baseline->throughput_ops_per_sec > 0) {
+            const double change = c.current->throughput_ops_per_sec / c.baseline->throughput_ops_per_sec - 1;
+            std::cout << std::showpos << std::setprecision(1) << std::setw(9) << change * 100 << "%"
+                      << std::noshowpos;
+        } else {
+            std::cout << std::setw(10) << "-";
+        }
+        if (c.current != nullptr) {
+            std::cout << std::setprecision(0) << std::setw(10) << c.current->p99_latency_ns;
+        } else {
+            std::cout << std::setw(10) << "-";
+        }
+        std::cout << "  " << comparisonStatusName(c.status);
+        for (const std::string& finding : c.findings) std::cout << "; " << finding;
+        std::cout << "\n";
+        if (c.status == BenchmarkComparison::Status::REGRESSION) ++regressions;
+    }
+    std::cout << "\n" << regressions << " regression(s) in " << comparisons.size() << " benchmark(s)\n";
+
+    if (!new_baseline.empty()) {
+        if (!writeBaseline(new_baseline, baseline, current)) {
+            std::cerr << "cannot write " << new_baseline << "\n";
+            return 2;
+        }
+        std::cout << "Baseline written to " << new_baseline << "\n";
+    }
+    return regressions == 0 ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+#include "../Runtime/MatchingPipeline.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+
+// ============================================================================
+// Write-ahead journal throughput benchmark.
+//
+// The saturated pipeline (producer -> matching thread -> trade ring) runs
+// with the journal off, with the journal but no fdatasync, and with group
+// commit + fdatasync at several group sizes, on a local file. The journal
+// file is checked to hold exactly the appended records (one per order plus
+// the symbol and checkpoint records) and removed after each run.
+// ============================================================================
+
+namespace {
+
+std::vector<OrderRecord> generateOrders(size_t num_orders, SymbolId symbol_id) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> price_dist(9998, 10003);
+    std::uniform_int_distribution<uint64_t> qty_dist(1, 100);
+    std::uniform_int_distribution<int> side_dist(0, 1);
+    std::uniform_int_distribution<int> type_dist(0, 9);
+
+    std::vector<OrderRecord> orders;
+    orders.reserve(num_orders);
+    for (size_t i = 0; i < num_orders; ++i) {
+        Side side = side_dist(rng) == 0 ? Side::BUY : Side::SELL;
+        OrderType type = type_dist(rng) < 9 ? OrderType::LIMIT : OrderType::MARKET;
+        int price = type == OrderType::LIMIT ? price_dist(rng) : 0;
+        orders.push_back(makeOrderRecord(i, symbol_id, side, type, price, qty_dist(rng), 0));
+    }
+    return orders;
+}
+
+struct Scenario {
+    const char* label;
+    bool journal;
+    size_t group_records;
+    size_t sync_every_groups;
+};
+
+void runScenario(const Scenario& scenario, const std::string& path, size_t num_orders) {
+    std::remove(path.c_str());
+
+    MatchingPipeline<>::Config config;
+    if (scenario.journal) {
+        config.journal.path = path;
+        config.journal.group_records = scenario.group_records;
+        config.journal.sync_every_groups = scenario.sync_every_groups;
+    }
+    MatchingPipeline<> pipeline(config);
+    const SymbolId symbol_id = pipeline.registerSymbol("TEST");
+    const std::vector<OrderRecord> orders = generateOrders(num_orders, symbol_id);
+
+    if (!pipeline.start()) {
+        std::cout << std::left << std::setw(30) << scenario.label << "cannot open " << path << "\n";
+        return;
+    }
+
+    std::atomic<bool> producer_done{false};
+    std::thread publisher([&] {
+        SpinBackoff backoff;
+        Trade trade;
+        while (true) {
+            if (pipeline.tryPopTrade(trade)) {
+                backoff.reset();
+            } else if (producer_done.load(std::memory_order_acquire)) {
+                if (!pipeline.tryPopTrade(trade)) break;
+            } else {
+                backoff.pause();
+            }
+        }
+    });
+
+    auto begin = std::chrono::steady_clock::now();
+    SpinBackoff backoff;
+    for (const OrderRecord& order : orders) {
+        while (!pipeline.trySubmit(order)) {
+            backoff.pause();
+        }
+        backoff.reset();
+    }
+    pipeline.stop();  // включая дозапись и последний fdatasync журнала
+    auto end = std::chrono::steady_clock::now();
+    producer_done.store(true, std::memory_order_release);
+    publisher.join();
+
+    const double seconds = std::chrono::duration<double>(end - begin).count();
+    std::cout << std::left << std::setw(30) << scenario.label << std::right << std::fixed
+              << std::setprecision(0) << std::setw(14) << num_orders / seconds;
+
+    const OrderJournal* journal = pipeline.journal();
+    if (journal == nullptr) {
+        std::cout << "\n";
+        return;
+    }
+    struct stat st{};
+    const bool size_ok = ::stat(path.c_str(), &st) == 0 &&
+            static_cast<size_t>(st.st_size) == sizeof(JournalFileHeader) + journal->appendedSequence() * sizeof(JournalRecord);
+    const double groups = static_cast<double>(journal->groupsWritten());
+    std::cout << std::setprecision(1) << std::setw(12) << journal->bytesWritten() / seconds / (1024 * 1024)
+              << std::setw(10) << journal->groupsWritten()
+              << std::setw(10) << journal->syncs()
+              << std::setw(12) << (groups > 0 ? num_orders / groups : 0.0)
+              << "   " << (journal->failed() ? "I/O error" : size_ok ? "ok" : "size mismatch") << "\n";
+    std::remove(path.c_str());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const size_t num_orders = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    const std::string path = argc > 2 ? argv[2] : "journal_bench.wal";
+
+    std::cout << "Orders: " << num_orders << ", journal file: " << path << "\n";
+    std::cout << std::left << std::setw(30) << "Scenario" << std::right << std::setw(14) << "orders/s"
+              << std::setw(12) << "MiB/s" << std::setw(10) << "writes" << std::setw(10) << "syncs"
+              << std::setw(12) << "rec/write" << "\n";
+
+    const Scenario scenarios[] = {
+            {"no journal", false, 0, 0},
+            {"journal, page cache only", true, 1024, 0},
+            {"fdatasync, group 4096", true, 4096, 1},
+            {"fdatasync, group 1024", true, 1024, 1},
+            {"fdatasync, group 64", true, 64, 1},
+            {"fdatasync every 8 x 64", true, 64, 8},
+    };
+    for (const Scenario& scenario : scenarios) {
+        runScenario(scenario, path, num_orders);
+    }
+    return 0;
+}
@@ -0,0 +1,234 @@
+#include "../EnginImpl/V2/MatchingEngineV2.h"
+#include "../EnginImpl/V2_prealloc/MatchingEngineV2_prealloc.h"
+#include "../EnginImpl/V3/MatchingEngineV3.h"
+#include "../EnginImpl/V4/MatchingEngineV4.h"
+#include "../EnginImpl/V5/MatchingEngineV5.h"
+#include "../Runtime/JournalReplay.h"
+#include "../Runtime/MatchingPipeline.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// Journal replay tool.
+//
+//   journal_replay record <path> [orders]  - runs a synthetic session
+//       (limit/market orders, cancels, modifies over 4 symbols) through the
+//       pipeline with the journal on, page cache durability
+//   journal_replay <path> [repeats]        - maps the journal and replays it
+//       into every engine, best of `repeats` runs; each run must reproduce
+//       the trade stream hash of every checkpoint in the file. Then the
+//       restart path: snapshot the books at the middle of the journal,
+//       restore the snapshot and replay only the tail, against full replay
+// ============================================================================
+
+namespace {
+
+int record(const std::string& path, size_t num_orders) {
+    std::remove(path.c_str());
+
+    MatchingPipeline<>::Config config;
+    config.journal.path = path;
+    config.journal.sync_every_groups = 0;
+    MatchingPipeline<> pipeline(config);
+    std::vector<SymbolId> symbols;
+    for (const char* symbol : {"AAPL", "MSFT", "GOOG", "AMZN"}) {
+        symbols.push_back(pipeline.registerSymbol(symbol));
+    }
+    if (!pipeline.start()) {
+        std::cerr << "cannot open journal " << path << "\n";
+        return 1;
+    }
+
+    std::atomic<bool> producer_done{false};
+    std::thread publisher([&] {
+        SpinBackoff backoff;
+        Trade trade;
+        while (true) {
+            if (pipeline.tryPopTrade(trade)) {
+                backoff.reset();
+            } else if (producer_done.load(std::memory_order_acquire)) {
+                if (!pipeline.tryPopTrade(trade)) break;
+            } else {
+                backoff.pause();
+            }
+        }
+    });
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> symbol_dist(0, symbols.size() - 1);
+    std::uniform_int_distribution<int> price_dist(9990, 10010);
+    std::uniform_int_distribution<uint64_t> qty_dist(1, 100);
+    std::uniform_int_distribution<int> side_dist(0, 1);
+    std::uniform_int_distribution<int> action_dist(0, 99);
+
+    // Снятия и изменения адресуют недавние ордера: часть уже исполнена,
+    // такие команды тоже журналируются и должны воспроизвестись
+    SpinBackoff backoff;
+    uint64_t next_id = 1;
+    for (size_t i = 0; i < num_orders; ++i) {
+        const int action = action_dist(rng);
+        const uint64_t recent = next_id > 64 ? next_id - 1 - rng() % 64 : 1;
+        bool pushed;
+        do {
+            if (action < 15) {
+                pushed = pipeline.tryCancel(recent);
+            } else if (action < 20) {
+                pushed = pipeline.tryModify(recent, qty_dist(rng), price_dist(rng));
+            } else {
+                const Side side = side_dist(rng) == 0 ? Side::BUY : Side::SELL;
+                const OrderType type = action < 95 ? OrderType::LIMIT : OrderType::MARKET;
+                const int price = type == OrderType::LIMIT ? price_dist(rng) : 0;
+                pushed = pipeline.trySubmit(makeOrderRecord(next_id, symbols[symbol_dist(rng)], side,
+                                                            type, price, qty_dist(rng), 0));
+            }
+            if (!pushed) backoff.pause();
+        } while (!pushed);
+        if (action >= 20) ++next_id;
+        backoff.reset();
+    }
+    pipeline.stop();
+    producer_done.store(true, std::memory_order_release);
+    publisher.join();
+
+    const OrderJournal* journal = pipeline.journal();
+    if (journal->failed()) {
+        std::cerr << "journal I/O error: " << std::strerror(journal->lastError()) << "\n";
+        return 1;
+    }
+    std::cout << "Recorded " << journal->appendedSequence() << " records (" << num_orders
+              << " commands) to " << path << "\n";
+    return 0;
+}
+
+template<typename Engine>
+bool replayInto(const char* label, const JournalReader& reader, int repeats) {
+    ReplayResult best;
+    for (int run = 0; run < repeats; ++run) {
+        ReplayEngineT<Engine> engine;
+        ReplayResult result = replayJournal(reader.records(), engine);
+        if (!result.verified()) {
+            std::cout << std::left << std::setw(20) << label << "MISMATCH at record "
+                      << result.mismatch_sequence << "\n";
+            return false;
+        }
+        if (run == 0 || result.seconds < best.seconds) best = result;
+    }
+
+    const double records = static_cast<double>(reader.records().size());
+    std::cout << std::left << std::setw(20) << label << std::right << std::fixed << std::setprecision(0)
+              << std::setw(14) << records / best.seconds
+              << std::setprecision(1) << std::setw(10) << reader.records().size_bytes() / best.seconds / (1024 * 1024)
+              << std::setw(12) << best.trades
+              << std::setw(8) << best.checkpoints << "   verified\n";
+    return true;
+}
+
+template<typename Engine>
+bool restartInto(const char* label, const JournalReader& reader, int repeats) {
+    using Clock = std::chrono::steady_clock;
+    const std::span<const JournalRecord> records = reader.records();
+    const uint64_t middle = records.size() / 2;
+
+    BookSnapshotWriter writer;
+    {
+        ReplayEngineT<Engine> engine;
+        replayJournal(records.first(middle), engine);
+        if (!saveReplaySnapshot(engine, middle, writer)) return false;
+    }
+    const std::span<const SnapshotBlock> snapshot = writer.finish();
+
+    double best_restore = 0;
+    double best_tail = 0;
+    uint64_t orders = 0;
+    for (int run = 0; run < repeats; ++run) {
+        auto begin = Clock::now();
+        BookSnapshotReader snapshot_reader;
+        snapshot_reader.open(snapshot);
+        ReplayEngineT<Engine> engine(HashingTradeSink(snapshot_reader.tradeStreamHash()));
+        if (!engine.restoreSnapshot(snapshot_reader)) {
+            std::cout << std::left << std::setw(20) << label << "restore failed: " << snapshot_reader.error() << "\n";
+            return false;
+        }
+        const double restore = std::chrono::duration<double>(Clock::now() - begin).count();
+        ReplayResult tail = replayJournal(journalTail(records, snapshot_reader.header().journal_sequence), engine);
+        if (!tail.verified()) {
+            std::cout << std::left << std::setw(20) << label << "MISMATCH at record " << tail.mismatch_sequence << "\n";
+            return false;
+        }
+        if (run == 0 || restore + tail.seconds < best_restore + best_tail) {
+            best_restore = restore;
+            best_tail = tail.seconds;
+        }
+        orders = snapshot_reader.header().order_count;
+    }
+
+    ReplayResult full;
+    for (int run = 0; run < repeats; ++run) {
+        ReplayEngineT<Engine> engine;
+        ReplayResult result = replayJournal(records, engine);
+        if (run == 0 || result.seconds < full.seconds) full = result;
+    }
+
+    std::cout << std::left << std::setw(20) << label << std::right << std::fixed
+              << std::setw(10) << orders
+              << std::setprecision(1) << std::setw(10) << snapshot.size_bytes() / (1024.0 * 1024)
+              << std::setprecision(2) << std::setw(12) << best_restore * 1e3
+              << std::setw(12) << best_tail * 1e3
+              << std::setw(12) << full.seconds * 1e3
+              << std::setprecision(1) << std::setw(12) << orders / best_restore / 1e6 << "\n";
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 2 && std::strcmp(argv[1], "record") == 0) {
+        return record(argv[2], argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1'000'000);
+    }
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " record <path> [orders]\n"
+                  << "       " << argv[0] << " <path> [repeats]\n";
+        return 2;
+    }
+
+    JournalReader reader;
+    if (!reader.open(argv[1])) {
+        std::cerr << reader.error() << "\n";
+        return 1;
+    }
+    const int repeats = argc > 2 ? std::max(1, std::atoi(argv[2])) : 3;
+    std::cout << "Journal " << argv[1] << ": " << reader.records().size() << " records";
+    if (reader.discardedBytes() != 0) {
+        std::cout << ", " << reader.discardedBytes() << " bytes of torn tail ignored";
+    }
+    std::cout << "\n" << std::left << std::setw(20) << "Engine" << std::right << std::setw(14) << "records/s"
+              << std::setw(10) << "MiB/s" << std::setw(12) << "trades" << std::setw(8) << "checks" << "\n";
+
+    bool ok = true;
+    ok &= replayInto<MatchingEngineV2>("V2", reader, repeats);
+    ok &= replayInto<MatchingEngineV2_prealloc>("V2_prealloc", reader, repeats);
+    ok &= replayInto<MatchingEngineV3>("V3", reader, repeats);
+    ok &= replayInto<MatchingEngineV4>("V4", reader, repeats);
+    ok &= replayInto<MatchingEngineV5>("V5", reader, repeats);
+
+    std::cout << "\nRestart: snapshot at record " << reader.records().size() / 2 << " + journal tail\n"
+              << std::left << std::setw(20) << "Engine" << std::right << std::setw(10) << "orders"
+              << std::setw(10) << "MiB" << std::setw(12) << "restore ms" << std::setw(12) << "tail ms"
+              << std::setw(12) << "full ms" << std::setw(12) << "M orders/s" << "\n";
+    ok &= restartInto<MatchingEngineV2>("V2", reader, repeats);
+    ok &= restartInto<MatchingEngineV2_prealloc>("V2_prealloc", reader, repeats);
+    ok &= restartInto<MatchingEngineV3>("V3", reader, repeats);
+    ok &= restartInto<MatchingEngineV4>("V4", reader, repeats);
+    ok &= restartInto<MatchingEngineV5>("V5", reader, repeats);
+    return ok ? 0 : 1;
+}
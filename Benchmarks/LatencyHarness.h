@@ -0,0 +1,250 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// ============================================================================
+// Latency harness for per-operation timing.
+//
+// TscClock reads the time stamp counter with fences around it, so the read
+// can not drift into or out of the measured code:
+//   start(): lfence; rdtsc; lfence   - earlier instructions retire first,
+//                                      the measured code starts after the read
+//   stop():  rdtscp; lfence          - waits for the measured code, later
+//                                      instructions wait for the read
+// A start/stop pair costs a few tens of cycles against ~50 ns for two
+// high_resolution_clock::now() calls. The TSC is assumed invariant (constant
+// rate, synchronized across cores), true for x86 CPUs of the last decade.
+// Elsewhere the clock falls back to steady_clock nanoseconds.
+//
+// tscCalibration() measures, once per process, the tick rate against
+// steady_clock and the median cost of an empty start/stop pair. LatencyRecorder
+// subtracts that overhead from every sample and keeps samples in a
+// LatencyHistogram: fixed size, no per-sample storage and no sort, so 50M
+// samples take the same 18 KB as ten.
+// ============================================================================
+
+struct TscClock {
+    static uint64_t start() {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_lfence();
+        const uint64_t ticks = __rdtsc();
+        _mm_lfence();
+        return ticks;
+#else
+        return steadyNs();
+#endif
+    }
+
+    static uint64_t stop() {
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned int aux;
+        const uint64_t ticks = __rdtscp(&aux);
+        _mm_lfence();
+        return ticks;
+#else
+        return steadyNs();
+#endif
+    }
+
+private:
+    [[maybe_unused]] static uint64_t steadyNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+    }
+};
+
+struct TscCalibration {
+    double ticks_per_ns = 1.0;
+    uint64_t overhead_ticks = 0;  // медианная стоимость пустой пары start/stop
+
+    [[nodiscard]] double toNs(double ticks) const {
+        return ticks / ticks_per_ns;
+    }
+
+    static TscCalibration measure(std::chrono::milliseconds window = std::chrono::milliseconds(50)) {
+        using Clock = std::chrono::steady_clock;
+        TscCalibration calibration;
+
+        // Частота: тики за окно, отмеренное steady_clock, в активном ожидании
+        const auto wall_begin = Clock::now();
+        const uint64_t tsc_begin = TscClock::start();
+        Clock::time_point wall_end;
+        do {
+            wall_end = Clock::now();
+        } while (wall_end - wall_begin < window);
+        const uint64_t tsc_end = TscClock::stop();
+        const double elapsed_ns = std::chrono::duration<double, std::nano>(wall_end - wall_begin).count();
+        calibration.ticks_per_ns = static_cast<double>(tsc_end - tsc_begin) / elapsed_ns;
+
+        // Накладные расходы: медиана пустых замеров, минимум занижает типичный случай
+        std::vector<uint64_t> empty(4096);
+        for (uint64_t& sample : empty) {
+            const uint64_t begin = TscClock::start();
+            sample = TscClock::stop() - begin;
+        }
+        std::nth_element(empty.begin(), empty.begin() + empty.size() / 2, empty.end());
+        calibration.overhead_ticks = empty[empty.size() / 2];
+        return calibration;
+    }
+};
+
+// Калибруется при первом вызове, ~50 мс
+inline const TscCalibration& tscCalibration() {
+    static const TscCalibration calibration = TscCalibration::measure();
+    return calibration;
+}
+
+// ============================================================================
+// Log-linear histogram (HdrHistogram layout with 7 significant bits).
+//
+// Values below 128 get a bucket each. Above that every power of two is split
+// into 64 equal buckets, so a bucket is at most 1/64 of its value wide and a
+// reported percentile is within 0.8% of the true sample. Values up to 2^40
+// (minutes in TSC ticks) are distinguished, larger ones land in the last
+// bucket; min, max and mean are exact.
+// ============================================================================
+
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 7;
+    static constexpr uint64_t SUB_BUCKET_COUNT = uint64_t{1} << SUB_BUCKET_BITS;
+    static constexpr uint64_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+    static constexpr unsigned MAX_VALUE_BITS = 40;
+    static constexpr size_t BUCKET_COUNT = SUB_BUCKET_COUNT + (MAX_VALUE_BITS - SUB_BUCKET_BITS) * SUB_BUCKET_HALF;
+
+    void record(uint64_t value) {
+        ++buckets_[bucketIndex(value)];
+        ++count_;
+        sum_ += value;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) buckets_[i] += other.buckets_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void reset() {
+        *this = LatencyHistogram();
+    }
+
+    [[nodiscard]] uint64_t count() const {
+        return count_;
+    }
+
+    [[nodiscard]] uint64_t min() const {
+        return count_ == 0 ? 0 : min_;
+    }
+
+    [[nodiscard]] uint64_t max() const {
+        return max_;
+    }
+
+    [[nodiscard]] double mean() const {
+        return count_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_);
+    }
+
+    // percentile в 0..100; середина корзины, в которую попал ранг
+    [[nodiscard]] uint64_t valueAtPercentile(double percentile) const {
+        if (count_ == 0) return 0;
+        const double clamped = std::clamp(percentile, 0.0, 100.0);
+        // Ранг как у индексации отсортированного массива: sorted[count * p / 100]
+        const uint64_t rank = std::min<uint64_t>(static_cast<uint64_t>(count_ * clamped / 100.0), count_ - 1);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += buckets_[i];
+            if (seen > rank) {
+                const uint64_t middle = bucketLowest(i) + (bucketWidth(i) - 1) / 2;
+                return std::clamp(middle, min_, max_);
+            }
+        }
+        return max_;
+    }
+
+    static size_t bucketIndex(uint64_t value) {
+        if (value < SUB_BUCKET_COUNT) return static_cast<size_t>(value);
+        const unsigned shift = std::min<unsigned>(std::bit_width(value) - SUB_BUCKET_BITS, MAX_VALUE_BITS - SUB_BUCKET_BITS);
+        // value >> shift в [64, 128), если значение не обрезано сверху
+        const uint64_t sub = std::min(value >> shift, SUB_BUCKET_COUNT - 1);
+        return static_cast<size_t>(SUB_BUCKET_COUNT + (shift - 1) * SUB_BUCKET_HALF + (sub - SUB_BUCKET_HALF));
+    }
+
+    static uint64_t bucketLowest(size_t index) {
+        if (index < SUB_BUCKET_COUNT) return index;
+        const uint64_t group = (index - SUB_BUCKET_COUNT) / SUB_BUCKET_HALF;
+        const uint64_t sub = SUB_BUCKET_HALF + (index - SUB_BUCKET_COUNT) % SUB_BUCKET_HALF;
+        return sub << (group + 1);
+    }
+
+    static uint64_t bucketWidth(size_t index) {
+        if (index < SUB_BUCKET_COUNT) return 1;
+        return uint64_t{1} << ((index - SUB_BUCKET_COUNT) / SUB_BUCKET_HALF + 1);
+    }
+
+private:
+    std::array<uint64_t, BUCKET_COUNT> buckets_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+};
+
+// Замеры в тиках TSC за вычетом накладных расходов, отчет в наносекундах
+class LatencyRecorder {
+public:
+    explicit LatencyRecorder(const TscCalibration& calibration = tscCalibration())
+        : calibration_(calibration) {}
+
+    template<typename Operation>
+    void measure(Operation&& operation) {
+        const uint64_t begin = TscClock::start();
+        operation();
+        const uint64_t end = TscClock::stop();
+        recordTicks(end - begin);
+    }
+
+    // Интервал, замеренный парой TscClock::start()/stop()
+    void recordTicks(uint64_t elapsed) {
+        histogram_.record(elapsed > calibration_.overhead_ticks ? elapsed - calibration_.overhead_ticks : 0);
+    }
+
+    [[nodiscard]] uint64_t count() const {
+        return histogram_.count();
+    }
+
+    [[nodiscard]] double percentileNs(double percentile) const {
+        return calibration_.toNs(static_cast<double>(histogram_.valueAtPercentile(percentile)));
+    }
+
+    [[nodiscard]] double meanNs() const {
+        return calibration_.toNs(histogram_.mean());
+    }
+
+    [[nodiscard]] double maxNs() const {
+        return calibration_.toNs(static_cast<double>(histogram_.max()));
+    }
+
+    [[nodiscard]] double overheadNs() const {
+        return calibration_.toNs(static_cast<double>(calibration_.overhead_ticks));
+    }
+
+    [[nodiscard]] const LatencyHistogram& histogram() const {
+        return histogram_;
+    }
+
+private:
+    TscCalibration calibration_;
+    LatencyHistogram histogram_;
+};
@@ -0,0 +1,194 @@
+#include "../EngineConcept/MatchingEngineConcept.h"
+#include "../EnginImpl/V2/MatchingEngineV2.h"
+#include "../EnginImpl/V2_prealloc/MatchingEngineV2_prealloc.h"
+#include "../EnginImpl/V3/MatchingEngineV3.h"
+#include "../EnginImpl/V4/MatchingEngineV4.h"
+#include "../EnginImpl/V5/MatchingEngineV5.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// ============================================================================
+// Memory footprint benchmark.
+//
+// Resident set size of the process before and after feeding N orders spread
+// over a wide price range. Every engine runs in its own forked child, so
+// memory freed by a previous engine cannot hide the next one's growth.
+//   wide:  N resting orders, each side spread over `range` ticks
+//   drift: the mid price random-walks over the same range, resting depth is
+//          capped by cancelling the oldest orders - touched ticks grow, the
+//          live book does not
+//   many symbols: thousands of books with a few orders each - the fixed
+//          cost of a book. This one is a check, not just a number: an engine
+//          above the per-symbol budget makes the benchmark exit with 1
+// ============================================================================
+
+namespace {
+
+// Потолок постоянной стоимости книги (без учета самих ордеров)
+constexpr size_t PER_SYMBOL_BUDGET = 16 * 1024;
+
+size_t residentBytes() {
+    long pages = 0, resident = 0;
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    if (statm == nullptr) return 0;
+    if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    std::fclose(statm);
+    return static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+struct Workload {
+    size_t orders;
+    int range;         // ширина ценового диапазона в тиках
+    size_t max_depth;  // 0 - без снятий
+};
+
+template<MatchingEngineConcept Engine>
+void runFootprint(const char* label, const Workload& workload) {
+    const size_t rss_before = residentBytes();
+    {
+        Engine engine;
+        const SymbolId symbol_id = engine.registerSymbol("TEST");
+
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> offset_dist(1, workload.range / 2);
+        std::uniform_int_distribution<int> near_dist(1, 32);  // котировки у блуждающей середины
+        std::uniform_int_distribution<uint64_t> qty_dist(1, 100);
+        std::uniform_int_distribution<int> step_dist(-2, 2);
+
+        int mid = 100000;
+        std::vector<uint64_t> resting;
+        resting.reserve(workload.max_depth);
+        size_t oldest = 0;
+
+        for (size_t i = 0; i < workload.orders; ++i) {
+            if (workload.max_depth != 0) {
+                // Случайное блуждание в пределах диапазона
+                mid = std::clamp(mid + step_dist(rng), 100000 - workload.range, 100000 + workload.range);
+            }
+            // Покупки ниже середины, продажи выше - спред не пересекается
+            Side side = i % 2 == 0 ? Side::BUY : Side::SELL;
+            int offset = workload.max_depth != 0 ? near_dist(rng) : offset_dist(rng);
+            int price = side == Side::BUY ? mid - offset : mid + offset;
+            engine.submitOrder(makeOrderRecord(i, symbol_id, side, OrderType::LIMIT, price, qty_dist(rng), 0));
+
+            if (workload.max_depth != 0) {
+                if (resting.size() < workload.max_depth) {
+                    resting.push_back(i);
+                } else {
+                    engine.cancelOrder(resting[oldest]);
+                    resting[oldest] = i;
+                    oldest = (oldest + 1) % workload.max_depth;
+                }
+            }
+        }
+
+        const size_t rss_after = residentBytes();
+        const size_t delta = rss_after - std::min(rss_after, rss_before);
+
+        std::cout << std::left << std::setw(28) << label
+                  << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << delta / (1024.0 * 1024.0) << " MiB"
+                  << std::setw(12) << delta / workload.orders << " B/order\n";
+    }
+}
+
+// Каждый движок - в отдельном процессе: RSS родителя не растет
+template<MatchingEngineConcept Engine>
+void runIsolated(const char* label, const Workload& workload) {
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+        runFootprint<Engine>(label, workload);
+        std::cout.flush();
+        std::_Exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cout << std::left << std::setw(28) << label << "  failed (out of memory?)\n";
+    }
+}
+
+// Постоянная стоимость книги: по три ордера и одному опустевшему уровню на символ
+template<MatchingEngineConcept Engine>
+bool runPerSymbolFootprint(const char* label, size_t symbols, size_t budget_per_symbol) {
+    const size_t rss_before = residentBytes();
+    Engine engine;
+    uint64_t id = 0;
+    for (size_t i = 0; i < symbols; ++i) {
+        const SymbolId symbol_id = engine.registerSymbol("S" + std::to_string(i));
+        engine.submitOrder(makeOrderRecord(++id, symbol_id, Side::BUY, OrderType::LIMIT, 9999, 10, 0));
+        engine.submitOrder(makeOrderRecord(++id, symbol_id, Side::SELL, OrderType::LIMIT, 10001, 10, 0));
+        engine.submitOrder(makeOrderRecord(++id, symbol_id, Side::SELL, OrderType::LIMIT, 10002, 10, 0));
+        engine.cancelOrder(id);
+    }
+
+    const size_t rss_after = residentBytes();
+    const size_t per_symbol = (rss_after - std::min(rss_after, rss_before)) / symbols;
+    const bool within_budget = per_symbol <= budget_per_symbol;
+    std::cout << std::left << std::setw(28) << label
+              << std::right << std::setw(12) << per_symbol << " B/symbol"
+              << (within_budget ? "" : "   over budget") << "\n";
+    return within_budget;
+}
+
+// Код выхода ребенка 1 - движок вышел за бюджет
+template<MatchingEngineConcept Engine>
+bool runPerSymbolIsolated(const char* label, size_t symbols, size_t budget_per_symbol) {
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+        const bool ok = runPerSymbolFootprint<Engine>(label, symbols, budget_per_symbol);
+        std::cout.flush();
+        std::_Exit(ok ? 0 : 1);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+bool runManySymbols(size_t symbols, size_t budget_per_symbol) {
+    std::cout << "\n=== MANY SYMBOLS: " << symbols << " books, budget "
+              << budget_per_symbol << " B/symbol ===\n";
+    bool ok = true;
+    ok &= runPerSymbolIsolated<MatchingEngineV2>("V2", symbols, budget_per_symbol);
+    ok &= runPerSymbolIsolated<MatchingEngineV2_prealloc>("V2_prealloc", symbols, budget_per_symbol);
+    ok &= runPerSymbolIsolated<MatchingEngineV3>("V3", symbols, budget_per_symbol);
+    ok &= runPerSymbolIsolated<MatchingEngineV4>("V4", symbols, budget_per_symbol);
+    ok &= runPerSymbolIsolated<MatchingEngineV5>("V5", symbols, budget_per_symbol);
+    return ok;
+}
+
+void runAll(const std::string& title, const Workload& workload) {
+    std::cout << "\n=== " << title << ": " << workload.orders << " orders over "
+              << workload.range << " ticks";
+    if (workload.max_depth != 0) std::cout << ", depth capped at " << workload.max_depth;
+    std::cout << " ===\n";
+    std::cout << std::left << std::setw(28) << "Engine" << std::right << std::setw(16) << "RSS delta"
+              << std::setw(20) << "per order\n";
+
+    runIsolated<MatchingEngineV2>("V2", workload);
+    runIsolated<MatchingEngineV2_prealloc>("V2_prealloc", workload);
+    runIsolated<MatchingEngineV3>("V3", workload);
+    runIsolated<MatchingEngineV4>("V4", workload);
+    runIsolated<MatchingEngineV5>("V5", workload);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const size_t num_orders = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    const int range = argc > 2 ? std::atoi(argv[2]) : 20'000;
+
+    runAll("WIDE RESTING BOOK", {num_orders, range, 0});
+    runAll("DRIFTING MID", {num_orders, range, 10'000});
+    return runManySymbols(5'000, PER_SYMBOL_BUDGET) ? 0 : 1;
+}
@@ -0,0 +1,260 @@
+#pragma once
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// ============================================================================
+// Hardware performance counters for benchmark phases (Linux perf_event_open).
+//
+// PerfCounters opens one counter per event for the calling thread (user
+// space only), so open it on the thread that runs the engine. start()/stop()
+// bracket a phase and return its counts; PerfPhases sums readings under a
+// phase name and reports them per operation, e.g. LLC misses per order for
+// V3's deque levels against V4's ring buffers.
+//
+// Every event is optional. In a VM without a PMU, with perf_event_paranoid
+// too strict, or off Linux the hardware events fail to open and are reported
+// as absent; the page fault count is a software event and usually survives.
+// If nothing opens, available() is false, start()/stop() do nothing and the
+// benchmark runs as before. Counters are not grouped: each one may be
+// multiplexed on its own, and its count is scaled by enabled/running time.
+// Reading costs a syscall per counter, so phases are chunks of thousands of
+// operations, never a single call.
+// ============================================================================
+
+struct PerfReading {
+    enum Event { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, PAGE_FAULTS, EVENT_COUNT };
+
+    std::array<double, EVENT_COUNT> values{};
+    std::array<bool, EVENT_COUNT> present{};
+
+    static const char* name(Event event) {
+        switch (event) {
+            case CYCLES: return "cycles";
+            case INSTRUCTIONS: return "instructions";
+            case L1D_MISSES: return "l1d_misses";
+            case LLC_MISSES: return "llc_misses";
+            case BRANCH_MISSES: return "branch_misses";
+            case PAGE_FAULTS: return "page_faults";
+            case EVENT_COUNT: break;
+        }
+        return "?";
+    }
+
+    [[nodiscard]] bool has(Event event) const {
+        return present[event];
+    }
+
+    [[nodiscard]] bool any() const {
+        for (bool p : present) {
+            if (p) return true;
+        }
+        return false;
+    }
+
+    PerfReading& operator+=(const PerfReading& other) {
+        for (size_t i = 0; i < EVENT_COUNT; ++i) {
+            values[i] += other.values[i];
+            present[i] = present[i] || other.present[i];
+        }
+        return *this;
+    }
+
+    // Счетчики на операцию и IPC для отчета (BenchmarkMetrics::counters)
+    [[nodiscard]] std::vector<std::pair<std::string, double>> perOperation(uint64_t operations) const {
+        std::vector<std::pair<std::string, double>> out;
+        if (operations == 0) return out;
+        for (size_t i = 0; i < EVENT_COUNT; ++i) {
+            if (present[i]) {
+                out.emplace_back(std::string(name(static_cast<Event>(i))) + "_per_op",
+                                 values[i] / static_cast<double>(operations));
+            }
+        }
+        if (present[CYCLES] && present[INSTRUCTIONS] && values[CYCLES] > 0) {
+            out.emplace_back("ipc", values[INSTRUCTIONS] / values[CYCLES]);
+        }
+        return out;
+    }
+};
+
+class PerfCounters {
+public:
+    PerfCounters() {
+        fds_.fill(-1);
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    ~PerfCounters() {
+        close();
+    }
+
+    // Открывает что получится; false - ни одного счетчика, причина в error()
+    bool open() {
+        close();
+#if defined(__linux__)
+        struct EventSpec {
+            uint32_t type;
+            uint64_t config;
+        };
+        constexpr uint64_t L1D_READ_MISS = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        const std::array<EventSpec, PerfReading::EVENT_COUNT> specs = {{
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+                {PERF_TYPE_HW_CACHE, L1D_READ_MISS},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},  // LLC
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+                {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+        }};
+
+        int first_errno = 0;
+        for (size_t i = 0; i < specs.size(); ++i) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = specs[i].type;
+            attr.config = specs[i].config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;  // не требует paranoid < 2
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            // pid 0, cpu -1: вызывающий поток на любом ядре
+            const long fd = ::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fd >= 0) {
+                fds_[i] = static_cast<int>(fd);
+            } else if (first_errno == 0) {
+                first_errno = errno;
+            }
+        }
+        if (!available()) {
+            error_ = std::string("perf_event_open: ") + std::strerror(first_errno);
+            return false;
+        }
+        if (first_errno != 0) {
+            error_ = std::string("some counters unavailable: ") + std::strerror(first_errno);
+        }
+        return true;
+#else
+        error_ = "perf_event_open is Linux-only";
+        return false;
+#endif
+    }
+
+    void close() {
+#if defined(__linux__)
+        for (int& fd : fds_) {
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+        }
+#endif
+        error_.clear();
+    }
+
+    [[nodiscard]] bool available() const {
+        for (int fd : fds_) {
+            if (fd >= 0) return true;
+        }
+        return false;
+    }
+
+    [[nodiscard]] bool has(PerfReading::Event event) const {
+        return fds_[event] >= 0;
+    }
+
+    // Причина, по которой счетчики (или часть из них) не открылись
+    [[nodiscard]] const std::string& error() const {
+        return error_;
+    }
+
+    void start() {
+#if defined(__linux__)
+        for (int fd : fds_) {
+            if (fd < 0) continue;
+            ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    PerfReading stop() {
+        PerfReading reading;
+#if defined(__linux__)
+        for (int fd : fds_) {
+            if (fd >= 0) ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+        for (size_t i = 0; i < fds_.size(); ++i) {
+            if (fds_[i] < 0) continue;
+            uint64_t data[3] = {};  // value, time_enabled, time_running
+            if (::read(fds_[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) continue;
+            reading.present[i] = true;
+            // Счетчик делил PMU с другими: экстраполяция на все время фазы
+            reading.values[i] = data[2] == 0 ? 0.0
+                                             : static_cast<double>(data[0]) * static_cast<double>(data[1]) /
+                                                       static_cast<double>(data[2]);
+        }
+#endif
+        return reading;
+    }
+
+private:
+    std::array<int, PerfReading::EVENT_COUNT> fds_{};
+    std::string error_;
+};
+
+// Суммы счетчиков и число операций по именованным фазам бенчмарка
+class PerfPhases {
+public:
+    struct Phase {
+        std::string name;
+        PerfReading reading;
+        uint64_t operations = 0;
+    };
+
+    void add(const std::string& name, const PerfReading& reading, uint64_t operations) {
+        for (Phase& phase : phases_) {
+            if (phase.name == name) {
+                phase.reading += reading;
+                phase.operations += operations;
+                return;
+            }
+        }
+        phases_.push_back({name, reading, operations});
+    }
+
+    [[nodiscard]] const std::vector<Phase>& phases() const {
+        return phases_;
+    }
+
+    // Все фазы вместе
+    [[nodiscard]] Phase total() const {
+        Phase sum{"total", {}, 0};
+        for (const Phase& phase : phases_) {
+            sum.reading += phase.reading;
+            sum.operations += phase.operations;
+        }
+        return sum;
+    }
+
+private:
+    std::vector<Phase> phases_;
+};
+
+// Счетчики вызывающего потока, открываются при первом обращении.
+// Проверять available(): на машине без PMU это пустой набор
+inline PerfCounters& threadPerfCounters() {
+    thread_local PerfCounters counters;
+    thread_local const bool opened = counters.open();
+    (void)opened;
+    return counters;
+}
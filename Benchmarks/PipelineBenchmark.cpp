@@ -0,0 +1,159 @@
+#include "../Runtime/MatchingPipeline.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// End-to-end pipeline benchmark: decoder thread -> ingress ring -> matching
+// thread -> trade ring -> publisher thread. Latency of a fill is measured
+// from the moment its aggressor order was enqueued to the moment the
+// publisher popped the trade, so it includes both thread hops.
+// ============================================================================
+
+namespace {
+
+uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::vector<OrderRecord> generateOrders(size_t num_orders, SymbolId symbol_id) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> price_dist(9998, 10003);
+    std::uniform_int_distribution<uint64_t> qty_dist(1, 100);
+    std::uniform_int_distribution<int> side_dist(0, 1);
+    std::uniform_int_distribution<int> type_dist(0, 9);
+
+    std::vector<OrderRecord> orders;
+    orders.reserve(num_orders);
+    for (size_t i = 0; i < num_orders; ++i) {
+        Side side = side_dist(rng) == 0 ? Side::BUY : Side::SELL;
+        OrderType type = type_dist(rng) < 9 ? OrderType::LIMIT : OrderType::MARKET;
+        int price = type == OrderType::LIMIT ? price_dist(rng) : 0;
+        orders.push_back(makeOrderRecord(i, symbol_id, side, type, price, qty_dist(rng), 0));
+    }
+    return orders;
+}
+
+double percentile(const std::vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    return static_cast<double>(sorted[static_cast<size_t>(p * (sorted.size() - 1))]);
+}
+
+struct PipelineResult {
+    size_t orders;
+    uint64_t processed;
+    double throughput_ops_per_sec;
+    std::vector<uint64_t> latencies_ns;  // отсортированы
+
+    void print(const std::string& title, int matching_cpu) const {
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "\n╔════════════════════════════════════════════════════════════╗\n";
+        std::cout << "║ " << std::left << std::setw(58) << title << " ║\n";
+        std::cout << "╚════════════════════════════════════════════════════════════╝\n";
+        std::cout << "CPUs: " << availableCpuCount() << ", matching thread pinned to: "
+                  << (matching_cpu >= 0 ? std::to_string(matching_cpu) : "none") << "\n";
+        std::cout << "Orders:     " << orders << " (" << processed << " processed)\n";
+        std::cout << "Trades:     " << latencies_ns.size() << "\n";
+        std::cout << "Throughput: " << throughput_ops_per_sec << " orders/sec\n";
+        std::cout << "Enqueue -> fill latency (ns):\n";
+        std::cout << "  P50:   " << percentile(latencies_ns, 0.50) << "\n";
+        std::cout << "  P99:   " << percentile(latencies_ns, 0.99) << "\n";
+        std::cout << "  P99.9: " << percentile(latencies_ns, 0.999) << "\n";
+        std::cout << "  Max:   " << (latencies_ns.empty() ? 0.0 : static_cast<double>(latencies_ns.back())) << "\n";
+    }
+};
+
+// target_rate == 0: производитель заливает кольцо без пауз (предельная
+// пропускная способность, задержка = глубина очереди). Иначе ордера идут
+// с заданной частотой, и задержка показывает стоимость самих переходов.
+PipelineResult runPipeline(size_t num_orders, double target_rate, int matching_cpu) {
+    MatchingPipeline<>::Config config;
+    config.matching_cpu = matching_cpu;
+    MatchingPipeline<> pipeline(config);
+    const SymbolId symbol_id = pipeline.registerSymbol("TEST");
+
+    std::vector<OrderRecord> orders = generateOrders(num_orders, symbol_id);
+    std::vector<uint64_t> enqueue_ns(num_orders);  // публикуется через кольца (release/acquire)
+
+    PipelineResult result;
+    result.orders = num_orders;
+    result.latencies_ns.reserve(num_orders);
+    std::atomic<bool> producer_done{false};
+
+    pipeline.start();
+
+    std::thread publisher([&] {
+        SpinBackoff backoff;
+        Trade trade;
+        auto record = [&] {
+            // Агрессор пришел позже, значит у него больший id
+            uint64_t aggressor = std::max(trade.buy_order_id, trade.sell_order_id);
+            result.latencies_ns.push_back(nowNs() - enqueue_ns[aggressor]);
+        };
+        while (true) {
+            if (pipeline.tryPopTrade(trade)) {
+                record();
+                backoff.reset();
+            } else if (producer_done.load(std::memory_order_acquire)) {
+                if (!pipeline.tryPopTrade(trade)) break;
+                record();
+            } else {
+                backoff.pause();
+            }
+        }
+    });
+
+    const uint64_t interval_ns = target_rate > 0 ? static_cast<uint64_t>(1e9 / target_rate) : 0;
+    const uint64_t start_ns = nowNs();
+    SpinBackoff backoff;
+    for (size_t i = 0; i < num_orders; ++i) {
+        if (interval_ns != 0) {
+            uint64_t due = start_ns + i * interval_ns;
+            while (nowNs() < due) {
+                backoff.pause();
+            }
+            backoff.reset();
+        }
+        enqueue_ns[i] = nowNs();
+        while (!pipeline.trySubmit(orders[i])) {
+            backoff.pause();
+        }
+        backoff.reset();
+    }
+    pipeline.stop();  // поток матчинга дорабатывает очередь
+    const uint64_t end_ns = nowNs();
+
+    producer_done.store(true, std::memory_order_release);
+    publisher.join();
+
+    result.processed = pipeline.processedCount();
+    result.throughput_ops_per_sec = num_orders / ((end_ns - start_ns) / 1e9);
+    std::sort(result.latencies_ns.begin(), result.latencies_ns.end());
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const size_t num_orders = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2'000'000;
+    const double paced_rate = argc > 2 ? std::strtod(argv[2], nullptr) : 100'000.0;
+    const int cpus = availableCpuCount();
+    const int matching_cpu = cpus > 1 ? cpus - 1 : -1;  // на одном ядре не привязываем
+
+    runPipeline(num_orders, 0, matching_cpu).print("PIPELINE: SATURATED THROUGHPUT", matching_cpu);
+
+    // Темп ниже пропускной способности: очередь не копится
+    size_t paced_orders = std::min(num_orders, static_cast<size_t>(paced_rate));  // ~1 секунда
+    runPipeline(paced_orders, paced_rate, matching_cpu)
+            .print("PIPELINE: ENQUEUE -> FILL @ " + std::to_string(static_cast<long>(paced_rate)) + "/s",
+                   matching_cpu);
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include "../EngineConcept/MatchingEngineConcept.h"
+#include "../EnginImpl/V2/MatchingEngineV2.h"
+#include "../EnginImpl/V2_prealloc/MatchingEngineV2_prealloc.h"
+#include "../EnginImpl/V3/MatchingEngineV3.h"
+#include "../EnginImpl/V4/MatchingEngineV4.h"
+#include "../EnginImpl/V5/MatchingEngineV5.h"
+#include "../Runtime/ThreadAffinity.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// Top-of-book snapshot benchmark.
+//
+// The matching thread replays the same order stream while 0..4 reader
+// threads spin on the book's seqlock snapshot. The writer never waits for
+// readers, so its throughput should stay flat as readers are added (the
+// "off" row shows what publishing itself costs the writer); readers
+// report how many snapshots they read and how often a read raced a store.
+// Each thread gets its own core when the machine has enough of them,
+// otherwise the numbers mostly measure time slicing.
+// ============================================================================
+
+namespace {
+
+std::vector<OrderRecord> generateOrders(size_t num_orders, SymbolId symbol_id) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> price_dist(9990, 10010);
+    std::uniform_int_distribution<uint64_t> qty_dist(1, 100);
+    std::uniform_int_distribution<int> side_dist(0, 1);
+    std::uniform_int_distribution<int> type_dist(0, 9);
+
+    std::vector<OrderRecord> orders;
+    orders.reserve(num_orders);
+    for (size_t i = 0; i < num_orders; ++i) {
+        Side side = side_dist(rng) == 0 ? Side::BUY : Side::SELL;
+        OrderType type = type_dist(rng) < 9 ? OrderType::LIMIT : OrderType::MARKET;
+        int price = type == OrderType::LIMIT ? price_dist(rng) : 0;
+        orders.push_back(makeOrderRecord(i, symbol_id, side, type, price, qty_dist(rng), 0));
+    }
+    return orders;
+}
+
+struct ReaderStats {
+    alignas(CACHE_LINE_SIZE) uint64_t reads = 0;
+    uint64_t retries = 0;
+};
+
+template<MatchingEngineConcept Engine>
+double runWriter(const char* label, bool publish, size_t readers, size_t num_orders, double baseline_ops) {
+    Engine engine;
+    engine.enableTopOfBook(publish);
+    const SymbolId symbol_id = engine.registerSymbol("TEST");
+    const std::vector<OrderRecord> orders = generateOrders(num_orders, symbol_id);
+    const SeqLock<TopOfBook>& snapshot = engine.topOfBookSnapshot(symbol_id);
+
+    std::atomic<bool> start{false};
+    std::atomic<bool> stop{false};
+    std::vector<ReaderStats> stats(readers);
+    std::vector<std::thread> threads;
+    for (size_t r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            pinCurrentThread(static_cast<int>((r + 1) % availableCpuCount()));
+            ReaderStats& mine = stats[r];
+            TopOfBook top;
+            uint64_t checksum = 0;
+            while (!start.load(std::memory_order_acquire)) {}
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (snapshot.tryLoad(top)) {
+                    checksum += static_cast<uint64_t>(top.bid.price) + top.ask.quantity;
+                    ++mine.reads;
+                } else {
+                    ++mine.retries;
+                }
+            }
+            if (checksum == 1) std::cout << "";  // не даем выбросить чтения
+        });
+    }
+
+    pinCurrentThread(0);
+    start.store(true, std::memory_order_release);
+    auto begin = std::chrono::steady_clock::now();
+    for (const OrderRecord& order : orders) {
+        engine.submitOrder(order);
+    }
+    auto end = std::chrono::steady_clock::now();
+    stop = true;
+    for (auto& thread : threads) thread.join();
+
+    const double seconds = std::chrono::duration<double>(end - begin).count();
+    const double ops = num_orders / seconds;
+    uint64_t reads = 0, retries = 0;
+    for (const ReaderStats& s : stats) {
+        reads += s.reads;
+        retries += s.retries;
+    }
+
+    std::cout << std::left << std::setw(14) << label << std::right << std::setw(8)
+              << (publish ? std::to_string(readers) : std::string("off"))
+              << std::fixed << std::setprecision(0) << std::setw(16) << ops
+              << std::setprecision(1) << std::setw(10)
+              << (baseline_ops > 0 ? 100.0 * ops / baseline_ops : 100.0) << "%"
+              << std::setprecision(2) << std::setw(16) << reads / seconds / 1e6
+              << std::setw(12) << (reads + retries > 0 ? 100.0 * retries / (reads + retries) : 0.0) << "%\n";
+    return ops;
+}
+
+template<MatchingEngineConcept Engine>
+void runEngine(const char* label, size_t num_orders) {
+    const double baseline = runWriter<Engine>(label, true, 0, num_orders, 0);
+    runWriter<Engine>(label, false, 0, num_orders, baseline);  // цена самой публикации
+    for (size_t readers : {1, 2, 4}) {
+        runWriter<Engine>(label, true, readers, num_orders, baseline);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const size_t num_orders = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+
+    std::cout << "CPUs: " << availableCpuCount() << ", orders per run: " << num_orders << "\n";
+    if (availableCpuCount() < 5) {
+        std::cout << "warning: fewer than 5 CPUs, readers share cores with the writer\n";
+    }
+    std::cout << std::left << std::setw(14) << "Engine" << std::right << std::setw(8) << "readers"
+              << std::setw(16) << "writer ops/s" << std::setw(11) << "vs 0"
+              << std::setw(16) << "reads M/s" << std::setw(13) << "retries\n";
+
+    runEngine<MatchingEngineV2>("V2", num_orders);
+    runEngine<MatchingEngineV2_prealloc>("V2_prealloc", num_orders);
+    runEngine<MatchingEngineV3>("V3", num_orders);
+    runEngine<MatchingEngineV4>("V4", num_orders);
+    runEngine<MatchingEngineV5>("V5", num_orders);
+    return 0;
+}
@@ -0,0 +1,272 @@
+#pragma once
+#include "../EngineConcept/Order.h"
+#include "../Runtime/IngressMessage.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// Synthetic order flow for benchmarks.
+//
+// Commands are generated up front into a buffer, so the timed loop only
+// applies them (applyCommand) and the RNG cost stays out of the numbers.
+// Per symbol the mid price random-walks one tick at a time; passive limit
+// orders rest a geometric number of ticks behind the mid, aggressive limit
+// orders cross it by the same distance, market orders are larger and sweep
+// several levels. Cancels and modifies target orders placed earlier on the
+// same symbol; some of those have traded by then and are rejected by the
+// engine, as in a real flow. Symbols are drawn with Zipf popularity, inter-
+// arrival gaps are exponential (Poisson flow) and recorded for paced runs.
+//
+// The same seed gives the same workload with the same standard library: only
+// std::mt19937_64 and the standard distributions are used. WorkloadGenerator
+// produces the flow in chunks for runs too long to buffer whole.
+// ============================================================================
+
+struct WorkloadConfig {
+    enum class SizeDistribution {
+        UNIFORM,   // min_quantity..max_quantity
+        LOGNORMAL  // exp(N(size_mu, size_sigma)), обрезано до min..max
+    };
+
+    const char* name = "default";  // метка в отчетах
+    uint64_t seed = 42;
+    size_t num_commands = 1'000'000;
+
+    size_t num_symbols = 8;
+    double zipf_exponent = 1.0;  // 0 - символы равновероятны
+
+    int initial_mid = 10000;
+    double mid_step_probability = 0.05;  // сдвиг середины на тик на команду символа
+    double offset_p = 0.3;               // параметр геометрического отступа от середины, в тиках
+    int max_offset = 50;
+
+    // Доли от всех команд; остаток - новые ордера
+    double cancel_ratio = 0.30;
+    double modify_ratio = 0.05;
+    // Доли от новых ордеров; остаток - пассивные лимитные
+    double aggressive_ratio = 0.10;
+    double market_ratio = 0.02;
+
+    SizeDistribution size_distribution = SizeDistribution::LOGNORMAL;
+    uint32_t min_quantity = 1;
+    uint32_t max_quantity = 1000;
+    double size_mu = 3.0;     // медиана ~20
+    double size_sigma = 1.0;
+    uint32_t market_size_multiplier = 5;  // рыночный ордер проходит несколько уровней
+
+    double arrival_rate = 1e6;  // команд в секунду
+
+    // Сколько ранее выставленных ордеров символа помнить как цели снятий и
+    // изменений; при переполнении новый вытесняет случайный (чаще всего уже исполненный)
+    size_t max_tracked_orders = 1 << 16;
+
+    // Без снятий и изменений, половина ордеров агрессивные: глубины почти нет
+    static WorkloadConfig sweepHeavy() {
+        WorkloadConfig config;
+        config.name = "sweep-heavy";
+        config.cancel_ratio = 0.0;
+        config.modify_ratio = 0.0;
+        config.aggressive_ratio = 0.35;
+        config.market_ratio = 0.15;
+        return config;
+    }
+
+    // Поток маркет-мейкеров: снятий почти столько же, сколько новых ордеров,
+    // книга глубокая и широкая. При cancel_ratio выше доли новых книга пустеет
+    static WorkloadConfig cancelHeavy() {
+        WorkloadConfig config;
+        config.name = "cancel-heavy";
+        config.cancel_ratio = 0.42;
+        config.modify_ratio = 0.13;
+        config.aggressive_ratio = 0.03;
+        config.market_ratio = 0.01;
+        config.offset_p = 0.1;
+        config.max_offset = 200;
+        return config;
+    }
+};
+
+struct WorkloadCounts {
+    size_t new_orders = 0;
+    size_t aggressive_orders = 0;  // включая рыночные
+    size_t market_orders = 0;
+    size_t cancels = 0;
+    size_t modifies = 0;
+};
+
+struct Workload : WorkloadCounts {
+    std::vector<std::string> symbols;  // SymbolId команды = индекс, регистрировать по порядку
+    std::vector<IngressMessage> commands;
+    std::vector<uint64_t> arrival_ns;  // момент прихода каждой команды от начала потока
+};
+
+// Регистрирует символы нагрузки; false - движок выдал другие SymbolId
+template<typename Engine>
+bool registerWorkloadSymbols(Engine& engine, const std::vector<std::string>& symbols) {
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        if (engine.registerSymbol(symbols[i]) != static_cast<SymbolId>(i)) return false;
+    }
+    return true;
+}
+
+template<typename Engine>
+bool registerWorkloadSymbols(Engine& engine, const Workload& workload) {
+    return registerWorkloadSymbols(engine, workload.symbols);
+}
+
+// Потоковая генерация порциями: длинные прогоны не держат весь поток в памяти
+// (50M команд - 3.2 GB). Порции подряд дают те же команды, что и один вызов
+class WorkloadGenerator {
+public:
+    explicit WorkloadGenerator(const WorkloadConfig& config)
+        : config_(config),
+          num_symbols_(std::max<size_t>(config.num_symbols, 1)),
+          rng_(config.seed),
+          mid_step_(config.mid_step_probability),
+          offset_dist_(config.offset_p),
+          gap_ns_(config.arrival_rate / 1e9),
+          uniform_size_(config.min_quantity, config.max_quantity),
+          lognormal_size_(config.size_mu, config.size_sigma),
+          mids_(num_symbols_, config.initial_mid),
+          resting_(num_symbols_) {
+        std::vector<double> popularity(num_symbols_);
+        for (size_t i = 0; i < num_symbols_; ++i) {
+            symbols_.push_back("SYM" + std::to_string(i));
+            popularity[i] = 1.0 / std::pow(static_cast<double>(i + 1), config.zipf_exponent);
+        }
+        symbol_dist_ = std::discrete_distribution<size_t>(popularity.begin(), popularity.end());
+    }
+
+    [[nodiscard]] const std::vector<std::string>& symbols() const {
+        return symbols_;
+    }
+
+    [[nodiscard]] const WorkloadCounts& counts() const {
+        return counts_;
+    }
+
+    // Команд до config.num_commands
+    [[nodiscard]] size_t remaining() const {
+        return config_.num_commands - generated_;
+    }
+
+    // Дописывает в out до max_commands следующих команд, возвращает сколько дописано
+    size_t generate(std::vector<IngressMessage>& out, size_t max_commands, std::vector<uint64_t>* arrival_ns = nullptr) {
+        const size_t n = std::min(max_commands, remaining());
+        for (size_t i = 0; i < n; ++i) {
+            out.push_back(next(arrival_ns));
+        }
+        generated_ += n;
+        return n;
+    }
+
+private:
+    struct RestingOrder {
+        uint64_t order_id;
+        Side side;
+    };
+
+    int offset() {
+        return 1 + std::min(offset_dist_(rng_), config_.max_offset);
+    }
+
+    uint32_t quantity() {
+        if (config_.size_distribution == WorkloadConfig::SizeDistribution::UNIFORM) return uniform_size_(rng_);
+        double size = std::round(lognormal_size_(rng_));
+        return static_cast<uint32_t>(std::clamp(size, double(config_.min_quantity), double(config_.max_quantity)));
+    }
+
+    IngressMessage next(std::vector<uint64_t>* arrival_ns) {
+        const size_t symbol = symbol_dist_(rng_);
+        int& mid = mids_[symbol];
+        if (mid_step_(rng_)) {
+            mid = std::max(mid + (coin_(rng_) ? 1 : -1), config_.max_offset + 2);  // цены остаются положительными
+        }
+        clock_ns_ += gap_ns_(rng_);
+        if (arrival_ns != nullptr) arrival_ns->push_back(static_cast<uint64_t>(clock_ns_));
+
+        std::vector<RestingOrder>& live = resting_[symbol];
+        const double action = unit_(rng_);
+        if (action < config_.cancel_ratio && !live.empty()) {
+            const size_t victim = rng_() % live.size();
+            OrderRecord order{};
+            order.order_id = live[victim].order_id;
+            live[victim] = live.back();
+            live.pop_back();
+            ++counts_.cancels;
+            return {order, IngressMessage::Kind::CANCEL};
+        }
+        if (action < config_.cancel_ratio + config_.modify_ratio && !live.empty()) {
+            const RestingOrder& target = live[rng_() % live.size()];
+            OrderRecord order{};
+            order.order_id = target.order_id;
+            order.quantity = quantity();
+            order.price = target.side == Side::BUY ? mid - offset() : mid + offset();
+            ++counts_.modifies;
+            return {order, IngressMessage::Kind::MODIFY};
+        }
+
+        const Side side = coin_(rng_) ? Side::BUY : Side::SELL;
+        const double kind = unit_(rng_);
+        const uint64_t order_id = next_order_id_++;
+        OrderRecord order;
+        if (kind < config_.market_ratio) {
+            order = makeOrderRecord(order_id, static_cast<SymbolId>(symbol), side, OrderType::MARKET, 0,
+                                    uint64_t{quantity()} * config_.market_size_multiplier, 0);
+            ++counts_.market_orders;
+            ++counts_.aggressive_orders;
+        } else {
+            const bool aggressive = kind < config_.market_ratio + config_.aggressive_ratio;
+            // Пассивный встает за середину, агрессивный пересекает ее на столько же
+            const int distance = aggressive ? -offset() : offset();
+            const int price = side == Side::BUY ? mid - distance : mid + distance;
+            order = makeOrderRecord(order_id, static_cast<SymbolId>(symbol), side, OrderType::LIMIT, price,
+                                    quantity(), 0);
+            if (aggressive) ++counts_.aggressive_orders;
+            // Остаток может встать в книгу
+            if (live.size() < config_.max_tracked_orders || live.empty()) {
+                live.push_back({order_id, side});
+            } else {
+                live[rng_() % live.size()] = {order_id, side};
+            }
+        }
+        ++counts_.new_orders;
+        return {order, IngressMessage::Kind::NEW_ORDER};
+    }
+
+    WorkloadConfig config_;
+    size_t num_symbols_;
+    std::vector<std::string> symbols_;
+    WorkloadCounts counts_;
+    size_t generated_ = 0;
+
+    std::mt19937_64 rng_;
+    std::discrete_distribution<size_t> symbol_dist_;
+    std::uniform_real_distribution<double> unit_{0.0, 1.0};
+    std::bernoulli_distribution coin_{0.5};
+    std::bernoulli_distribution mid_step_;
+    std::geometric_distribution<int> offset_dist_;
+    std::exponential_distribution<double> gap_ns_;
+    std::uniform_int_distribution<uint32_t> uniform_size_;
+    std::lognormal_distribution<double> lognormal_size_;
+
+    std::vector<int> mids_;
+    std::vector<std::vector<RestingOrder>> resting_;
+    uint64_t next_order_id_ = 1;
+    double clock_ns_ = 0;
+};
+
+inline Workload generateWorkload(const WorkloadConfig& config) {
+    WorkloadGenerator generator(config);
+    Workload workload;
+    workload.symbols = generator.symbols();
+    workload.commands.reserve(config.num_commands);
+    workload.arrival_ns.reserve(config.num_commands);
+    generator.generate(workload.commands, config.num_commands, &workload.arrival_ns);
+    static_cast<WorkloadCounts&>(workload) = generator.counts();
+    return workload;
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "../../EngineConcept/Order.h"
+#include "../../EngineConcept/SymbolRegistry.h"
 #include <map>
 #include <set>
 #include <memory>
@@ -39,27 +40,28 @@ public:
     SellBook sell_orders;
 
     void addBuyOrder(std::unique_ptr<Order> order) {
-        buy_orders.insert(order);
+        buy_orders.insert(std::move(order));
     }
 
     void addSellOrder(std::unique_ptr<Order> order) {
-        sell_orders.insert(order);
+        sell_orders.insert(std::move(order));
     }
 
-    void removeBuyOrder(std::unique_ptr<Order> order) {
-        buy_orders.erase(order);
+    // Исполненный ордер всегда лучший в своей стороне книги
+    void removeBestBuy() {
+        buy_orders.erase(buy_orders.begin());
     }
 
-    void removeSellOrder(std::unique_ptr<Order> order) {
-        sell_orders.erase(order);
+    void removeBestSell() {
+        sell_orders.erase(sell_orders.begin());
     }
 
     [[nodiscard]] Order* getBestBuy() const {
-        return buy_orders.empty() ? nullptr : *buy_orders.begin();
+        return buy_orders.empty() ? nullptr : buy_orders.begin()->get();
     }
 
     [[nodiscard]] Order* getBestSell() const {
-        return sell_orders.empty() ? nullptr : *sell_orders.begin();
+        return sell_orders.empty() ? nullptr : sell_orders.begin()->get();
     }
 };
 
@@ -77,19 +79,40 @@ public:
         trade_callback_ = callback;
     }
 
-    void submitOrder(std::shared_ptr<Order> order) {
+    void submitOrder(std::unique_ptr<Order> order) {
         if (order->timestamp == 0) {
             order->timestamp = ++next_timestamp_;
         }
-        matchOrder(order);
+        if (order->symbol_id == INVALID_SYMBOL_ID) {
+            order->symbol_id = order_books_.registerSymbol(order->symbol);
+        }
+        matchOrder(std::move(order));
+    }
+
+    SymbolId registerSymbol(const std::string& symbol) {
+        return order_books_.registerSymbol(symbol);
     }
 
     [[nodiscard]] size_t getBuyOrderCount() const {
-        return book.buy_orders.size();
+        size_t count = 0;
+        for (const auto& book : order_books_) count += book.buy_orders.size();
+        return count;
     }
 
     [[nodiscard]] size_t getSellOrderCount() const {
-        return book.sell_orders.size();
+        size_t count = 0;
+        for (const auto& book : order_books_) count += book.sell_orders.size();
+        return count;
+    }
+
+    [[nodiscard]] size_t getBuyOrderCount(const std::string& symbol) const {
+        const OrderBook* book = order_books_.find(symbol);
+        return book ? book->buy_orders.size() : 0;
+    }
+
+    [[nodiscard]] size_t getSellOrderCount(const std::string& symbol) const {
+        const OrderBook* book = order_books_.find(symbol);
+        return book ? book->sell_orders.size() : 0;
     }
 
 //    [[nodiscard]] const std::vector<Trade>& getTrades() const {
@@ -101,105 +124,102 @@ public:
     }
 
 private:
-    void matchOrder(std::shared_ptr<Order> order) {
+    void matchOrder(std::unique_ptr<Order> order) {
+        OrderBook& book = getOrderBook(order->symbol_id);
         if (order->type == OrderType::MARKET) {
-            matchMarketOrder(order);
+            matchMarketOrder(book, std::move(order));
         } else {
-            matchLimitOrder(order);
+            matchLimitOrder(book, std::move(order));
         }
     }
 
-    void matchMarketOrder(std::shared_ptr<Order> order) {
-        //OrderBook& book = getOrderBook(order->symbol);
-
+    void matchMarketOrder(OrderBook& book, std::unique_ptr<Order> order) {
         if (order->side == Side::BUY) {
             while (order->quantity > 0 && !book.sell_orders.empty()) {
-                auto best_sell = book.getBestSell();
+                Order* best_sell = book.getBestSell();
                 uint64_t trade_qty = std::min(order->quantity, best_sell->quantity);
 
-                executeTrade(order, best_sell, best_sell->price, trade_qty);
+                executeTrade(order.get(), best_sell, best_sell->price, trade_qty);
 
                 order->quantity -= trade_qty;
                 best_sell->quantity -= trade_qty;
 
                 if (best_sell->quantity == 0) {
-                    book.removeSellOrder(best_sell);
+                    book.removeBestSell();
                 }
             }
         } else {
             while (order->quantity > 0 && !book.buy_orders.empty()) {
-                auto best_buy = book.getBestBuy();
+                Order* best_buy = book.getBestBuy();
                 uint64_t trade_qty = std::min(order->quantity, best_buy->quantity);
 
-                executeTrade(best_buy, order, best_buy->price, trade_qty);
+                executeTrade(best_buy, order.get(), best_buy->price, trade_qty);
 
                 order->quantity -= trade_qty;
                 best_buy->quantity -= trade_qty;
 
                 if (best_buy->quantity == 0) {
-                    book.removeBuyOrder(best_buy);
+                    book.removeBestBuy();
                 }
             }
         }
     }
 
-    void matchLimitOrder(std::shared_ptr<Order> order) {
+    void matchLimitOrder(OrderBook& book, std::unique_ptr<Order> order) {
 
         if (order->side == Side::BUY) {
             while (order->quantity > 0 && !book.sell_orders.empty()) {
-                auto best_sell = book.getBestSell();
+                Order* best_sell = book.getBestSell();
 
-                if (!canMatch(order, best_sell)) {
+                if (!canMatch(order.get(), best_sell)) {
                     break;
                 }
 
                 uint64_t trade_qty = std::min(order->quantity, best_sell->quantity);
-                executeTrade(order, best_sell, best_sell->price, trade_qty);
+                executeTrade(order.get(), best_sell, best_sell->price, trade_qty);
 
                 order->quantity -= trade_qty;
                 best_sell->quantity -= trade_qty;
 
                 if (best_sell->quantity == 0) {
-                    book.removeSellOrder(best_sell);
+                    book.removeBestSell();
                 }
             }
 
             if (order->quantity > 0) {
-                book.addBuyOrder(order);
+                book.addBuyOrder(std::move(order));
             }
         } else {
             while (order->quantity > 0 && !book.buy_orders.empty()) {
-                auto best_buy = book.getBestBuy();
+                Order* best_buy = book.getBestBuy();
 
-                if (!canMatch(best_buy, order)) {
+                if (!canMatch(best_buy, order.get())) {
                     break;
                 }
 
                 uint64_t trade_qty = std::min(order->quantity, best_buy->quantity);
-                executeTrade(best_buy, order, best_buy->price, trade_qty);
+                executeTrade(best_buy, order.get(), best_buy->price, trade_qty);
 
                 order->quantity -= trade_qty;
                 best_buy->quantity -= trade_qty;
 
                 if (best_buy->quantity == 0) {
-                    this->book.removeBuyOrder(best_buy);
+                    book.removeBestBuy();
                 }
             }
 
             if (order->quantity > 0) {
-                this->book.addSellOrder(order);
+                book.addSellOrder(std::move(order));
             }
         }
     }
 
-    [[nodiscard]] bool canMatch(const std::shared_ptr<Order>& buy,
-                                const std::shared_ptr<Order>& sell) const {
+    [[nodiscard]] bool canMatch(const Order* buy, const Order* sell) const {
         return buy->price >= sell->price;
     }
 
-    void executeTrade(std::shared_ptr<Order> buy_order,
-                     std::shared_ptr<Order> sell_order,
-                     double price, uint64_t quantity) {
+    void executeTrade(const Order* buy_order, const Order* sell_order,
+                      int price, uint64_t quantity) {
         Trade trade(buy_order->order_id, sell_order->order_id, price, quantity, ++next_timestamp_);
         //trades_.push_back(trade);
 
@@ -208,12 +228,11 @@ private:
         }
     }
 
-//    OrderBook& getOrderBook(const std::string& symbol) {
-//        return order_books_[symbol];
-//    }
+    OrderBook& getOrderBook(SymbolId symbol_id) {
+        return order_books_.book(symbol_id);
+    }
 
-    OrderBook book;
-    //std::map<std::string, OrderBook> order_books_;
+    PerSymbolBooks<OrderBook> order_books_;
     //std::vector<Trade> trades_;
     TradeCallback trade_callback_;
     uint64_t next_timestamp_;
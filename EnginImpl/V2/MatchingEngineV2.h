@@ -1,9 +1,20 @@
 #pragma once
+#include "../../EngineConcept/MarketData.h"
 #include "../../EngineConcept/Order.h"
+#include "../../EngineConcept/SymbolRegistry.h"
+#include "../../EngineConcept/TradeSink.h"
+#include "../../EngineCommon/BookSnapshot.h"
+#include "../../EngineCommon/EngineStats.h"
+#include "../../EngineCommon/L2Publisher.h"
+#include "../../EngineCommon/L3Feed.h"
+#include "../../EngineCommon/TopOfBook.h"
 #include <map>
 #include <memory>
 #include <deque>
 #include <functional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
 
 // ============================================================================
 // OPTIMIZED IMPLEMENTATION with unique_ptr
@@ -15,32 +26,63 @@ public:
         int price;
         std::deque<std::unique_ptr<Order>> orders;
         uint64_t total_quantity;
+        uint32_t order_count;  // живые ордера, без отмененных слотов
+        uint64_t popped;  // сколько ордеров снято с головы = порядковый номер front()
+
+        PriceLevel() : price(0), total_quantity(0), order_count(0), popped(0) {}
+        explicit PriceLevel(int p) : price(p), total_quantity(0), order_count(0), popped(0) {}
+
+        // Отмененные ордера остаются пустыми слотами в середине очереди,
+        // голова уровня всегда указывает на живой ордер
+        void pop_front() {
+            orders.pop_front();
+            ++popped;
+            while (!orders.empty() && !orders.front()) {
+                orders.pop_front();
+                ++popped;
+            }
+        }
+    };
 
-        PriceLevel() : price(0), total_quantity(0) {}
-        explicit PriceLevel(int p) : price(p), total_quantity(0) {}
+    // Положение ордера в книге: уровень + порядковый номер в его очереди
+    struct OrderRef {
+        PriceLevel* level;
+        uint64_t seq;
     };
 
     std::map<int, PriceLevel, std::greater<>> buy_levels;
     std::map<int, PriceLevel, std::less<>> sell_levels;
 
-    void addBuyOrder(std::unique_ptr<Order> order) {
+    // Ордера в книге; число уровней - размер map, пустые уровни удаляются сразу
+    size_t buy_order_count = 0;
+    size_t sell_order_count = 0;
+
+    OrderRef addBuyOrder(std::unique_ptr<Order> order) {
         int price = order->price;
         uint64_t quantity = order->quantity;
 
         auto [it, inserted] = buy_levels.try_emplace(price, price);
         auto& level = it->second;
+        uint64_t seq = level.popped + level.orders.size();
         level.orders.push_back(std::move(order));
         level.total_quantity += quantity;
+        ++level.order_count;
+        ++buy_order_count;
+        return {&level, seq};
     }
 
-    void addSellOrder(std::unique_ptr<Order> order) {
+    OrderRef addSellOrder(std::unique_ptr<Order> order) {
         int price = order->price;
         uint64_t quantity = order->quantity;
 
         auto [it, inserted] = sell_levels.try_emplace(price, price);
         auto& level = it->second;
+        uint64_t seq = level.popped + level.orders.size();
         level.orders.push_back(std::move(order));
         level.total_quantity += quantity;
+        ++level.order_count;
+        ++sell_order_count;
+        return {&level, seq};
     }
 
     void removeBuyOrder(int price, uint64_t quantity) {
@@ -48,8 +90,10 @@ public:
         if (it == buy_levels.end()) return;
 
         auto& level = it->second;
-        level.orders.pop_front();  // unique_ptr автоматически удалится
+        level.pop_front();  // unique_ptr автоматически удалится
         level.total_quantity -= quantity;
+        --level.order_count;
+        --buy_order_count;
 
         if (level.orders.empty()) {
             buy_levels.erase(it);
@@ -61,14 +105,95 @@ public:
         if (it == sell_levels.end()) return;
 
         auto& level = it->second;
-        level.orders.pop_front();
+        level.pop_front();
         level.total_quantity -= quantity;
+        --level.order_count;
+        --sell_order_count;
 
         if (level.orders.empty()) {
             sell_levels.erase(it);
         }
     }
 
+    [[nodiscard]] static Order* getOrder(OrderRef ref) {
+        return ref.level->orders[ref.seq - ref.level->popped].get();
+    }
+
+    static void reduceOrderQuantity(OrderRef ref, uint64_t new_quantity) {
+        Order* order = getOrder(ref);
+        ref.level->total_quantity -= order->quantity - new_quantity;
+        order->quantity = new_quantity;
+    }
+
+    // O(1): слот становится пустым, пустой уровень удаляется из map
+    std::unique_ptr<Order> cancelBuyOrder(OrderRef ref) {
+        auto order = takeOrder(ref);
+        --buy_order_count;
+        if (ref.level->orders.empty()) {
+            buy_levels.erase(ref.level->price);
+        }
+        return order;
+    }
+
+    std::unique_ptr<Order> cancelSellOrder(OrderRef ref) {
+        auto order = takeOrder(ref);
+        --sell_order_count;
+        if (ref.level->orders.empty()) {
+            sell_levels.erase(ref.level->price);
+        }
+        return order;
+    }
+
+    // Частичное исполнение головы лучшего уровня: ордер остается в очереди
+    void reduceBestBuy(uint64_t quantity) {
+        buy_levels.begin()->second.total_quantity -= quantity;
+    }
+
+    void reduceBestSell(uint64_t quantity) {
+        sell_levels.begin()->second.total_quantity -= quantity;
+    }
+
+    // Агрегат одного уровня; нет уровня или он пуст - нулевые счетчики
+    [[nodiscard]] DepthLevel levelAt(Side side, int price) const {
+        return side == Side::BUY ? aggregateAt(buy_levels, price) : aggregateAt(sell_levels, price);
+    }
+
+    // Агрегаты верхних уровней стороны, без прохода по ордерам
+    // Для снимка лучших цен: без прохода по уровням
+    [[nodiscard]] TopOfBook topOfBook() const {
+        TopOfBook top{};
+        depth(Side::BUY, {&top.bid, 1});
+        depth(Side::SELL, {&top.ask, 1});
+        return top;
+    }
+
+    size_t depth(Side side, std::span<DepthLevel> out) const {
+        return side == Side::BUY ? collectDepth(buy_levels, out) : collectDepth(sell_levels, out);
+    }
+
+    // Снимок: непустые уровни от лучшего, ордера в порядке приоритета
+    void saveLevels(BookSnapshotWriter& out) const {
+        saveSide(buy_levels, Side::BUY, out);
+        saveSide(sell_levels, Side::SELL, out);
+    }
+
+    // Уровень из снимка целиком. Уровни приходят от лучшего к худшему, то есть
+    // в порядке map: вставка с подсказкой end() не ищет по дереву.
+    // Возвращает ссылку на первый ордер, остальные идут с seq + i
+    OrderRef restoreLevel(Side side, int price, std::span<const OrderRecord> orders) {
+        PriceLevel& level = side == Side::BUY
+                ? buy_levels.emplace_hint(buy_levels.end(), price, price)->second
+                : sell_levels.emplace_hint(sell_levels.end(), price, price)->second;
+        uint64_t seq = level.popped + level.orders.size();
+        for (const OrderRecord& record : orders) {
+            level.orders.push_back(std::make_unique<Order>(record));
+            level.total_quantity += record.quantity;
+        }
+        level.order_count += static_cast<uint32_t>(orders.size());
+        (side == Side::BUY ? buy_order_count : sell_order_count) += orders.size();
+        return {&level, seq};
+    }
+
     [[nodiscard]] Order* getBestBuy() {
         if (buy_levels.empty()) return nullptr;
         auto& level = buy_levels.begin()->second;
@@ -80,52 +205,345 @@ public:
         auto& level = sell_levels.begin()->second;
         return level.orders.front().get();
     }
+
+private:
+    template<typename Levels>
+    static DepthLevel aggregateAt(const Levels& levels, int price) {
+        auto it = levels.find(price);
+        if (it == levels.end()) return {price, 0, 0};
+        return {price, it->second.order_count, it->second.total_quantity};
+    }
+
+    template<typename Levels>
+    static size_t collectDepth(const Levels& levels, std::span<DepthLevel> out) {
+        size_t filled = 0;
+        for (auto it = levels.begin(); it != levels.end() && filled < out.size(); ++it) {
+            out[filled++] = {it->first, it->second.order_count, it->second.total_quantity};
+        }
+        return filled;
+    }
+
+    template<typename Levels>
+    static void saveSide(const Levels& levels, Side side, BookSnapshotWriter& out) {
+        for (const auto& [price, level] : levels) {
+            out.beginLevel(side, price);
+            for (const auto& order : level.orders) {
+                if (order) out.addOrder(order->toRecord());
+            }
+        }
+    }
+
+    static std::unique_ptr<Order> takeOrder(OrderRef ref) {
+        PriceLevel& level = *ref.level;
+        size_t pos = ref.seq - level.popped;
+        std::unique_ptr<Order> order = std::move(level.orders[pos]);
+        level.total_quantity -= order->quantity;
+        --level.order_count;
+
+        if (pos == 0) {
+            level.pop_front();
+        } else {
+            while (!level.orders.back()) {
+                level.orders.pop_back();
+            }
+        }
+        return order;
+    }
 };
 
-class MatchingEngineV2 {
+template<TradeSink Sink = BufferedTradeSink, typename Stats = NoEngineStats>
+class BasicMatchingEngineV2 {
 public:
     using TradeCallback = std::function<void(const Trade&)>;
 
-    MatchingEngineV2() : next_timestamp_(0) {}
+    BasicMatchingEngineV2() : next_timestamp_(0) {}
+
+    explicit BasicMatchingEngineV2(Sink sink) : sink_(std::move(sink)), next_timestamp_(0) {}
 
     static const char* name() {
         return "MatchingEngineV2";
     }
 
-    void setTradeCallback(TradeCallback callback) {
-        trade_callback_ = std::move(callback);
+    // Только для sink с type erasure, см. CallbackTradeSink
+    void setTradeCallback(TradeCallback callback) requires CallbackSettableSink<Sink> {
+        sink_.setCallback(std::move(callback));
+    }
+
+    Sink& tradeSink() {
+        return sink_;
     }
 
-    // Принимаем unique_ptr
-    void submitOrder(std::unique_ptr<Order> order) {
+    // Принимаем unique_ptr. false - ордер отклонен целиком: количество не
+    // помещается в OrderRecord или ордер с таким id еще стоит в книге
+    bool submitOrder(std::unique_ptr<Order> order) {
+        if (order->quantity > MAX_ORDER_QUANTITY) return false;
+        if (order_index_.contains(order->order_id)) return false;
         if (order->timestamp == 0) {
             order->timestamp = ++next_timestamp_;
         }
+        if (order->symbol_id == INVALID_SYMBOL_ID) {
+            // медленный путь: символ не был зарегистрирован заранее
+            order->symbol_id = registerSymbol(order->symbol);
+        }
+        SymbolId symbol_id = order->symbol_id;
+        beginTradeBatch(sink_);
         matchOrder(std::move(order));
+        endTradeBatch(sink_);
+        stats_.onMatchEnd();
+        l2_.publish(symbol_id, books_.book(symbol_id));
+        top_of_book_.publish(symbol_id, books_.book(symbol_id));
+        stats_.onOrder();
+        publishStatsIfDue();
+        return true;
+    }
+
+    // Компактная запись: книга хранит Order, поэтому распаковываем
+    bool submitOrder(const OrderRecord& record) {
+        return submitOrder(std::make_unique<Order>(record));
+    }
+
+    // Регистрируем символы на старте сессии, дальше ордера несут symbol_id
+    SymbolId registerSymbol(const std::string& symbol) {
+        SymbolId symbol_id = books_.registerSymbol(symbol);
+        top_of_book_.ensure(symbol_id);
+        return symbol_id;
+    }
+
+    // Снятие ордера по id через индекс, без поиска по уровню
+    bool cancelOrder(uint64_t order_id) {
+        auto it = order_index_.find(order_id);
+        if (it == order_index_.end()) return false;
+
+        OrderLocation location = it->second;
+        order_index_.erase(it);
+        auto& book = books_.book(location.symbol_id);
+        Order* resting = book.getOrder(location.ref);
+        l3_.cancel(location.symbol_id, location.side, order_id, resting->price, resting->quantity, next_timestamp_);
+        l2_.touch(book, location.side, location.ref.level->price);
+        if (location.side == Side::BUY) {
+            book.cancelBuyOrder(location.ref);
+        } else {
+            book.cancelSellOrder(location.ref);
+        }
+        l2_.publish(location.symbol_id, book);
+        top_of_book_.publish(location.symbol_id, book);
+        stats_.onCancel();
+        publishStatsIfDue();
+        return true;
+    }
+
+    // Уменьшение количества на той же цене сохраняет приоритет по времени,
+    // смена цены или увеличение количества - это снятие и новая постановка
+    bool modifyOrder(uint64_t order_id, uint64_t new_quantity, int new_price) {
+        if (new_quantity > MAX_ORDER_QUANTITY) return false;
+        if (new_quantity == 0) return cancelOrder(order_id);
+
+        auto it = order_index_.find(order_id);
+        if (it == order_index_.end()) return false;
+
+        OrderLocation location = it->second;
+        auto& book = books_.book(location.symbol_id);
+        Order* resting = book.getOrder(location.ref);
+        if (new_price == resting->price && new_quantity <= resting->quantity) {
+            l2_.touch(book, location.side, resting->price);
+            book.reduceOrderQuantity(location.ref, new_quantity);
+            l3_.replace(location.symbol_id, location.side, order_id, resting->price, new_quantity, next_timestamp_);
+            l2_.publish(location.symbol_id, book);
+            top_of_book_.publish(location.symbol_id, book);
+            stats_.onModify();
+            publishStatsIfDue();
+            return true;
+        }
+
+        order_index_.erase(it);
+        l3_.cancel(location.symbol_id, location.side, order_id, resting->price, resting->quantity, next_timestamp_);
+        l2_.touch(book, location.side, resting->price);
+        std::unique_ptr<Order> order = location.side == Side::BUY
+                ? book.cancelBuyOrder(location.ref)
+                : book.cancelSellOrder(location.ref);
+        order->price = new_price;
+        order->quantity = new_quantity;
+        order->timestamp = ++next_timestamp_;
+        beginTradeBatch(sink_);
+        matchOrder(std::move(order));  // новая цена может пересечь спред
+        endTradeBatch(sink_);
+        stats_.onMatchEnd();
+        l2_.publish(location.symbol_id, book);
+        top_of_book_.publish(location.symbol_id, book);
+        stats_.onModify();
+        publishStatsIfDue();
+        return true;
     }
 
     [[nodiscard]] size_t getBuyOrderCount() const {
-        return book.buy_levels.size();
+        size_t count = 0;
+        for (const auto& book : books_) count += book.buy_order_count;
+        return count;
     }
 
     [[nodiscard]] size_t getSellOrderCount() const {
-        return book.sell_levels.size();
+        size_t count = 0;
+        for (const auto& book : books_) count += book.sell_order_count;
+        return count;
+    }
+
+    [[nodiscard]] size_t getBuyOrderCount(const std::string& symbol) const {
+        const OrderBookHashMap* book = books_.find(symbol);
+        return book ? book->buy_order_count : 0;
+    }
+
+    [[nodiscard]] size_t getSellOrderCount(const std::string& symbol) const {
+        const OrderBookHashMap* book = books_.find(symbol);
+        return book ? book->sell_order_count : 0;
+    }
+
+    // Ценовые уровни по всем символам, пустые уровни удаляются сразу
+    [[nodiscard]] size_t getBuyLevelCount() const {
+        size_t count = 0;
+        for (const auto& book : books_) count += book.buy_levels.size();
+        return count;
+    }
+
+    [[nodiscard]] size_t getSellLevelCount() const {
+        size_t count = 0;
+        for (const auto& book : books_) count += book.sell_levels.size();
+        return count;
+    }
+
+    // Верхние levels уровней стороны: цена, суммарное количество, число ордеров
+    [[nodiscard]] std::vector<DepthLevel> getDepth(const std::string& symbol, Side side, size_t levels) const {
+        std::vector<DepthLevel> depth(levels);
+        const OrderBookHashMap* book = books_.find(symbol);
+        depth.resize(book ? book->depth(side, depth) : 0);
+        return depth;
+    }
+
+    // Без аллокаций: заполняет до out.size() уровней, возвращает их число
+    size_t getDepth(SymbolId symbol_id, Side side, std::span<DepthLevel> out) const {
+        return books_.book(symbol_id).depth(side, out);
+    }
+
+    // Снимок всех книг для быстрого рестарта, см. BookSnapshot.h.
+    // false - имя символа не помещается в снимок
+    bool saveSnapshot(BookSnapshotWriter& out) const {
+        out.begin(next_timestamp_);
+        for (SymbolId symbol_id = 0; symbol_id < books_.size(); ++symbol_id) {
+            if (!out.beginSymbol(books_.registry().name(symbol_id))) return false;
+            books_.book(symbol_id).saveLevels(out);
+        }
+        return true;
+    }
+
+    // Только в движок без ордеров; уровни строятся целиком, без addBuyOrder
+    // на каждый ордер. false - снимок поврежден или не подходит движку
+    // (символы зарегистрированы в другом порядке, повтор id), такой движок
+    // остается недостроенным и не годится для работы
+    bool restoreSnapshot(BookSnapshotReader& in) {
+        if (getBuyOrderCount() + getSellOrderCount() != 0) return false;
+        order_index_.reserve(in.header().order_count);
+
+        std::string_view name;
+        for (SymbolId expected = 0; in.nextSymbol(name); ++expected) {
+            const SymbolId symbol_id = registerSymbol(std::string(name));
+            if (symbol_id != expected) return false;
+            auto& book = books_.book(symbol_id);
+            SnapshotLevelView level;
+            while (in.nextLevel(level)) {
+                auto first = book.restoreLevel(level.side, level.price, level.orders);
+                for (size_t i = 0; i < level.orders.size(); ++i) {
+                    OrderLocation location{{first.level, first.seq + i}, symbol_id, level.side};
+                    if (!order_index_.try_emplace(level.orders[i].order_id, location).second) return false;
+                }
+            }
+            top_of_book_.publish(symbol_id, book);
+        }
+        next_timestamp_ = in.header().next_timestamp;
+        return in.complete();
+    }
+
+    // Инкрементальные L2-обновления: одна пачка на submitOrder/cancelOrder/modifyOrder
+    void setL2Callback(L2Publisher::Callback callback) {
+        l2_.setCallback(std::move(callback));
+    }
+
+    void enableL2Updates(bool enabled = true) {
+        l2_.setEnabled(enabled);
+    }
+
+    [[nodiscard]] std::span<const L2Update> getL2Updates() const {
+        return l2_.updates();
     }
 
-    static void clearTrades() {
-        // trades_.clear();
+    // L3-лента: события по каждому ордеру в предвыделенное SPSC-кольцо
+    void enableL3Feed(size_t capacity = L3Feed::DEFAULT_CAPACITY) {
+        l3_.enable(capacity);
+    }
+
+    // Можно вызывать из потока-потребителя
+    bool pollL3Event(L3Event& event) {
+        return l3_.poll(event);
+    }
+
+    [[nodiscard]] uint64_t getL3DroppedEvents() const {
+        return l3_.dropped();
+    }
+
+    // Снимок лучших цен под seqlock, обновляется после каждой операции
+    void enableTopOfBook(bool enabled = true) {
+        top_of_book_.setEnabled(enabled);
+    }
+
+    // Ссылку можно взять один раз после регистрации символа и читать из любого потока
+    [[nodiscard]] const SeqLock<TopOfBook>& topOfBookSnapshot(SymbolId symbol_id) const {
+        return top_of_book_.snapshot(symbol_id);
+    }
+
+    [[nodiscard]] TopOfBook getTopOfBook(SymbolId symbol_id) const {
+        return top_of_book_.snapshot(symbol_id).load();
+    }
+
+    // Статистика движка, только с политикой EngineStats (см. EngineStats.h).
+    // Снимок обновляется раз в N операций, ссылку можно читать из любого потока
+    [[nodiscard]] const SeqLock<EngineStatsSnapshot>& statsSnapshot() const requires Stats::ENABLED {
+        return stats_.snapshot();
+    }
+
+    [[nodiscard]] EngineStatsSnapshot getStats() const requires Stats::ENABLED {
+        return stats_.snapshot().load();
+    }
+
+    // Только поток матчинга: N = 1 - публикация после каждой операции
+    void setStatsPublishInterval(uint32_t operations) requires Stats::ENABLED {
+        stats_.setPublishInterval(operations);
+    }
+
+    // Только поток матчинга: публикует счетчики сейчас, не дожидаясь N операций
+    void publishStats() requires Stats::ENABLED {
+        stats_.publish(getBuyLevelCount() + getSellLevelCount(), 0);
+    }
+
+    void clearTrades() {
+        if constexpr (BatchingTradeSink<Sink>) {
+            sink_.clear();
+        }
+    }
+
+    // Сделки последнего ордера, при сбросе раз в N ордеров - всей пачки
+    [[nodiscard]] std::span<const Trade> getTrades() const requires BatchingTradeSink<Sink> {
+        return sink_.trades();
     }
 
 private:
     void matchOrder(std::unique_ptr<Order> order) {
+        OrderBookHashMap& book = books_.book(order->symbol_id);
         if (order->type == OrderType::MARKET) {
-            matchMarketOrder(std::move(order));
+            matchMarketOrder(book, std::move(order));
         } else {
-            matchLimitOrder(std::move(order));
+            matchLimitOrder(book, std::move(order));
         }
     }
 
-    void matchMarketOrder(std::unique_ptr<Order> order) {
+    void matchMarketOrder(OrderBookHashMap& book, std::unique_ptr<Order> order) {
         if (order->side == Side::BUY) {
             while (order->quantity > 0 && !book.sell_levels.empty()) {
                 Order* best_sell = book.getBestSell();
@@ -136,8 +554,13 @@ private:
                 order->quantity -= trade_qty;
                 best_sell->quantity -= trade_qty;
 
+                l2_.touch(book, Side::SELL, best_sell->price);
+                l3_.execute(best_sell->symbol_id, Side::SELL, best_sell->order_id, best_sell->price, trade_qty, next_timestamp_);
                 if (best_sell->quantity == 0) {
+                    order_index_.erase(best_sell->order_id);
                     book.removeSellOrder(best_sell->price, trade_qty);
+                } else {
+                    book.reduceBestSell(trade_qty);
                 }
             }
         } else {
@@ -150,15 +573,20 @@ private:
                 order->quantity -= trade_qty;
                 best_buy->quantity -= trade_qty;
 
+                l2_.touch(book, Side::BUY, best_buy->price);
+                l3_.execute(best_buy->symbol_id, Side::BUY, best_buy->order_id, best_buy->price, trade_qty, next_timestamp_);
                 if (best_buy->quantity == 0) {
+                    order_index_.erase(best_buy->order_id);
                     book.removeBuyOrder(best_buy->price, trade_qty);
+                } else {
+                    book.reduceBestBuy(trade_qty);
                 }
             }
         }
         // order автоматически удалится при выходе из функции
     }
 
-    void matchLimitOrder(std::unique_ptr<Order> order) {
+    void matchLimitOrder(OrderBookHashMap& book, std::unique_ptr<Order> order) {
         if (order->side == Side::BUY) {
             while (order->quantity > 0 && !book.sell_levels.empty()) {
                 Order* best_sell = book.getBestSell();
@@ -173,13 +601,24 @@ private:
                 order->quantity -= trade_qty;
                 best_sell->quantity -= trade_qty;
 
+                l2_.touch(book, Side::SELL, best_sell->price);
+                l3_.execute(best_sell->symbol_id, Side::SELL, best_sell->order_id, best_sell->price, trade_qty, next_timestamp_);
                 if (best_sell->quantity == 0) {
+                    order_index_.erase(best_sell->order_id);
                     book.removeSellOrder(best_sell->price, trade_qty);
+                } else {
+                    book.reduceBestSell(trade_qty);
                 }
             }
 
             if (order->quantity > 0) {
-                book.addBuyOrder(std::move(order));  // передаем владение
+                uint64_t order_id = order->order_id;
+                SymbolId symbol_id = order->symbol_id;
+                l2_.touch(book, Side::BUY, order->price);
+                l3_.add(order->symbol_id, Side::BUY, order->order_id, order->price, order->quantity, next_timestamp_);
+                auto ref = book.addBuyOrder(std::move(order));  // передаем владение
+                stats_.onRest(ref.level->order_count);
+                order_index_.insert_or_assign(order_id, OrderLocation{ref, symbol_id, Side::BUY});
             }
         } else {
             while (order->quantity > 0 && !book.buy_levels.empty()) {
@@ -195,13 +634,24 @@ private:
                 order->quantity -= trade_qty;
                 best_buy->quantity -= trade_qty;
 
+                l2_.touch(book, Side::BUY, best_buy->price);
+                l3_.execute(best_buy->symbol_id, Side::BUY, best_buy->order_id, best_buy->price, trade_qty, next_timestamp_);
                 if (best_buy->quantity == 0) {
+                    order_index_.erase(best_buy->order_id);
                     book.removeBuyOrder(best_buy->price, trade_qty);
+                } else {
+                    book.reduceBestBuy(trade_qty);
                 }
             }
 
             if (order->quantity > 0) {
-                book.addSellOrder(std::move(order));
+                uint64_t order_id = order->order_id;
+                SymbolId symbol_id = order->symbol_id;
+                l2_.touch(book, Side::SELL, order->price);
+                l3_.add(order->symbol_id, Side::SELL, order->order_id, order->price, order->quantity, next_timestamp_);
+                auto ref = book.addSellOrder(std::move(order));
+                stats_.onRest(ref.level->order_count);
+                order_index_.insert_or_assign(order_id, OrderLocation{ref, symbol_id, Side::SELL});
             }
         }
     }
@@ -216,12 +666,30 @@ private:
         Trade trade(buy_order->order_id, sell_order->order_id,
                     price, quantity, ++next_timestamp_);
 
-        if (trade_callback_) {
-            trade_callback_(trade);
+        sink_.onTrade(trade);
+        stats_.onFill(price);
+    }
+
+    void publishStatsIfDue() {
+        if constexpr (Stats::ENABLED) {
+            if (stats_.tick()) publishStats();
         }
     }
 
-    OrderBookHashMap book;
-    TradeCallback trade_callback_;
+    struct OrderLocation {
+        OrderBookHashMap::OrderRef ref;
+        SymbolId symbol_id;
+        Side side;
+    };
+
+    PerSymbolBooks<OrderBookHashMap> books_;
+    std::unordered_map<uint64_t, OrderLocation> order_index_;
+    Sink sink_;
+    L2Publisher l2_;
+    L3Feed l3_;
     uint64_t next_timestamp_;
-};
\ No newline at end of file
+    TopOfBookBoard top_of_book_;
+    [[no_unique_address]] Stats stats_;
+};
+
+using MatchingEngineV2 = BasicMatchingEngineV2<>;
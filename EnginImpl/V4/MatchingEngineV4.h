@@ -1,105 +1,223 @@
 #pragma once
+#include "../../EngineConcept/MarketData.h"
 #include "../../EngineConcept/Order.h"
+#include "../../EngineConcept/SymbolRegistry.h"
+#include "../../EngineConcept/TradeSink.h"
+#include "../../EngineCommon/BookSnapshot.h"
+#include "../../EngineCommon/EngineStats.h"
+#include "../../EngineCommon/HierarchicalBitset.h"
+#include "../../EngineCommon/L2Publisher.h"
+#include "../../EngineCommon/L3Feed.h"
+#include "../../EngineCommon/LevelReclaimer.h"
+#include "../../EngineCommon/OrderIndex.h"
+#include "../../EngineCommon/OrderPool.h"
+#include "../../EngineCommon/TopOfBook.h"
 #include <map>
 #include <memory>
 #include <deque>
+#include <algorithm>
+#include <bit>
 #include <functional>
 #include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 
 class OrderBookHashMapV4 {
-private:
-    //std::array<char, 2 * 1024 * 1024> buffer_;
-    static constexpr size_t INITIAL_CAPACITY = 131072;
 public:
+    // Буферы опустевших уровней. Новый или растущий уровень сначала берет
+    // буфер отсюда, поэтому при блуждании цены память книги следует за
+    // реальной глубиной, а не за числом затронутых тиков.
+    class LevelBufferPool {
+    public:
+        static constexpr size_t MIN_LEVEL_CAPACITY = 8;
+        static constexpr size_t MAX_POOLED_BUFFERS = 256;
+        static constexpr size_t MAX_POOLED_CAPACITY = 4096;  // большие буферы отдаем аллокатору
+
+        // Размер буфера - степень двойки не меньше min_capacity
+        std::vector<OrderRecord*> acquire(size_t min_capacity) {
+            if (!free_.empty() && free_.back().size() >= min_capacity) {
+                std::vector<OrderRecord*> buffer = std::move(free_.back());
+                free_.pop_back();
+                return buffer;
+            }
+            return std::vector<OrderRecord*>(std::bit_ceil(std::max(min_capacity, MIN_LEVEL_CAPACITY)));
+        }
+
+        void release(std::vector<OrderRecord*>&& buffer) {
+            if (buffer.empty() || buffer.size() > MAX_POOLED_CAPACITY || free_.size() >= MAX_POOLED_BUFFERS) {
+                return;  // буфер освободится при выходе из функции
+            }
+            free_.push_back(std::move(buffer));
+        }
+
+        [[nodiscard]] size_t pooledBuffers() const {
+            return free_.size();
+        }
+
+        // Кольцо уровня переехало в буфер вдвое больше
+        void countResize() {
+            ++resizes_;
+        }
+
+        [[nodiscard]] uint64_t resizes() const {
+            return resizes_;
+        }
+
+    private:
+        std::vector<std::vector<OrderRecord*>> free_;
+        uint64_t resizes_ = 0;
+    };
+
+    // Кольцо указателей: размер буфера - степень двойки, у пустого уровня
+    // буфера нет совсем
     struct PriceLevel {
         int price;
-        std::vector<std::unique_ptr<Order>> orders;
-        size_t head_idx;  // индекс следующего элемента для удаления
-        size_t tail_idx;  // индекс следующего места для вставки
+        std::vector<OrderRecord*> orders;  // записи живут в пуле движка, nullptr - отмененный слот
+        size_t head_idx;  // индекс головы очереди
+        size_t count;     // занятые слоты от головы, включая отмененные
         uint64_t total_quantity;
+        uint32_t order_count;  // живые ордера, без отмененных слотов
+        uint64_t popped;  // сколько ордеров снято с головы = порядковый номер front()
+        uint64_t emptied_at;  // метка EmptyLevelReclaimer, когда уровень опустел последний раз
 
-        PriceLevel() : price(0), head_idx(0), tail_idx(0), total_quantity(0) {
-            orders.reserve(INITIAL_CAPACITY);
-            orders.resize(INITIAL_CAPACITY);
-        }
+        PriceLevel()
+                : price(0), head_idx(0), count(0), total_quantity(0), order_count(0), popped(0), emptied_at(0) {}
 
-        explicit PriceLevel(int p) : price(p), head_idx(0), tail_idx(0), total_quantity(0) {
-            orders.reserve(INITIAL_CAPACITY);
-            orders.resize(INITIAL_CAPACITY);
-        }
+        explicit PriceLevel(int p)
+                : price(p), head_idx(0), count(0), total_quantity(0), order_count(0), popped(0), emptied_at(0) {}
 
         [[nodiscard]] bool empty() const {
-            return head_idx == tail_idx;
+            return count == 0;
         }
 
         [[nodiscard]] size_t size() const {
-            if (tail_idx >= head_idx) {
-                return tail_idx - head_idx;
-            } else {
-                return orders.size() - head_idx + tail_idx;
-            }
+            return count;
         }
 
-        void push_back(std::unique_ptr<Order> order) {
-            orders[tail_idx] = std::move(order);
-            tail_idx = (tail_idx + 1) % orders.size();
+        [[nodiscard]] size_t capacity() const {
+            return orders.size();
+        }
 
-            // Проверка переполнения: если tail догнал head
-            if (tail_idx == head_idx) {
-                resize();
+        void push_back(OrderRecord* order, LevelBufferPool& pool) {
+            if (count == orders.size()) {
+                grow(pool);
             }
+            orders[(head_idx + count) & (orders.size() - 1)] = order;
+            ++count;
         }
 
-        std::unique_ptr<Order>& front() {
+        OrderRecord*& front() {
             return orders[head_idx];
         }
 
-        void pop_front() {
-            //orders[head_idx].reset();  // освобождаем память
-            head_idx = (head_idx + 1) % orders.size();
+        // Порядковый номер, который получит следующий push_back
+        [[nodiscard]] uint64_t next_seq() const {
+            return popped + count;
         }
 
-    private:
-        void resize() {
-            size_t old_size = orders.size();
-            size_t new_size = old_size * 2;
-            //std::cout << "resize from " << orders.size() << " to " << old_size * 2;
-            std::vector<std::unique_ptr<Order>> new_orders;
-            new_orders.reserve(new_size);
-            new_orders.resize(new_size);
+        OrderRecord*& at(uint64_t seq) {
+            return orders[(head_idx + (seq - popped)) & (orders.size() - 1)];
+        }
 
-            // Resize вызывается только когда tail догнал head (буфер полон)
-            // Данные всегда в двух кусках: [head...end) и [0...tail)
+        // Отмененные ордера остаются пустыми слотами в середине буфера,
+        // голова уровня всегда указывает на живой ордер
+        void pop_front() {
+            do {
+                head_idx = (head_idx + 1) & (orders.size() - 1);
+                ++popped;
+                --count;
+            } while (count != 0 && !orders[head_idx]);
+        }
 
-            size_t first_part = old_size - head_idx;  // от head до конца
-            size_t second_part = tail_idx;             // от начала до tail (который == head)
+        // Извлекает ордер из слота, O(1) без сдвига очереди
+        OrderRecord* take(uint64_t seq) {
+            OrderRecord* order = std::exchange(at(seq), nullptr);
+            total_quantity -= order->quantity;
+            --order_count;
 
-            // Копируем первую часть в конец нового массива
-            std::move(orders.begin() + head_idx,
-                      orders.end(),
-                      new_orders.begin() + (new_size - first_part));
+            if (seq == popped) {
+                pop_front();
+            } else {
+                // голова жива, поэтому цикл останавливается не дальше нее
+                while (!orders[(head_idx + count - 1) & (orders.size() - 1)]) {
+                    --count;
+                }
+            }
+            return order;
+        }
 
-            // Копируем вторую часть в начало нового массива
-            std::move(orders.begin(),
-                      orders.begin() + tail_idx,
-                      new_orders.begin());
+        // Восстановление из снимка: пустой уровень сразу получает буфер под
+        // все ордера, без удвоений по одному push_back
+        void assign(std::span<OrderRecord* const> records, LevelBufferPool& pool) {
+            pool.release(std::exchange(orders, pool.acquire(records.size())));
+            std::copy(records.begin(), records.end(), orders.begin());
+            head_idx = 0;
+            count = records.size();
+            for (const OrderRecord* order : records) total_quantity += order->quantity;
+            order_count = static_cast<uint32_t>(records.size());
+        }
 
-            // Теперь максимальный разрыв между tail и head
-            head_idx = new_size - first_part;
-            tail_idx = second_part;
+        // Опустевший уровень отдает буфер в пул книги
+        void releaseStorage(LevelBufferPool& pool) {
+            head_idx = 0;
+            pool.release(std::exchange(orders, {}));
+        }
 
-            orders = std::move(new_orders);
+    private:
+        void grow(LevelBufferPool& pool) {
+            if (!orders.empty()) pool.countResize();  // первый буфер уровня - не перевыделение
+            std::vector<OrderRecord*> new_orders = pool.acquire(orders.size() * 2);
+            for (size_t i = 0; i < count; ++i) {
+                new_orders[i] = orders[(head_idx + i) & (orders.size() - 1)];
+            }
+            pool.release(std::exchange(orders, std::move(new_orders)));
+            head_idx = 0;
         }
     };
 
+    // Положение ордера в книге: уровень + порядковый номер в его очереди
+    struct OrderRef {
+        PriceLevel* level;
+        uint64_t seq;
+    };
+
     std::map<int, PriceLevel, std::greater<>> buy_levels;
     std::map<int, PriceLevel, std::less<>> sell_levels;
 
     std::optional<int> cached_best_buy_price;
     std::optional<int> cached_best_sell_price;
 
-    void addBuyOrder(std::unique_ptr<Order> order) {
+    // Узлы map не переезжают: лучший уровень держим указателем, снимок
+    // лучших цен и частичное исполнение головы обходятся без поиска по дереву
+    PriceLevel* cached_best_buy_level = nullptr;
+    PriceLevel* cached_best_sell_level = nullptr;
+
+    // Непустые уровни: следующий лучший уровень без прохода по пустым
+    PriceOccupancyIndex buy_occupancy;
+    PriceOccupancyIndex sell_occupancy;
+
+    // Пустые уровни у лучшей цены живут в map до переиспользования,
+    // остальные удаляются, см. EmptyLevelReclaimer
+    EmptyLevelReclaimer buy_reclaimer;
+    EmptyLevelReclaimer sell_reclaimer;
+
+    size_t buy_order_count = 0;
+    size_t sell_order_count = 0;
+    size_t buy_level_count = 0;   // только непустые уровни
+    size_t sell_level_count = 0;
+
+    LevelBufferPool level_buffers;
+
+    // Сколько пустых уровней на сторону книга держит у лучшей цены
+    void setMaxRetainedEmptyLevels(size_t levels) {
+        buy_reclaimer.setMaxRetained(levels);
+        sell_reclaimer.setMaxRetained(levels);
+    }
+
+    OrderRef addBuyOrder(OrderRecord* order) {
         int price = order->price;
         uint64_t quantity = order->quantity;
 
@@ -121,13 +239,21 @@ public:
                 price,
                 price
         );
+        if (price == *cached_best_buy_price) cached_best_buy_level = &it->second;
+        if (it->second.empty()) {
+            buy_occupancy.markNonEmpty(price);
+            ++buy_level_count;
+        }
 
-
-        it->second.push_back(std::move(order));
+        uint64_t seq = it->second.next_seq();
+        it->second.push_back(order, level_buffers);
         it->second.total_quantity += quantity;
+        ++it->second.order_count;
+        ++buy_order_count;
+        return {&it->second, seq};
     }
 
-    void addSellOrder(std::unique_ptr<Order> order) {
+    OrderRef addSellOrder(OrderRecord* order) {
         int price = order->price;
         uint64_t quantity = order->quantity;
 
@@ -145,9 +271,18 @@ public:
                 price,
                 price
         );
+        if (price == *cached_best_sell_price) cached_best_sell_level = &it->second;
+        if (it->second.empty()) {
+            sell_occupancy.markNonEmpty(price);
+            ++sell_level_count;
+        }
 
-        it->second.push_back(std::move(order));
+        uint64_t seq = it->second.next_seq();
+        it->second.push_back(order, level_buffers);
         it->second.total_quantity += quantity;
+        ++it->second.order_count;
+        ++sell_order_count;
+        return {&it->second, seq};
     }
 
     void removeBuyOrder(int price, uint64_t quantity) {
@@ -157,24 +292,19 @@ public:
         auto& level = it->second;
         level.pop_front();
         level.total_quantity -= quantity;
-
-        // Если опустошили кешированный уровень - находим следующий лучший
-        if (level.empty() &&
-            cached_best_buy_price.has_value() &&
-            cached_best_buy_price.value() == price) {
-
-            // Ищем следующий непустой уровень
-            cached_best_buy_price.reset();
-            auto next_it = it;
-            ++next_it;  // O(1) в большинстве случаев
-
-            while (next_it != buy_levels.end()) {
-                if (!next_it->second.empty()) {
-                    cached_best_buy_price = next_it->first;
-                    break;
-                }
-                ++next_it;
+        --level.order_count;
+        --buy_order_count;
+
+        if (level.empty()) {
+            --buy_level_count;
+            level.releaseStorage(level_buffers);
+            buy_occupancy.markEmpty(price);
+            // Если опустошили кешированный уровень - находим следующий лучший
+            if (cached_best_buy_price.has_value() &&
+                cached_best_buy_price.value() == price) {
+                findNextBestBuy(it);
             }
+            reclaimLevel(buy_levels, buy_reclaimer, it, cached_best_buy_price);
         }
     }
 
@@ -185,185 +315,742 @@ public:
         auto& level = it->second;
         level.pop_front();
         level.total_quantity -= quantity;
+        --level.order_count;
+        --sell_order_count;
+
+        if (level.empty()) {
+            --sell_level_count;
+            level.releaseStorage(level_buffers);
+            sell_occupancy.markEmpty(price);
+            // Если опустошили кешированный уровень - находим следующий лучший
+            if (cached_best_sell_price.has_value() &&
+                cached_best_sell_price.value() == price) {
+                findNextBestSell(it);
+            }
+            reclaimLevel(sell_levels, sell_reclaimer, it, cached_best_sell_price);
+        }
+    }
 
-        // Если опустошили кешированный уровень - находим следующий лучший
-        if (level.empty() &&
-            cached_best_sell_price.has_value() &&
-            cached_best_sell_price.value() == price) {
+    [[nodiscard]] static OrderRecord* getOrder(OrderRef ref) {
+        return ref.level->at(ref.seq);
+    }
 
-            cached_best_sell_price.reset();
+    static void reduceOrderQuantity(OrderRef ref, uint64_t new_quantity) {
+        OrderRecord* order = getOrder(ref);
+        ref.level->total_quantity -= order->quantity - new_quantity;
+        order->quantity = static_cast<uint32_t>(new_quantity);
+    }
 
-            auto next_it = it;
-            ++next_it;  // O(1) в большинстве случаев
+    // O(1): слот становится пустым, поиск следующего лучшего уровня -
+    // только если отменили последний ордер кешированного уровня
+    OrderRecord* cancelBuyOrder(OrderRef ref) {
+        OrderRecord* order = ref.level->take(ref.seq);
+        int price = ref.level->price;
+        --buy_order_count;
+        if (ref.level->empty()) {
+            --buy_level_count;
+            ref.level->releaseStorage(level_buffers);
+            buy_occupancy.markEmpty(price);
+            auto it = buy_levels.find(price);
+            if (cached_best_buy_price.has_value() &&
+                cached_best_buy_price.value() == price) {
+                findNextBestBuy(it);
+            }
+            reclaimLevel(buy_levels, buy_reclaimer, it, cached_best_buy_price);
+        }
+        return order;
+    }
 
-            while (next_it != sell_levels.end()) {
-                if (!next_it->second.empty()) {
-                    cached_best_sell_price = next_it->first;
-                    break;
-                }
-                ++next_it;
+    OrderRecord* cancelSellOrder(OrderRef ref) {
+        OrderRecord* order = ref.level->take(ref.seq);
+        int price = ref.level->price;
+        --sell_order_count;
+        if (ref.level->empty()) {
+            --sell_level_count;
+            ref.level->releaseStorage(level_buffers);
+            sell_occupancy.markEmpty(price);
+            auto it = sell_levels.find(price);
+            if (cached_best_sell_price.has_value() &&
+                cached_best_sell_price.value() == price) {
+                findNextBestSell(it);
+            }
+            reclaimLevel(sell_levels, sell_reclaimer, it, cached_best_sell_price);
+        }
+        return order;
+    }
+
+    // Частичное исполнение головы лучшего уровня: ордер остается в очереди
+    void reduceBestBuy(uint64_t quantity) {
+        cached_best_buy_level->total_quantity -= quantity;
+    }
+
+    void reduceBestSell(uint64_t quantity) {
+        cached_best_sell_level->total_quantity -= quantity;
+    }
+
+    // Агрегат одного уровня; нет уровня или он пуст - нулевые счетчики
+    [[nodiscard]] DepthLevel levelAt(Side side, int price) const {
+        return side == Side::BUY ? aggregateAt(buy_levels, price) : aggregateAt(sell_levels, price);
+    }
+
+    // Агрегаты верхних уровней стороны, без прохода по ордерам
+    // Для снимка лучших цен: пустые уровни у лучшей цены не обходим
+    [[nodiscard]] TopOfBook topOfBook() const {
+        TopOfBook top{};
+        if (cached_best_buy_level != nullptr) top.bid = aggregateOf(*cached_best_buy_level);
+        if (cached_best_sell_level != nullptr) top.ask = aggregateOf(*cached_best_sell_level);
+        return top;
+    }
+
+    size_t depth(Side side, std::span<DepthLevel> out) const {
+        return side == Side::BUY ? collectDepth(buy_levels, out) : collectDepth(sell_levels, out);
+    }
+
+    // Снимок: непустые уровни от лучшего, ордера в порядке приоритета
+    void saveLevels(BookSnapshotWriter& out) const {
+        saveSide(buy_levels, Side::BUY, out);
+        saveSide(sell_levels, Side::SELL, out);
+    }
+
+    // Уровень из снимка целиком, записи уже в пуле движка. Уровни приходят от
+    // лучшего к худшему, то есть в порядке map: вставка с подсказкой end()
+    // не ищет по дереву. Возвращает ссылку на первый ордер, остальные идут с seq + i
+    OrderRef restoreLevel(Side side, int price, std::span<OrderRecord* const> orders) {
+        PriceLevel& level = side == Side::BUY
+                ? buy_levels.emplace_hint(buy_levels.end(), price, price)->second
+                : sell_levels.emplace_hint(sell_levels.end(), price, price)->second;
+        uint64_t seq = level.next_seq();
+        level.assign(orders, level_buffers);
+
+        if (side == Side::BUY) {
+            buy_occupancy.markNonEmpty(price);
+            ++buy_level_count;
+            buy_order_count += orders.size();
+            if (!cached_best_buy_price.has_value() || price > cached_best_buy_price.value()) {
+                cached_best_buy_price = price;
+                cached_best_buy_level = &level;
+            }
+        } else {
+            sell_occupancy.markNonEmpty(price);
+            ++sell_level_count;
+            sell_order_count += orders.size();
+            if (!cached_best_sell_price.has_value() || price < cached_best_sell_price.value()) {
+                cached_best_sell_price = price;
+                cached_best_sell_level = &level;
             }
         }
+        return {&level, seq};
     }
 
-    [[nodiscard]] Order* getBestBuy() {
-        if (!cached_best_buy_price.has_value()) return nullptr;
+    [[nodiscard]] OrderRecord* getBestBuy() {
+        if (cached_best_buy_level == nullptr || cached_best_buy_level->empty()) return nullptr;
+        return cached_best_buy_level->front();
+    }
 
-        auto it = buy_levels.find(cached_best_buy_price.value());
-        if (it == buy_levels.end() || it->second.empty()) return nullptr;
+    [[nodiscard]] OrderRecord* getBestSell() {
+        if (cached_best_sell_level == nullptr || cached_best_sell_level->empty()) return nullptr;
+        return cached_best_sell_level->front();
+    }
 
-        return it->second.front().get();
+private:
+    static DepthLevel aggregateOf(const PriceLevel& level) {
+        return {level.price, level.order_count, level.total_quantity};
+    }
+
+    template<typename Levels>
+    static DepthLevel aggregateAt(const Levels& levels, int price) {
+        auto it = levels.find(price);
+        if (it == levels.end()) return {price, 0, 0};
+        return {price, it->second.order_count, it->second.total_quantity};
+    }
+
+    template<typename Levels>
+    static size_t collectDepth(const Levels& levels, std::span<DepthLevel> out) {
+        size_t filled = 0;
+        for (auto it = levels.begin(); it != levels.end() && filled < out.size(); ++it) {
+            if (it->second.order_count == 0) continue;  // пустой уровень ждет удаления
+            out[filled++] = {it->first, it->second.order_count, it->second.total_quantity};
+        }
+        return filled;
     }
 
-    [[nodiscard]] Order* getBestSell() {
-        if (!cached_best_sell_price.has_value()) return nullptr;
+    template<typename Levels>
+    static void saveSide(const Levels& levels, Side side, BookSnapshotWriter& out) {
+        for (const auto& [price, level] : levels) {
+            if (level.order_count == 0) continue;  // пустой уровень ждет удаления
+            out.beginLevel(side, price);
+            for (size_t i = 0; i < level.count; ++i) {
+                const OrderRecord* order = level.orders[(level.head_idx + i) & (level.orders.size() - 1)];
+                if (order) out.addOrder(*order);
+            }
+        }
+    }
+
+    // Уровень только что опустел: далеко от лучшей цены - удаляем сразу,
+    // иначе ставим в очередь, из которой вытесняется самый старый пустой уровень
+    template<typename Levels>
+    static void reclaimLevel(Levels& levels, EmptyLevelReclaimer& reclaimer,
+                             typename Levels::iterator it, std::optional<int> best_price) {
+        if (reclaimer.outsideBand(it->first, best_price)) {
+            levels.erase(it);
+            return;
+        }
+        uint64_t stamp = reclaimer.nextStamp();
+        it->second.emptied_at = stamp;
+        reclaimer.retain(it->first, stamp, [&levels](int price, uint64_t evicted_stamp) {
+            auto evicted = levels.find(price);
+            if (evicted != levels.end() && evicted->second.emptied_at == evicted_stamp &&
+                evicted->second.empty()) {
+                levels.erase(evicted);
+            }
+        });
+    }
 
-        auto it = sell_levels.find(cached_best_sell_price.value());
-        if (it == sell_levels.end() || it->second.empty()) return nullptr;
+    // Ищем следующий непустой уровень после опустошенного it. Внутри окна
+    // occupancy ответ дает битсет, по map идем только за пределами окна.
+    void findNextBestBuy(std::map<int, PriceLevel, std::greater<>>::iterator it) {
+        cached_best_buy_price.reset();
+        auto next_it = it;
+        ++next_it;
+
+        while (next_it != buy_levels.end()) {
+            if (buy_occupancy.covers(next_it->first)) {
+                cached_best_buy_price = buy_occupancy.findAtOrBelow(next_it->first);
+                if (cached_best_buy_price.has_value()) break;
+                next_it = buy_levels.upper_bound(buy_occupancy.lowestPrice());
+                continue;
+            }
+            if (!next_it->second.empty()) {
+                cached_best_buy_price = next_it->first;
+                break;
+            }
+            ++next_it;
+        }
+        cached_best_buy_level = cached_best_buy_price.has_value()
+                ? &buy_levels.find(*cached_best_buy_price)->second
+                : nullptr;
+    }
 
-        return it->second.front().get();
+    void findNextBestSell(std::map<int, PriceLevel, std::less<>>::iterator it) {
+        cached_best_sell_price.reset();
+        auto next_it = it;
+        ++next_it;
+
+        while (next_it != sell_levels.end()) {
+            if (sell_occupancy.covers(next_it->first)) {
+                cached_best_sell_price = sell_occupancy.findAtOrAbove(next_it->first);
+                if (cached_best_sell_price.has_value()) break;
+                next_it = sell_levels.upper_bound(sell_occupancy.highestPrice());
+                continue;
+            }
+            if (!next_it->second.empty()) {
+                cached_best_sell_price = next_it->first;
+                break;
+            }
+            ++next_it;
+        }
+        cached_best_sell_level = cached_best_sell_price.has_value()
+                ? &sell_levels.find(*cached_best_sell_price)->second
+                : nullptr;
     }
 };
 
-class MatchingEngineV4 {
+template<TradeSink Sink = BufferedTradeSink, typename Stats = NoEngineStats>
+class BasicMatchingEngineV4 {
 public:
     using TradeCallback = std::function<void(const Trade&)>;
+    using PoolStats = OrderPool<OrderRecord>::Stats;
 
-    MatchingEngineV4() : next_timestamp_(0) {}
+    static constexpr size_t DEFAULT_POOL_CAPACITY = OrderPool<OrderRecord>::DEFAULT_SLAB_SIZE;
+
+    // pool_capacity - ожидаемая пиковая глубина книги: пока она не превышена,
+    // ни пул ордеров, ни индекс по id не обращаются к аллокатору
+    explicit BasicMatchingEngineV4(size_t pool_capacity = DEFAULT_POOL_CAPACITY)
+            : order_pool_(pool_capacity), order_index_(pool_capacity), next_timestamp_(0) {}
+
+    explicit BasicMatchingEngineV4(Sink sink, size_t pool_capacity = DEFAULT_POOL_CAPACITY)
+            : order_pool_(pool_capacity), order_index_(pool_capacity),
+              sink_(std::move(sink)), next_timestamp_(0) {}
 
     static const char* name() {
-        return "MatchingEngineV2";
+        return "MatchingEngineV4";
+    }
+
+    // Только для sink с type erasure, см. CallbackTradeSink
+    void setTradeCallback(TradeCallback callback) requires CallbackSettableSink<Sink> {
+        sink_.setCallback(std::move(callback));
+    }
+
+    Sink& tradeSink() {
+        return sink_;
+    }
+
+    // Принимаем unique_ptr: в пул копируется только остаток, который встает в книгу
+    bool submitOrder(std::unique_ptr<Order> order) {
+        return submitOrder(*order);
+    }
+
+    // Ордер по значению: на установившемся режиме без аллокаций.
+    // false - ордер отклонен целиком: количество не помещается в OrderRecord
+    // или ордер с таким id еще стоит в книге
+    bool submitOrder(const Order& order) {
+        if (order.quantity > MAX_ORDER_QUANTITY) return false;
+        OrderRecord record = order.toRecord();
+        if (order.symbol_id == INVALID_SYMBOL_ID) {
+            // медленный путь: символ не был зарегистрирован заранее
+            record.symbol_id = registerSymbol(order.symbol);
+        }
+        return submitOrder(record);
+    }
+
+    // Компактная запись, symbol_id уже интернирован через registerSymbol.
+    // false - ордер с таким id еще стоит в книге
+    bool submitOrder(const OrderRecord& record) {
+        if (order_index_.find(record.order_id) != nullptr) return false;
+        OrderRecord incoming = record;
+        if (incoming.timestamp == 0) {
+            incoming.timestamp = ++next_timestamp_;
+        }
+        beginTradeBatch(sink_);
+        matchOrder(incoming);
+        endTradeBatch(sink_);
+        stats_.onMatchEnd();
+        l2_.publish(incoming.symbol_id, books_.book(incoming.symbol_id));
+        top_of_book_.publish(incoming.symbol_id, books_.book(incoming.symbol_id));
+        stats_.onOrder();
+        publishStatsIfDue();
+        return true;
     }
 
-    void setTradeCallback(TradeCallback callback) {
-        trade_callback_ = std::move(callback);
+    // Регистрируем символы на старте сессии, дальше ордера несут symbol_id
+    SymbolId registerSymbol(const std::string& symbol) {
+        SymbolId symbol_id = books_.registerSymbol(symbol);
+        top_of_book_.ensure(symbol_id);
+        return symbol_id;
     }
 
-    // Принимаем unique_ptr
-    void submitOrder(std::unique_ptr<Order> order) {
-        if (order->timestamp == 0) {
-            order->timestamp = ++next_timestamp_;
+    // Лимит задается по книге: активной бумаге нужен запас пустых уровней
+    // у рынка, тысячам редких хватит нескольких
+    void setMaxRetainedEmptyLevels(SymbolId symbol_id, size_t levels) {
+        books_.book(symbol_id).setMaxRetainedEmptyLevels(levels);
+    }
+
+    // Снятие ордера по id через индекс, без поиска по уровню
+    bool cancelOrder(uint64_t order_id) {
+        OrderLocation* found = order_index_.find(order_id);
+        if (found == nullptr) return false;
+
+        OrderLocation location = *found;
+        order_index_.erase(order_id);
+        auto& book = books_.book(location.symbol_id);
+        OrderRecord* resting = book.getOrder(location.ref);
+        l3_.cancel(location.symbol_id, location.side, order_id, resting->price, resting->quantity, next_timestamp_);
+        l2_.touch(book, location.side, location.ref.level->price);
+        if (location.side == Side::BUY) {
+            order_pool_.release(book.cancelBuyOrder(location.ref));
+        } else {
+            order_pool_.release(book.cancelSellOrder(location.ref));
+        }
+        l2_.publish(location.symbol_id, book);
+        top_of_book_.publish(location.symbol_id, book);
+        stats_.onCancel();
+        publishStatsIfDue();
+        return true;
+    }
+
+    // Уменьшение количества на той же цене сохраняет приоритет по времени,
+    // смена цены или увеличение количества - это снятие и новая постановка
+    bool modifyOrder(uint64_t order_id, uint64_t new_quantity, int new_price) {
+        if (new_quantity > MAX_ORDER_QUANTITY) return false;
+        if (new_quantity == 0) return cancelOrder(order_id);
+
+        OrderLocation* found = order_index_.find(order_id);
+        if (found == nullptr) return false;
+
+        OrderLocation location = *found;
+        auto& book = books_.book(location.symbol_id);
+        OrderRecord* resting = book.getOrder(location.ref);
+        if (new_price == resting->price && new_quantity <= resting->quantity) {
+            l2_.touch(book, location.side, resting->price);
+            book.reduceOrderQuantity(location.ref, new_quantity);
+            l3_.replace(location.symbol_id, location.side, order_id, resting->price, new_quantity, next_timestamp_);
+            l2_.publish(location.symbol_id, book);
+            top_of_book_.publish(location.symbol_id, book);
+            stats_.onModify();
+            publishStatsIfDue();
+            return true;
         }
-        matchOrder(std::move(order));
+
+        order_index_.erase(order_id);
+        l3_.cancel(location.symbol_id, location.side, order_id, resting->price, resting->quantity, next_timestamp_);
+        l2_.touch(book, location.side, resting->price);
+        OrderRecord* taken = location.side == Side::BUY
+                ? book.cancelBuyOrder(location.ref)
+                : book.cancelSellOrder(location.ref);
+        OrderRecord order = *taken;
+        order_pool_.release(taken);
+
+        order.price = new_price;
+        order.quantity = static_cast<uint32_t>(new_quantity);
+        order.timestamp = ++next_timestamp_;
+        beginTradeBatch(sink_);
+        matchOrder(order);  // новая цена может пересечь спред
+        endTradeBatch(sink_);
+        stats_.onMatchEnd();
+        l2_.publish(location.symbol_id, book);
+        top_of_book_.publish(location.symbol_id, book);
+        stats_.onModify();
+        publishStatsIfDue();
+        return true;
+    }
+
+    [[nodiscard]] PoolStats poolStats() const {
+        return order_pool_.stats();
     }
 
     [[nodiscard]] size_t getBuyOrderCount() const {
-        return book.buy_levels.size();
+        size_t count = 0;
+        for (const auto& book : books_) count += book.buy_order_count;
+        return count;
     }
 
     [[nodiscard]] size_t getSellOrderCount() const {
-        return book.sell_levels.size();
+        size_t count = 0;
+        for (const auto& book : books_) count += book.sell_order_count;
+        return count;
+    }
+
+    [[nodiscard]] size_t getBuyOrderCount(const std::string& symbol) const {
+        const OrderBookHashMapV4* book = books_.find(symbol);
+        return book ? book->buy_order_count : 0;
+    }
+
+    [[nodiscard]] size_t getSellOrderCount(const std::string& symbol) const {
+        const OrderBookHashMapV4* book = books_.find(symbol);
+        return book ? book->sell_order_count : 0;
+    }
+
+    // Непустые ценовые уровни по всем символам
+    [[nodiscard]] size_t getBuyLevelCount() const {
+        size_t count = 0;
+        for (const auto& book : books_) count += book.buy_level_count;
+        return count;
+    }
+
+    [[nodiscard]] size_t getSellLevelCount() const {
+        size_t count = 0;
+        for (const auto& book : books_) count += book.sell_level_count;
+        return count;
+    }
+
+    // Узлы map обеих сторон, включая пустые уровни, ожидающие удаления
+    [[nodiscard]] size_t getRetainedLevelCount() const {
+        size_t count = 0;
+        for (const auto& book : books_) count += book.buy_levels.size() + book.sell_levels.size();
+        return count;
+    }
+
+    // Перевыделения колец уровней по всем символам
+    [[nodiscard]] uint64_t getLevelResizes() const {
+        uint64_t count = 0;
+        for (const auto& book : books_) count += book.level_buffers.resizes();
+        return count;
+    }
+
+    // Верхние levels уровней стороны: цена, суммарное количество, число ордеров
+    [[nodiscard]] std::vector<DepthLevel> getDepth(const std::string& symbol, Side side, size_t levels) const {
+        std::vector<DepthLevel> depth(levels);
+        const OrderBookHashMapV4* book = books_.find(symbol);
+        depth.resize(book ? book->depth(side, depth) : 0);
+        return depth;
     }
 
-    static void clearTrades() {
-        // trades_.clear();
+    // Без аллокаций: заполняет до out.size() уровней, возвращает их число
+    size_t getDepth(SymbolId symbol_id, Side side, std::span<DepthLevel> out) const {
+        return books_.book(symbol_id).depth(side, out);
+    }
+
+    // Снимок всех книг для быстрого рестарта, см. BookSnapshot.h.
+    // false - имя символа не помещается в снимок
+    bool saveSnapshot(BookSnapshotWriter& out) const {
+        out.begin(next_timestamp_);
+        for (SymbolId symbol_id = 0; symbol_id < books_.size(); ++symbol_id) {
+            if (!out.beginSymbol(books_.registry().name(symbol_id))) return false;
+            books_.book(symbol_id).saveLevels(out);
+        }
+        return true;
+    }
+
+    // Только в движок без ордеров; записи уровня копируются в пул, кольцо
+    // уровня собирается целиком, без addBuyOrder на каждый ордер.
+    // false - снимок поврежден или не подходит движку (символы
+    // зарегистрированы в другом порядке, повтор id), такой движок остается
+    // недостроенным и не годится для работы
+    bool restoreSnapshot(BookSnapshotReader& in) {
+        if (getBuyOrderCount() + getSellOrderCount() != 0) return false;
+        order_index_.reserve(in.header().order_count);
+
+        std::vector<OrderRecord*> resting;
+        std::string_view name;
+        for (SymbolId expected = 0; in.nextSymbol(name); ++expected) {
+            const SymbolId symbol_id = registerSymbol(std::string(name));
+            if (symbol_id != expected) return false;
+            auto& book = books_.book(symbol_id);
+            SnapshotLevelView level;
+            while (in.nextLevel(level)) {
+                resting.clear();
+                for (const OrderRecord& order : level.orders) {
+                    resting.push_back(order_pool_.acquire(order));
+                }
+                auto first = book.restoreLevel(level.side, level.price, resting);
+                for (size_t i = 0; i < resting.size(); ++i) {
+                    const size_t indexed = order_index_.size();
+                    order_index_.insert_or_assign(resting[i]->order_id,
+                                                  OrderLocation{{first.level, first.seq + i}, symbol_id, level.side});
+                    if (order_index_.size() == indexed) return false;  // повтор id
+                }
+            }
+            top_of_book_.publish(symbol_id, book);
+        }
+        next_timestamp_ = in.header().next_timestamp;
+        return in.complete();
+    }
+
+    // Инкрементальные L2-обновления: одна пачка на submitOrder/cancelOrder/modifyOrder
+    void setL2Callback(L2Publisher::Callback callback) {
+        l2_.setCallback(std::move(callback));
+    }
+
+    void enableL2Updates(bool enabled = true) {
+        l2_.setEnabled(enabled);
+    }
+
+    [[nodiscard]] std::span<const L2Update> getL2Updates() const {
+        return l2_.updates();
+    }
+
+    // L3-лента: события по каждому ордеру в предвыделенное SPSC-кольцо
+    void enableL3Feed(size_t capacity = L3Feed::DEFAULT_CAPACITY) {
+        l3_.enable(capacity);
+    }
+
+    // Можно вызывать из потока-потребителя
+    bool pollL3Event(L3Event& event) {
+        return l3_.poll(event);
+    }
+
+    [[nodiscard]] uint64_t getL3DroppedEvents() const {
+        return l3_.dropped();
+    }
+
+    // Снимок лучших цен под seqlock, обновляется после каждой операции
+    void enableTopOfBook(bool enabled = true) {
+        top_of_book_.setEnabled(enabled);
+    }
+
+    // Ссылку можно взять один раз после регистрации символа и читать из любого потока
+    [[nodiscard]] const SeqLock<TopOfBook>& topOfBookSnapshot(SymbolId symbol_id) const {
+        return top_of_book_.snapshot(symbol_id);
+    }
+
+    [[nodiscard]] TopOfBook getTopOfBook(SymbolId symbol_id) const {
+        return top_of_book_.snapshot(symbol_id).load();
+    }
+
+    // Статистика движка, только с политикой EngineStats (см. EngineStats.h).
+    // Снимок обновляется раз в N операций, ссылку можно читать из любого потока
+    [[nodiscard]] const SeqLock<EngineStatsSnapshot>& statsSnapshot() const requires Stats::ENABLED {
+        return stats_.snapshot();
+    }
+
+    [[nodiscard]] EngineStatsSnapshot getStats() const requires Stats::ENABLED {
+        return stats_.snapshot().load();
+    }
+
+    // Только поток матчинга: N = 1 - публикация после каждой операции
+    void setStatsPublishInterval(uint32_t operations) requires Stats::ENABLED {
+        stats_.setPublishInterval(operations);
+    }
+
+    // Только поток матчинга: публикует счетчики сейчас, не дожидаясь N операций
+    void publishStats() requires Stats::ENABLED {
+        stats_.publish(getBuyLevelCount() + getSellLevelCount(), getLevelResizes());
+    }
+
+    void clearTrades() {
+        if constexpr (BatchingTradeSink<Sink>) {
+            sink_.clear();
+        }
+    }
+
+    // Сделки последнего ордера, при сбросе раз в N ордеров - всей пачки
+    [[nodiscard]] std::span<const Trade> getTrades() const requires BatchingTradeSink<Sink> {
+        return sink_.trades();
     }
 
 private:
-    void matchOrder(std::unique_ptr<Order> order) {
-        if (order->type == OrderType::MARKET) {
-            matchMarketOrder(std::move(order));
+    // Входящий ордер живет на стеке вызывающего, в пул попадает только
+    // неисполненный остаток лимитного ордера
+    void matchOrder(OrderRecord& order) {
+        OrderBookHashMapV4& book = books_.book(order.symbol_id);
+        if (order.type() == OrderType::MARKET) {
+            matchMarketOrder(book, order);
         } else {
-            matchLimitOrder(std::move(order));
+            matchLimitOrder(book, order);
         }
     }
 
-    void matchMarketOrder(std::unique_ptr<Order> order) {
-        if (order->side == Side::BUY) {
-            while (order->quantity > 0 && book.cached_best_sell_price.has_value()) {
-                Order* best_sell = book.getBestSell();
-                uint64_t trade_qty = std::min(order->quantity, best_sell->quantity);
+    void matchMarketOrder(OrderBookHashMapV4& book, OrderRecord& order) {
+        if (order.side() == Side::BUY) {
+            while (order.quantity > 0 && book.cached_best_sell_price.has_value()) {
+                OrderRecord* best_sell = book.getBestSell();
+                uint64_t trade_qty = std::min(order.quantity, best_sell->quantity);
 
-                executeTrade(order.get(), best_sell, best_sell->price, trade_qty);
+                executeTrade(&order, best_sell, best_sell->price, trade_qty);
 
-                order->quantity -= trade_qty;
+                order.quantity -= trade_qty;
                 best_sell->quantity -= trade_qty;
 
+                l2_.touch(book, Side::SELL, best_sell->price);
+                l3_.execute(best_sell->symbol_id, Side::SELL, best_sell->order_id, best_sell->price, trade_qty, next_timestamp_);
                 if (best_sell->quantity == 0) {
+                    order_index_.erase(best_sell->order_id);
                     book.removeSellOrder(best_sell->price, trade_qty);
+                    order_pool_.release(best_sell);
+                } else {
+                    book.reduceBestSell(trade_qty);
                 }
             }
         } else {
-            while (order->quantity > 0 && book.cached_best_buy_price.has_value()) {
-                Order* best_buy = book.getBestBuy();
-                uint64_t trade_qty = std::min(order->quantity, best_buy->quantity);
+            while (order.quantity > 0 && book.cached_best_buy_price.has_value()) {
+                OrderRecord* best_buy = book.getBestBuy();
+                uint64_t trade_qty = std::min(order.quantity, best_buy->quantity);
 
-                executeTrade(best_buy, order.get(), best_buy->price, trade_qty);
+                executeTrade(best_buy, &order, best_buy->price, trade_qty);
 
-                order->quantity -= trade_qty;
+                order.quantity -= trade_qty;
                 best_buy->quantity -= trade_qty;
 
+                l2_.touch(book, Side::BUY, best_buy->price);
+                l3_.execute(best_buy->symbol_id, Side::BUY, best_buy->order_id, best_buy->price, trade_qty, next_timestamp_);
                 if (best_buy->quantity == 0) {
+                    order_index_.erase(best_buy->order_id);
                     book.removeBuyOrder(best_buy->price, trade_qty);
+                    order_pool_.release(best_buy);
+                } else {
+                    book.reduceBestBuy(trade_qty);
                 }
             }
         }
-        // order автоматически удалится при выходе из функции
+        // неисполненный остаток рыночного ордера отбрасывается
     }
 
-    void matchLimitOrder(std::unique_ptr<Order> order) {
-        if (order->side == Side::BUY) {
-            while (order->quantity > 0 && book.cached_best_sell_price.has_value()) {
-                Order* best_sell = book.getBestSell();
+    void matchLimitOrder(OrderBookHashMapV4& book, OrderRecord& order) {
+        if (order.side() == Side::BUY) {
+            while (order.quantity > 0 && book.cached_best_sell_price.has_value()) {
+                OrderRecord* best_sell = book.getBestSell();
 
-                if (!canMatch(order.get(), best_sell)) {
+                if (!canMatch(&order, best_sell)) {
                     break;
                 }
 
-                uint64_t trade_qty = std::min(order->quantity, best_sell->quantity);
-                executeTrade(order.get(), best_sell, best_sell->price, trade_qty);
+                uint64_t trade_qty = std::min(order.quantity, best_sell->quantity);
+                executeTrade(&order, best_sell, best_sell->price, trade_qty);
 
-                order->quantity -= trade_qty;
+                order.quantity -= trade_qty;
                 best_sell->quantity -= trade_qty;
 
+                l2_.touch(book, Side::SELL, best_sell->price);
+                l3_.execute(best_sell->symbol_id, Side::SELL, best_sell->order_id, best_sell->price, trade_qty, next_timestamp_);
                 if (best_sell->quantity == 0) {
+                    order_index_.erase(best_sell->order_id);
                     book.removeSellOrder(best_sell->price, trade_qty);
+                    order_pool_.release(best_sell);
+                } else {
+                    book.reduceBestSell(trade_qty);
                 }
             }
 
-            if (order->quantity > 0) {
-                book.addBuyOrder(std::move(order));  // передаем владение
+            if (order.quantity > 0) {
+                OrderRecord* resting = order_pool_.acquire(order);
+                l2_.touch(book, Side::BUY, resting->price);
+                l3_.add(resting->symbol_id, Side::BUY, resting->order_id, resting->price, resting->quantity, next_timestamp_);
+                auto ref = book.addBuyOrder(resting);
+                stats_.onRest(ref.level->order_count);
+                order_index_.insert_or_assign(resting->order_id,
+                                              OrderLocation{ref, resting->symbol_id, Side::BUY});
             }
         } else {
-            while (order->quantity > 0 && book.cached_best_buy_price.has_value()) {
-                Order* best_buy = book.getBestBuy();
+            while (order.quantity > 0 && book.cached_best_buy_price.has_value()) {
+                OrderRecord* best_buy = book.getBestBuy();
 
-                if (!canMatch(best_buy, order.get())) {
+                if (!canMatch(best_buy, &order)) {
                     break;
                 }
 
-                uint64_t trade_qty = std::min(order->quantity, best_buy->quantity);
-                executeTrade(best_buy, order.get(), best_buy->price, trade_qty);
+                uint64_t trade_qty = std::min(order.quantity, best_buy->quantity);
+                executeTrade(best_buy, &order, best_buy->price, trade_qty);
 
-                order->quantity -= trade_qty;
+                order.quantity -= trade_qty;
                 best_buy->quantity -= trade_qty;
 
+                l2_.touch(book, Side::BUY, best_buy->price);
+                l3_.execute(best_buy->symbol_id, Side::BUY, best_buy->order_id, best_buy->price, trade_qty, next_timestamp_);
                 if (best_buy->quantity == 0) {
+                    order_index_.erase(best_buy->order_id);
                     book.removeBuyOrder(best_buy->price, trade_qty);
+                    order_pool_.release(best_buy);
+                } else {
+                    book.reduceBestBuy(trade_qty);
                 }
             }
 
-            if (order->quantity > 0) {
-                book.addSellOrder(std::move(order));
+            if (order.quantity > 0) {
+                OrderRecord* resting = order_pool_.acquire(order);
+                l2_.touch(book, Side::SELL, resting->price);
+                l3_.add(resting->symbol_id, Side::SELL, resting->order_id, resting->price, resting->quantity, next_timestamp_);
+                auto ref = book.addSellOrder(resting);
+                stats_.onRest(ref.level->order_count);
+                order_index_.insert_or_assign(resting->order_id,
+                                              OrderLocation{ref, resting->symbol_id, Side::SELL});
             }
         }
     }
 
-    [[nodiscard]] bool canMatch(const Order* buy, const Order* sell) const {
+    [[nodiscard]] bool canMatch(const OrderRecord* buy, const OrderRecord* sell) const {
         return sell != nullptr && buy != nullptr && buy->price >= sell->price;
     }
 
-    void executeTrade(const Order* buy_order, const Order* sell_order,
+    void executeTrade(const OrderRecord* buy_order, const OrderRecord* sell_order,
                       int price, uint64_t quantity) {
         Trade trade(buy_order->order_id, sell_order->order_id,
                     price, quantity, ++next_timestamp_);
 
-        if (trade_callback_) {
-            trade_callback_(trade);
+        sink_.onTrade(trade);
+        stats_.onFill(price);
+    }
+
+    void publishStatsIfDue() {
+        if constexpr (Stats::ENABLED) {
+            if (stats_.tick()) publishStats();
         }
     }
 
-    OrderBookHashMapV4 book;
-    TradeCallback trade_callback_;
+    struct OrderLocation {
+        OrderBookHashMapV4::OrderRef ref;
+        SymbolId symbol_id;
+        Side side;
+    };
+
+    PerSymbolBooks<OrderBookHashMapV4> books_;
+    OrderPool<OrderRecord> order_pool_;
+    OrderIdMap<OrderLocation> order_index_;
+    Sink sink_;
+    L2Publisher l2_;
+    L3Feed l3_;
     uint64_t next_timestamp_;
-};
\ No newline at end of file
+    TopOfBookBoard top_of_book_;
+    [[no_unique_address]] Stats stats_;
+};
+
+using MatchingEngineV4 = BasicMatchingEngineV4<>;
@@ -0,0 +1,946 @@
+#pragma once
+#include "../../EngineConcept/MarketData.h"
+#include "../../EngineConcept/Order.h"
+#include "../../EngineConcept/SymbolRegistry.h"
+#include "../../EngineConcept/TradeSink.h"
+#include "../../EngineCommon/BookSnapshot.h"
+#include "../../EngineCommon/EngineStats.h"
+#include "../../EngineCommon/HierarchicalBitset.h"
+#include "../../EngineCommon/L2Publisher.h"
+#include "../../EngineCommon/L3Feed.h"
+#include "../../EngineCommon/TopOfBook.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// ============================================================================
+// FLAT PRICE LADDER IMPLEMENTATION
+//
+// Levels live in a contiguous array indexed by (price - base_tick), so adding
+// to a level is an index instead of a std::map walk. The window slides and
+// recenters around the market when a price falls outside of it, a hierarchical
+// bitset of non-empty levels gives the next best level after the current one
+// empties. The window is capped at MAX_WINDOW ticks around the best price;
+// levels further away wait in a std::map until the window reaches them.
+// ============================================================================
+
+class OrderBookLadderV5 {
+public:
+    static constexpr size_t NO_LEVEL = HierarchicalBitset::NPOS;
+
+    // Записи лежат в кольце по значению, по две в кэш-линии. Отмененный
+    // слот в середине очереди помечается нулевым количеством.
+    struct PriceLevel {
+        std::vector<OrderRecord> orders;  // кольцевой буфер, размер - степень двойки
+        size_t head_idx = 0;
+        size_t count = 0;      // занятые слоты, включая отмененные в середине очереди
+        uint64_t popped = 0;   // сколько ордеров снято с головы = порядковый номер front()
+        uint64_t total_quantity = 0;
+        uint32_t order_count = 0;  // живые ордера, без отмененных слотов
+
+        [[nodiscard]] bool empty() const {
+            return count == 0;
+        }
+
+        [[nodiscard]] uint64_t next_seq() const {
+            return popped + count;
+        }
+
+        OrderRecord& at(uint64_t seq) {
+            return orders[(head_idx + (seq - popped)) & (orders.size() - 1)];
+        }
+
+        OrderRecord& front() {
+            return orders[head_idx];
+        }
+
+        // resizes - счетчик перевыделений кольца на стороне книги
+        void push_back(const OrderRecord& order, uint64_t& resizes) {
+            if (count == orders.size()) {
+                if (!orders.empty()) ++resizes;  // первый буфер уровня - не перевыделение
+                grow();
+            }
+            orders[(head_idx + count) & (orders.size() - 1)] = order;
+            ++count;
+        }
+
+        // Голова уровня всегда указывает на живой ордер
+        void pop_front() {
+            do {
+                head_idx = (head_idx + 1) & (orders.size() - 1);
+                --count;
+                ++popped;
+            } while (count != 0 && orders[head_idx].quantity == 0);
+        }
+
+        OrderRecord take(uint64_t seq) {
+            OrderRecord& slot = at(seq);
+            OrderRecord order = slot;
+            slot.quantity = 0;
+            total_quantity -= order.quantity;
+            --order_count;
+
+            if (seq == popped) {
+                pop_front();
+            } else {
+                while (orders[(head_idx + count - 1) & (orders.size() - 1)].quantity == 0) {
+                    --count;
+                }
+            }
+            return order;
+        }
+
+        // Восстановление из снимка: пустой уровень получает кольцо под все
+        // ордера сразу, записи копируются одним проходом
+        void assign(std::span<const OrderRecord> records) {
+            orders.assign(records.begin(), records.end());
+            orders.resize(std::bit_ceil(std::max(records.size(), MIN_CAPACITY)));
+            head_idx = 0;
+            count = records.size();
+            total_quantity = 0;
+            for (const OrderRecord& order : records) total_quantity += order.quantity;
+            order_count = static_cast<uint32_t>(records.size());
+        }
+
+    private:
+        static constexpr size_t MIN_CAPACITY = 8;
+
+        void grow() {
+            size_t new_size = orders.empty() ? MIN_CAPACITY : orders.size() * 2;
+            std::vector<OrderRecord> new_orders(new_size);
+            for (size_t i = 0; i < count; ++i) {
+                new_orders[i] = orders[(head_idx + i) & (orders.size() - 1)];
+            }
+            orders = std::move(new_orders);
+            head_idx = 0;
+        }
+    };
+
+    // Ссылка не хранит указатель на уровень: при сдвиге окна уровни переезжают
+    struct OrderRef {
+        int price;
+        uint64_t seq;
+    };
+
+    // Одна сторона книги. Для покупок лучший уровень - наибольший индекс,
+    // для продаж - наименьший. Окно не больше MAX_WINDOW тиков и всегда
+    // содержит лучший уровень; уровни за худшим краем окна лежат в overflow_
+    // и возвращаются в окно, когда оно до них доходит.
+    template<bool IsBuy>
+    class PriceLadder {
+    public:
+        static constexpr size_t INITIAL_WINDOW = 64;
+        static constexpr size_t MAX_WINDOW = size_t{1} << 16;
+
+        [[nodiscard]] bool empty() const {
+            return best_idx_ == NO_LEVEL;
+        }
+
+        [[nodiscard]] size_t orderCount() const {
+            return order_count_;
+        }
+
+        [[nodiscard]] size_t levelCount() const {
+            return level_count_;
+        }
+
+        [[nodiscard]] uint64_t resizes() const {
+            return resizes_;
+        }
+
+        [[nodiscard]] size_t windowSize() const {
+            return levels_.size();
+        }
+
+        [[nodiscard]] size_t overflowLevelCount() const {
+            return overflow_.size();
+        }
+
+        [[nodiscard]] int bestPrice() const {
+            return base_tick_ + static_cast<int>(best_idx_);
+        }
+
+        PriceLevel& bestLevel() {
+            return levels_[best_idx_];
+        }
+
+        PriceLevel& level(int price) {
+            return inWindow(price) ? levels_[price - base_tick_] : overflow_.find(price)->second;
+        }
+
+        OrderRef add(const OrderRecord& order) {
+            int price = order.price;
+            PriceLevel& level = acquire(price);
+            uint64_t seq = level.next_seq();
+            level.total_quantity += order.quantity;
+            ++level.order_count;
+            level.push_back(order, resizes_);
+            ++order_count_;
+            return {price, seq};
+        }
+
+        void popBest(uint64_t quantity) {
+            PriceLevel& level = levels_[best_idx_];
+            level.pop_front();
+            level.total_quantity -= quantity;
+            --level.order_count;
+            --order_count_;
+            if (level.empty()) {
+                onLevelEmptied(best_idx_);
+            }
+        }
+
+        [[nodiscard]] DepthLevel levelAt(int price) const {
+            if (inWindow(price)) {
+                const PriceLevel& level = levels_[price - base_tick_];
+                return {price, level.order_count, level.total_quantity};
+            }
+            auto it = overflow_.find(price);
+            if (it == overflow_.end()) return {price, 0, 0};
+            return {price, it->second.order_count, it->second.total_quantity};
+        }
+
+        // Агрегаты уровней от лучшего вглубь, пустые уровни пропускает битсет
+        size_t depth(std::span<DepthLevel> out) const {
+            size_t filled = 0;
+            forEachLevel([&](int price, const PriceLevel& level) {
+                if (filled == out.size()) return false;
+                out[filled++] = {price, level.order_count, level.total_quantity};
+                return true;
+            });
+            return filled;
+        }
+
+        // Уровень из снимка целиком, в пустой слот лестницы
+        OrderRef restore(int price, std::span<const OrderRecord> orders) {
+            PriceLevel& level = acquire(price);
+            uint64_t seq = level.next_seq();
+            level.assign(orders);
+            order_count_ += orders.size();
+            return {price, seq};
+        }
+
+        // Непустые уровни от лучшего, живые записи от головы очереди
+        void save(Side side, BookSnapshotWriter& out) const {
+            forEachLevel([&](int price, const PriceLevel& level) {
+                out.beginLevel(side, price);
+                for (size_t i = 0; i < level.count; ++i) {
+                    const OrderRecord& order = level.orders[(level.head_idx + i) & (level.orders.size() - 1)];
+                    if (order.quantity != 0) out.addOrder(order);
+                }
+                return true;
+            });
+        }
+
+        OrderRecord cancel(OrderRef ref) {
+            if (!inWindow(ref.price)) {
+                auto it = overflow_.find(ref.price);
+                OrderRecord order = it->second.take(ref.seq);
+                --order_count_;
+                if (it->second.empty()) {
+                    overflow_.erase(it);
+                    --level_count_;
+                }
+                return order;
+            }
+
+            size_t idx = ref.price - base_tick_;
+            PriceLevel& level = levels_[idx];
+            OrderRecord order = level.take(ref.seq);
+            --order_count_;
+            if (level.empty()) {
+                onLevelEmptied(idx);
+            }
+            return order;
+        }
+
+    private:
+        [[nodiscard]] static bool isBetter(size_t a, size_t b) {
+            return IsBuy ? a > b : a < b;
+        }
+
+        [[nodiscard]] static bool isBetterPrice(int a, int b) {
+            return IsBuy ? a > b : a < b;
+        }
+
+        [[nodiscard]] size_t nextWorse(size_t idx) const {
+            if constexpr (IsBuy) {
+                return idx == 0 ? NO_LEVEL : occupied_.findPrev(idx - 1);
+            } else {
+                return idx + 1 < levels_.size() ? occupied_.findNext(idx + 1) : NO_LEVEL;
+            }
+        }
+
+        [[nodiscard]] bool inWindow(int price) const {
+            int64_t offset = int64_t{price} - base_tick_;
+            return offset >= 0 && offset < static_cast<int64_t>(levels_.size());
+        }
+
+        // Непустые уровни от лучшего к худшему: сначала окно, потом overflow_.
+        // fn(price, level) возвращает false, чтобы остановить обход
+        template<typename Fn>
+        void forEachLevel(Fn&& fn) const {
+            for (size_t idx = best_idx_; idx != NO_LEVEL; idx = nextWorse(idx)) {
+                if (!fn(base_tick_ + static_cast<int>(idx), levels_[idx])) return;
+            }
+            if constexpr (IsBuy) {
+                for (auto it = overflow_.rbegin(); it != overflow_.rend(); ++it) {
+                    if (!fn(it->first, it->second)) return;
+                }
+            } else {
+                for (auto it = overflow_.begin(); it != overflow_.end(); ++it) {
+                    if (!fn(it->first, it->second)) return;
+                }
+            }
+        }
+
+        // Уровень под новый ордер; пустой уровень окна отмечается в битсете
+        PriceLevel& acquire(int price) {
+            if (!inWindow(price)) {
+                place(price);
+            }
+            if (!inWindow(price)) {
+                auto [it, inserted] = overflow_.try_emplace(price);
+                if (inserted) ++level_count_;
+                return it->second;
+            }
+
+            size_t idx = price - base_tick_;
+            PriceLevel& level = levels_[idx];
+            if (level.empty()) {
+                occupied_.set(idx);
+                ++level_count_;
+                if (best_idx_ == NO_LEVEL || isBetter(idx, best_idx_)) {
+                    best_idx_ = idx;
+                }
+            }
+            return level;
+        }
+
+        void onLevelEmptied(size_t idx) {
+            occupied_.clear(idx);
+            --level_count_;
+            if (idx == best_idx_) {
+                best_idx_ = IsBuy ? occupied_.findPrev(idx) : occupied_.findNext(idx);
+                if (best_idx_ == NO_LEVEL && !overflow_.empty()) {
+                    // Окно опустело: переезжает к лучшему уровню из overflow_
+                    int best = IsBuy ? overflow_.rbegin()->first : overflow_.begin()->first;
+                    relocate(int64_t{best} - static_cast<int64_t>(levels_.size() / 2), levels_.size());
+                }
+            }
+        }
+
+        // Цена вне окна. Пока занятый диапазон вместе с ней помещается в
+        // половину MAX_WINDOW, окно центрируется на нем и удваивается. Дальше
+        // окно размера MAX_WINDOW переезжает к цене, только если она лучше
+        // текущей; худшая цена остается за краем окна, в overflow_
+        void place(int price) {
+            int64_t lo = price;
+            int64_t hi = price;
+            if (!empty()) {
+                lo = std::min<int64_t>(lo, base_tick_ + static_cast<int64_t>(occupied_.findNext(0)));
+                hi = std::max<int64_t>(hi, base_tick_ + static_cast<int64_t>(occupied_.findPrev(levels_.size() - 1)));
+            }
+
+            if (static_cast<uint64_t>(hi - lo + 1) <= MAX_WINDOW / 2) {
+                size_t window = std::max(levels_.size(), INITIAL_WINDOW);
+                while (static_cast<size_t>(hi - lo + 1) > window / 2) {
+                    window *= 2;
+                }
+                relocate(lo + (hi - lo) / 2 - static_cast<int64_t>(window / 2), window);
+            } else if (empty() || isBetterPrice(price, bestPrice())) {
+                relocate(int64_t{price} - static_cast<int64_t>(MAX_WINDOW / 2), MAX_WINDOW);
+            }
+        }
+
+        // Новое окно [new_base, new_base + window): уровни старого окна вне
+        // него уходят в overflow_, уровни overflow_ внутри него возвращаются
+        void relocate(int64_t new_base, size_t window) {
+            std::vector<PriceLevel> new_levels(window);
+            HierarchicalBitset new_occupied(window);
+            auto in_new_window = [&](int64_t price) {
+                return price >= new_base && price < new_base + static_cast<int64_t>(window);
+            };
+
+            for (size_t i = occupied_.findNext(0); i != NO_LEVEL;
+                 i = i + 1 < levels_.size() ? occupied_.findNext(i + 1) : NO_LEVEL) {
+                int price = base_tick_ + static_cast<int>(i);
+                if (in_new_window(price)) {
+                    size_t new_idx = static_cast<size_t>(price - new_base);
+                    new_levels[new_idx] = std::move(levels_[i]);
+                    new_occupied.set(new_idx);
+                } else {
+                    overflow_.emplace(price, std::move(levels_[i]));
+                }
+            }
+
+            auto first = overflow_.lower_bound(static_cast<int>(std::clamp<int64_t>(new_base, INT32_MIN, INT32_MAX)));
+            auto last = first;
+            while (last != overflow_.end() && in_new_window(last->first)) {
+                size_t new_idx = static_cast<size_t>(last->first - new_base);
+                new_levels[new_idx] = std::move(last->second);
+                new_occupied.set(new_idx);
+                ++last;
+            }
+            overflow_.erase(first, last);
+
+            levels_ = std::move(new_levels);
+            occupied_ = std::move(new_occupied);
+            base_tick_ = static_cast<int>(new_base);
+            best_idx_ = IsBuy ? occupied_.findPrev(window - 1) : occupied_.findNext(0);
+        }
+
+        std::vector<PriceLevel> levels_;
+        HierarchicalBitset occupied_;
+        std::map<int, PriceLevel> overflow_;  // далекие от лучшей цены уровни, все хуже уровней окна
+        int base_tick_ = 0;
+        size_t best_idx_ = NO_LEVEL;
+        size_t order_count_ = 0;
+        size_t level_count_ = 0;  // окно и overflow_
+        uint64_t resizes_ = 0;
+    };
+
+    PriceLadder<true> buy_ladder;
+    PriceLadder<false> sell_ladder;
+
+    OrderRef addBuyOrder(const OrderRecord& order) {
+        return buy_ladder.add(order);
+    }
+
+    OrderRef addSellOrder(const OrderRecord& order) {
+        return sell_ladder.add(order);
+    }
+
+    // Снимок: непустые уровни от лучшего, ордера в порядке приоритета
+    void saveLevels(BookSnapshotWriter& out) const {
+        buy_ladder.save(Side::BUY, out);
+        sell_ladder.save(Side::SELL, out);
+    }
+
+    // Возвращает ссылку на первый ордер уровня, остальные идут с seq + i
+    OrderRef restoreLevel(Side side, int price, std::span<const OrderRecord> orders) {
+        return side == Side::BUY ? buy_ladder.restore(price, orders) : sell_ladder.restore(price, orders);
+    }
+
+    // Исполненный ордер всегда голова лучшего уровня
+    void removeBestBuy(uint64_t quantity) {
+        buy_ladder.popBest(quantity);
+    }
+
+    void removeBestSell(uint64_t quantity) {
+        sell_ladder.popBest(quantity);
+    }
+
+    // Частичное исполнение головы лучшего уровня: ордер остается в очереди
+    void reduceBestBuy(uint64_t quantity) {
+        buy_ladder.bestLevel().total_quantity -= quantity;
+    }
+
+    void reduceBestSell(uint64_t quantity) {
+        sell_ladder.bestLevel().total_quantity -= quantity;
+    }
+
+    [[nodiscard]] DepthLevel levelAt(Side side, int price) const {
+        return side == Side::BUY ? buy_ladder.levelAt(price) : sell_ladder.levelAt(price);
+    }
+
+    // Для снимка лучших цен: без прохода по уровням
+    [[nodiscard]] TopOfBook topOfBook() const {
+        TopOfBook top{};
+        depth(Side::BUY, {&top.bid, 1});
+        depth(Side::SELL, {&top.ask, 1});
+        return top;
+    }
+
+    size_t depth(Side side, std::span<DepthLevel> out) const {
+        return side == Side::BUY ? buy_ladder.depth(out) : sell_ladder.depth(out);
+    }
+
+    [[nodiscard]] bool hasBuy() const {
+        return !buy_ladder.empty();
+    }
+
+    [[nodiscard]] bool hasSell() const {
+        return !sell_ladder.empty();
+    }
+
+    // Указатель в кольцо уровня действителен до следующего добавления в книгу
+    [[nodiscard]] OrderRecord* getBestBuy() {
+        return buy_ladder.empty() ? nullptr : &buy_ladder.bestLevel().front();
+    }
+
+    [[nodiscard]] OrderRecord* getBestSell() {
+        return sell_ladder.empty() ? nullptr : &sell_ladder.bestLevel().front();
+    }
+
+    [[nodiscard]] OrderRecord* getOrder(Side side, OrderRef ref) {
+        auto& level = side == Side::BUY ? buy_ladder.level(ref.price) : sell_ladder.level(ref.price);
+        return &level.at(ref.seq);
+    }
+
+    void reduceOrderQuantity(Side side, OrderRef ref, uint64_t new_quantity) {
+        auto& level = side == Side::BUY ? buy_ladder.level(ref.price) : sell_ladder.level(ref.price);
+        OrderRecord& order = level.at(ref.seq);
+        level.total_quantity -= order.quantity - new_quantity;
+        order.quantity = static_cast<uint32_t>(new_quantity);
+    }
+
+    OrderRecord cancelBuyOrder(OrderRef ref) {
+        return buy_ladder.cancel(ref);
+    }
+
+    OrderRecord cancelSellOrder(OrderRef ref) {
+        return sell_ladder.cancel(ref);
+    }
+};
+
+template<TradeSink Sink = BufferedTradeSink, typename Stats = NoEngineStats>
+class BasicMatchingEngineV5 {
+public:
+    using TradeCallback = std::function<void(const Trade&)>;
+
+    BasicMatchingEngineV5() : next_timestamp_(0) {}
+
+    explicit BasicMatchingEngineV5(Sink sink) : sink_(std::move(sink)), next_timestamp_(0) {}
+
+    static const char* name() {
+        return "MatchingEngineV5";
+    }
+
+    // Только для sink с type erasure, см. CallbackTradeSink
+    void setTradeCallback(TradeCallback callback) requires CallbackSettableSink<Sink> {
+        sink_.setCallback(std::move(callback));
+    }
+
+    Sink& tradeSink() {
+        return sink_;
+    }
+
+    // Уровни хранят записи по значению, unique_ptr здесь только распаковывается.
+    // false - ордер отклонен целиком: количество не помещается в OrderRecord
+    // или ордер с таким id еще стоит в книге
+    bool submitOrder(std::unique_ptr<Order> order) {
+        if (order->quantity > MAX_ORDER_QUANTITY) return false;
+        OrderRecord record = order->toRecord();
+        if (order->symbol_id == INVALID_SYMBOL_ID) {
+            // медленный путь: символ не был зарегистрирован заранее
+            record.symbol_id = registerSymbol(order->symbol);
+        }
+        return submitOrder(record);
+    }
+
+    // Компактная запись, symbol_id уже интернирован через registerSymbol.
+    // false - ордер с таким id еще стоит в книге
+    bool submitOrder(const OrderRecord& record) {
+        if (order_index_.contains(record.order_id)) return false;
+        OrderRecord incoming = record;
+        if (incoming.timestamp == 0) {
+            incoming.timestamp = ++next_timestamp_;
+        }
+        beginTradeBatch(sink_);
+        matchOrder(incoming);
+        endTradeBatch(sink_);
+        stats_.onMatchEnd();
+        l2_.publish(incoming.symbol_id, books_.book(incoming.symbol_id));
+        top_of_book_.publish(incoming.symbol_id, books_.book(incoming.symbol_id));
+        stats_.onOrder();
+        publishStatsIfDue();
+        return true;
+    }
+
+    SymbolId registerSymbol(const std::string& symbol) {
+        SymbolId symbol_id = books_.registerSymbol(symbol);
+        top_of_book_.ensure(symbol_id);
+        return symbol_id;
+    }
+
+    bool cancelOrder(uint64_t order_id) {
+        auto it = order_index_.find(order_id);
+        if (it == order_index_.end()) return false;
+
+        OrderLocation location = it->second;
+        order_index_.erase(it);
+        auto& book = books_.book(location.symbol_id);
+        const OrderRecord* resting = book.getOrder(location.side, location.ref);
+        l3_.cancel(location.symbol_id, location.side, order_id, resting->price, resting->quantity, next_timestamp_);
+        l2_.touch(book, location.side, location.ref.price);
+        if (location.side == Side::BUY) {
+            book.cancelBuyOrder(location.ref);
+        } else {
+            book.cancelSellOrder(location.ref);
+        }
+        l2_.publish(location.symbol_id, book);
+        top_of_book_.publish(location.symbol_id, book);
+        stats_.onCancel();
+        publishStatsIfDue();
+        return true;
+    }
+
+    // Уменьшение количества на той же цене сохраняет приоритет по времени,
+    // смена цены или увеличение количества - это снятие и новая постановка
+    bool modifyOrder(uint64_t order_id, uint64_t new_quantity, int new_price) {
+        if (new_quantity > MAX_ORDER_QUANTITY) return false;
+        if (new_quantity == 0) return cancelOrder(order_id);
+
+        auto it = order_index_.find(order_id);
+        if (it == order_index_.end()) return false;
+
+        OrderLocation location = it->second;
+        auto& book = books_.book(location.symbol_id);
+        const OrderRecord* resting = book.getOrder(location.side, location.ref);
+        if (new_price == resting->price && new_quantity <= resting->quantity) {
+            l2_.touch(book, location.side, resting->price);
+            book.reduceOrderQuantity(location.side, location.ref, new_quantity);
+            l3_.replace(location.symbol_id, location.side, order_id, resting->price, new_quantity, next_timestamp_);
+            l2_.publish(location.symbol_id, book);
+            top_of_book_.publish(location.symbol_id, book);
+            stats_.onModify();
+            publishStatsIfDue();
+            return true;
+        }
+
+        order_index_.erase(it);
+        l3_.cancel(location.symbol_id, location.side, order_id, resting->price, resting->quantity, next_timestamp_);
+        l2_.touch(book, location.side, resting->price);
+        OrderRecord order = location.side == Side::BUY
+                ? book.cancelBuyOrder(location.ref)
+                : book.cancelSellOrder(location.ref);
+        order.price = new_price;
+        order.quantity = static_cast<uint32_t>(new_quantity);
+        order.timestamp = ++next_timestamp_;
+        beginTradeBatch(sink_);
+        matchOrder(order);  // новая цена может пересечь спред
+        endTradeBatch(sink_);
+        stats_.onMatchEnd();
+        l2_.publish(location.symbol_id, book);
+        top_of_book_.publish(location.symbol_id, book);
+        stats_.onModify();
+        publishStatsIfDue();
+        return true;
+    }
+
+    [[nodiscard]] size_t getBuyOrderCount() const {
+        size_t count = 0;
+        for (const auto& book : books_) count += book.buy_ladder.orderCount();
+        return count;
+    }
+
+    [[nodiscard]] size_t getSellOrderCount() const {
+        size_t count = 0;
+        for (const auto& book : books_) count += book.sell_ladder.orderCount();
+        return count;
+    }
+
+    [[nodiscard]] size_t getBuyOrderCount(const std::string& symbol) const {
+        const OrderBookLadderV5* book = books_.find(symbol);
+        return book ? book->buy_ladder.orderCount() : 0;
+    }
+
+    [[nodiscard]] size_t getSellOrderCount(const std::string& symbol) const {
+        const OrderBookLadderV5* book = books_.find(symbol);
+        return book ? book->sell_ladder.orderCount() : 0;
+    }
+
+    [[nodiscard]] size_t getBuyLevelCount() const {
+        size_t count = 0;
+        for (const auto& book : books_) count += book.buy_ladder.levelCount();
+        return count;
+    }
+
+    [[nodiscard]] size_t getSellLevelCount() const {
+        size_t count = 0;
+        for (const auto& book : books_) count += book.sell_ladder.levelCount();
+        return count;
+    }
+
+    // Перевыделения колец уровней по всем символам
+    [[nodiscard]] uint64_t getLevelResizes() const {
+        uint64_t count = 0;
+        for (const auto& book : books_) count += book.buy_ladder.resizes() + book.sell_ladder.resizes();
+        return count;
+    }
+
+    // Верхние levels уровней стороны: цена, суммарное количество, число ордеров
+    [[nodiscard]] std::vector<DepthLevel> getDepth(const std::string& symbol, Side side, size_t levels) const {
+        std::vector<DepthLevel> depth(levels);
+        const OrderBookLadderV5* book = books_.find(symbol);
+        depth.resize(book ? book->depth(side, depth) : 0);
+        return depth;
+    }
+
+    // Без аллокаций: заполняет до out.size() уровней, возвращает их число
+    size_t getDepth(SymbolId symbol_id, Side side, std::span<DepthLevel> out) const {
+        return books_.book(symbol_id).depth(side, out);
+    }
+
+    // Снимок всех книг для быстрого рестарта, см. BookSnapshot.h.
+    // false - имя символа не помещается в снимок
+    bool saveSnapshot(BookSnapshotWriter& out) const {
+        out.begin(next_timestamp_);
+        for (SymbolId symbol_id = 0; symbol_id < books_.size(); ++symbol_id) {
+            if (!out.beginSymbol(books_.registry().name(symbol_id))) return false;
+            books_.book(symbol_id).saveLevels(out);
+        }
+        return true;
+    }
+
+    // Только в движок без ордеров; уровни строятся целиком, без addBuyOrder
+    // на каждый ордер. false - снимок поврежден или не подходит движку
+    // (символы зарегистрированы в другом порядке, повтор id), такой движок
+    // остается недостроенным и не годится для работы
+    bool restoreSnapshot(BookSnapshotReader& in) {
+        if (getBuyOrderCount() + getSellOrderCount() != 0) return false;
+        order_index_.reserve(in.header().order_count);
+
+        std::string_view name;
+        for (SymbolId expected = 0; in.nextSymbol(name); ++expected) {
+            const SymbolId symbol_id = registerSymbol(std::string(name));
+            if (symbol_id != expected) return false;
+            auto& book = books_.book(symbol_id);
+            SnapshotLevelView level;
+            while (in.nextLevel(level)) {
+                auto first = book.restoreLevel(level.side, level.price, level.orders);
+                for (size_t i = 0; i < level.orders.size(); ++i) {
+                    OrderLocation location{{first.price, first.seq + i}, symbol_id, level.side};
+                    if (!order_index_.try_emplace(level.orders[i].order_id, location).second) return false;
+                }
+            }
+            top_of_book_.publish(symbol_id, book);
+        }
+        next_timestamp_ = in.header().next_timestamp;
+        return in.complete();
+    }
+
+    // Инкрементальные L2-обновления: одна пачка на submitOrder/cancelOrder/modifyOrder
+    void setL2Callback(L2Publisher::Callback callback) {
+        l2_.setCallback(std::move(callback));
+    }
+
+    void enableL2Updates(bool enabled = true) {
+        l2_.setEnabled(enabled);
+    }
+
+    [[nodiscard]] std::span<const L2Update> getL2Updates() const {
+        return l2_.updates();
+    }
+
+    // L3-лента: события по каждому ордеру в предвыделенное SPSC-кольцо
+    void enableL3Feed(size_t capacity = L3Feed::DEFAULT_CAPACITY) {
+        l3_.enable(capacity);
+    }
+
+    // Можно вызывать из потока-потребителя
+    bool pollL3Event(L3Event& event) {
+        return l3_.poll(event);
+    }
+
+    [[nodiscard]] uint64_t getL3DroppedEvents() const {
+        return l3_.dropped();
+    }
+
+    // Снимок лучших цен под seqlock, обновляется после каждой операции
+    void enableTopOfBook(bool enabled = true) {
+        top_of_book_.setEnabled(enabled);
+    }
+
+    // Ссылку можно взять один раз после регистрации символа и читать из любого потока
+    [[nodiscard]] const SeqLock<TopOfBook>& topOfBookSnapshot(SymbolId symbol_id) const {
+        return top_of_book_.snapshot(symbol_id);
+    }
+
+    [[nodiscard]] TopOfBook getTopOfBook(SymbolId symbol_id) const {
+        return top_of_book_.snapshot(symbol_id).load();
+    }
+
+    // Статистика движка, только с политикой EngineStats (см. EngineStats.h).
+    // Снимок обновляется раз в N операций, ссылку можно читать из любого потока
+    [[nodiscard]] const SeqLock<EngineStatsSnapshot>& statsSnapshot() const requires Stats::ENABLED {
+        return stats_.snapshot();
+    }
+
+    [[nodiscard]] EngineStatsSnapshot getStats() const requires Stats::ENABLED {
+        return stats_.snapshot().load();
+    }
+
+    // Только поток матчинга: N = 1 - публикация после каждой операции
+    void setStatsPublishInterval(uint32_t operations) requires Stats::ENABLED {
+        stats_.setPublishInterval(operations);
+    }
+
+    // Только поток матчинга: публикует счетчики сейчас, не дожидаясь N операций
+    void publishStats() requires Stats::ENABLED {
+        stats_.publish(getBuyLevelCount() + getSellLevelCount(), getLevelResizes());
+    }
+
+    void clearTrades() {
+        if constexpr (BatchingTradeSink<Sink>) {
+            sink_.clear();
+        }
+    }
+
+    // Сделки последнего ордера, при сбросе раз в N ордеров - всей пачки
+    [[nodiscard]] std::span<const Trade> getTrades() const requires BatchingTradeSink<Sink> {
+        return sink_.trades();
+    }
+
+private:
+    void matchOrder(OrderRecord& order) {
+        OrderBookLadderV5& book = books_.book(order.symbol_id);
+        if (order.type() == OrderType::MARKET) {
+            matchMarketOrder(book, order);
+        } else {
+            matchLimitOrder(book, order);
+        }
+    }
+
+    void matchMarketOrder(OrderBookLadderV5& book, OrderRecord& order) {
+        if (order.side() == Side::BUY) {
+            while (order.quantity > 0 && book.hasSell()) {
+                OrderRecord* best_sell = book.getBestSell();
+                uint64_t trade_qty = std::min(order.quantity, best_sell->quantity);
+
+                executeTrade(&order, best_sell, best_sell->price, trade_qty);
+
+                order.quantity -= trade_qty;
+                best_sell->quantity -= trade_qty;
+
+                l2_.touch(book, Side::SELL, best_sell->price);
+                l3_.execute(best_sell->symbol_id, Side::SELL, best_sell->order_id, best_sell->price, trade_qty, next_timestamp_);
+                if (best_sell->quantity == 0) {
+                    order_index_.erase(best_sell->order_id);
+                    book.removeBestSell(trade_qty);
+                } else {
+                    book.reduceBestSell(trade_qty);
+                }
+            }
+        } else {
+            while (order.quantity > 0 && book.hasBuy()) {
+                OrderRecord* best_buy = book.getBestBuy();
+                uint64_t trade_qty = std::min(order.quantity, best_buy->quantity);
+
+                executeTrade(best_buy, &order, best_buy->price, trade_qty);
+
+                order.quantity -= trade_qty;
+                best_buy->quantity -= trade_qty;
+
+                l2_.touch(book, Side::BUY, best_buy->price);
+                l3_.execute(best_buy->symbol_id, Side::BUY, best_buy->order_id, best_buy->price, trade_qty, next_timestamp_);
+                if (best_buy->quantity == 0) {
+                    order_index_.erase(best_buy->order_id);
+                    book.removeBestBuy(trade_qty);
+                } else {
+                    book.reduceBestBuy(trade_qty);
+                }
+            }
+        }
+    }
+
+    void matchLimitOrder(OrderBookLadderV5& book, OrderRecord& order) {
+        if (order.side() == Side::BUY) {
+            while (order.quantity > 0 && book.hasSell()) {
+                OrderRecord* best_sell = book.getBestSell();
+
+                if (!canMatch(&order, best_sell)) {
+                    break;
+                }
+
+                uint64_t trade_qty = std::min(order.quantity, best_sell->quantity);
+                executeTrade(&order, best_sell, best_sell->price, trade_qty);
+
+                order.quantity -= trade_qty;
+                best_sell->quantity -= trade_qty;
+
+                l2_.touch(book, Side::SELL, best_sell->price);
+                l3_.execute(best_sell->symbol_id, Side::SELL, best_sell->order_id, best_sell->price, trade_qty, next_timestamp_);
+                if (best_sell->quantity == 0) {
+                    order_index_.erase(best_sell->order_id);
+                    book.removeBestSell(trade_qty);
+                } else {
+                    book.reduceBestSell(trade_qty);
+                }
+            }
+
+            if (order.quantity > 0) {
+                l2_.touch(book, Side::BUY, order.price);
+                l3_.add(order.symbol_id, Side::BUY, order.order_id, order.price, order.quantity, next_timestamp_);
+                auto ref = book.addBuyOrder(order);
+                stats_.onRest(book.buy_ladder.level(ref.price).order_count);
+                order_index_.insert_or_assign(order.order_id, OrderLocation{ref, order.symbol_id, Side::BUY});
+            }
+        } else {
+            while (order.quantity > 0 && book.hasBuy()) {
+                OrderRecord* best_buy = book.getBestBuy();
+
+                if (!canMatch(best_buy, &order)) {
+                    break;
+                }
+
+                uint64_t trade_qty = std::min(order.quantity, best_buy->quantity);
+                executeTrade(best_buy, &order, best_buy->price, trade_qty);
+
+                order.quantity -= trade_qty;
+                best_buy->quantity -= trade_qty;
+
+                l2_.touch(book, Side::BUY, best_buy->price);
+                l3_.execute(best_buy->symbol_id, Side::BUY, best_buy->order_id, best_buy->price, trade_qty, next_timestamp_);
+                if (best_buy->quantity == 0) {
+                    order_index_.erase(best_buy->order_id);
+                    book.removeBestBuy(trade_qty);
+                } else {
+                    book.reduceBestBuy(trade_qty);
+                }
+            }
+
+            if (order.quantity > 0) {
+                l2_.touch(book, Side::SELL, order.price);
+                l3_.add(order.symbol_id, Side::SELL, order.order_id, order.price, order.quantity, next_timestamp_);
+                auto ref = book.addSellOrder(order);
+                stats_.onRest(book.sell_ladder.level(ref.price).order_count);
+                order_index_.insert_or_assign(order.order_id, OrderLocation{ref, order.symbol_id, Side::SELL});
+            }
+        }
+    }
+
+    [[nodiscard]] bool canMatch(const OrderRecord* buy, const OrderRecord* sell) const {
+        return buy->price >= sell->price;
+    }
+
+    void executeTrade(const OrderRecord* buy_order, const OrderRecord* sell_order,
+                      int price, uint64_t quantity) {
+        Trade trade(buy_order->order_id, sell_order->order_id,
+                    price, quantity, ++next_timestamp_);
+
+        sink_.onTrade(trade);
+        stats_.onFill(price);
+    }
+
+    void publishStatsIfDue() {
+        if constexpr (Stats::ENABLED) {
+            if (stats_.tick()) publishStats();
+        }
+    }
+
+    struct OrderLocation {
+        OrderBookLadderV5::OrderRef ref;
+        SymbolId symbol_id;
+        Side side;
+    };
+
+    PerSymbolBooks<OrderBookLadderV5> books_;
+    std::unordered_map<uint64_t, OrderLocation> order_index_;
+    Sink sink_;
+    L2Publisher l2_;
+    L3Feed l3_;
+    uint64_t next_timestamp_;
+    TopOfBookBoard top_of_book_;
+    [[no_unique_address]] Stats stats_;
+};
+
+using MatchingEngineV5 = BasicMatchingEngineV5<>;
@@ -0,0 +1,375 @@
+#pragma once
+#include "../EngineConcept/Order.h"
+#include "../EngineConcept/TradeSink.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ============================================================================
+// Binary snapshot of all books of an engine, for fast restart: restore the
+// snapshot, then replay only the journal tail after journal_sequence.
+//
+// The file is a sequence of 32-byte blocks, so a loaded snapshot can hand
+// out the orders of a level as a span of OrderRecord without copying:
+//   BookSnapshotHeader                         2 blocks
+//   per symbol, in SymbolId order:
+//     SnapshotSymbol                           2 blocks
+//     buy levels best first, then sell levels best first:
+//       SnapshotLevel                          1 block
+//       OrderRecord x order_count              time priority, head first
+// Engines write it in saveSnapshot() and bulk-build their levels from it in
+// restoreSnapshot(); the reader validates the structure (bounds, level order,
+// order fields, checksum) before an engine sees a level. The checksum covers
+// the header too, with its checksum field taken as zero, so a damaged symbol
+// count, journal position or trade hash is caught like a damaged order.
+// ============================================================================
+
+struct alignas(32) SnapshotBlock {
+    unsigned char bytes[32];
+};
+
+struct BookSnapshotHeader {
+    static constexpr char MAGIC[8] = {'M', 'E', 'S', 'N', 'A', 'P', '0', '1'};
+    static constexpr uint32_t VERSION = 2;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t symbol_count;
+    uint64_t next_timestamp;    // счетчик времени движка
+    uint64_t order_count;       // всего ордеров, для reserve при восстановлении
+    uint64_t journal_sequence;  // последняя запись журнала, вошедшая в снимок
+    uint64_t trade_count;       // отпечаток сделок на journal_sequence
+    uint64_t trade_hash;
+    uint64_t checksum;          // по заголовку без этого поля и всем блокам за ним
+};
+
+struct SnapshotSymbol {
+    static constexpr size_t MAX_NAME_LENGTH = 32;
+
+    char name[MAX_NAME_LENGTH];  // без завершающего нуля, если имя занимает все 32 байта
+    uint32_t buy_levels;
+    uint32_t sell_levels;
+    uint64_t buy_orders;
+    uint64_t sell_orders;
+    uint64_t reserved;
+};
+
+struct SnapshotLevel {
+    int32_t price;
+    uint32_t order_count;
+    uint64_t total_quantity;
+    uint64_t reserved[2];
+};
+
+static_assert(sizeof(BookSnapshotHeader) == 2 * sizeof(SnapshotBlock));
+static_assert(sizeof(SnapshotSymbol) == 2 * sizeof(SnapshotBlock));
+static_assert(sizeof(SnapshotLevel) == sizeof(SnapshotBlock));
+static_assert(sizeof(OrderRecord) == sizeof(SnapshotBlock) && alignof(OrderRecord) == alignof(SnapshotBlock));
+
+namespace snapshot_detail {
+
+inline constexpr size_t HEADER_BLOCKS = sizeof(BookSnapshotHeader) / sizeof(SnapshotBlock);
+
+// FNV-1a по 64-битным словам
+inline uint64_t hashBlocks(uint64_t hash, std::span<const SnapshotBlock> blocks) {
+    for (const SnapshotBlock& block : blocks) {
+        uint64_t words[4];
+        std::memcpy(words, block.bytes, sizeof(words));
+        for (uint64_t word : words) hash = (hash ^ word) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// Весь снимок, включая заголовок; поле checksum считается нулем
+inline uint64_t checksum(std::span<const SnapshotBlock> data) {
+    BookSnapshotHeader fields;
+    std::memcpy(&fields, data.data(), sizeof(fields));
+    fields.checksum = 0;
+    SnapshotBlock header[HEADER_BLOCKS];
+    std::memcpy(header, &fields, sizeof(header));
+    return hashBlocks(hashBlocks(0xcbf29ce484222325ull, header), data.subspan(HEADER_BLOCKS));
+}
+
+}  // namespace snapshot_detail
+
+class BookSnapshotWriter {
+public:
+    // Позиция журнала и отпечаток сделок на момент снимка; вызывать до saveSnapshot
+    void setJournalPosition(uint64_t sequence, const TradeStreamHash& trades) {
+        journal_sequence_ = sequence;
+        trades_ = trades;
+    }
+
+    // Методы begin* / addOrder вызывает движок из saveSnapshot()
+    void begin(uint64_t next_timestamp) {
+        blocks_.clear();
+        BookSnapshotHeader header{};
+        std::memcpy(header.magic, BookSnapshotHeader::MAGIC, sizeof(header.magic));
+        header.version = BookSnapshotHeader::VERSION;
+        header.next_timestamp = next_timestamp;
+        header.journal_sequence = journal_sequence_;
+        header.trade_count = trades_.count();
+        header.trade_hash = trades_.value();
+        append(header);
+        symbol_block_ = NONE;
+        level_block_ = NONE;
+    }
+
+    // false - имя длиннее MAX_NAME_LENGTH
+    bool beginSymbol(std::string_view name) {
+        if (name.size() > SnapshotSymbol::MAX_NAME_LENGTH) return false;
+        SnapshotSymbol symbol{};
+        std::memcpy(symbol.name, name.data(), name.size());
+        symbol_block_ = append(symbol);
+        level_block_ = NONE;
+        ++header().symbol_count;
+        return true;
+    }
+
+    // Пустой уровень не пишется: за beginLevel должен идти хотя бы один addOrder
+    void beginLevel(Side side, int price) {
+        SnapshotLevel level{};
+        level.price = price;
+        level_block_ = append(level);
+        level_side_ = side;
+        SnapshotSymbol& symbol = at<SnapshotSymbol>(symbol_block_);
+        ++(side == Side::BUY ? symbol.buy_levels : symbol.sell_levels);
+    }
+
+    void addOrder(const OrderRecord& order) {
+        append(order);
+        SnapshotLevel& level = at<SnapshotLevel>(level_block_);
+        ++level.order_count;
+        level.total_quantity += order.quantity;
+        SnapshotSymbol& symbol = at<SnapshotSymbol>(symbol_block_);
+        ++(level_side_ == Side::BUY ? symbol.buy_orders : symbol.sell_orders);
+        ++header().order_count;
+    }
+
+    // Дописывает контрольную сумму; после этого снимок готов к записи или чтению
+    std::span<const SnapshotBlock> finish() {
+        header().checksum = snapshot_detail::checksum(blocks_);
+        return blocks_;
+    }
+
+    // Через временный файл и rename: на диске всегда целый снимок, старый или новый
+    bool writeFile(const std::string& path) {
+        std::span<const SnapshotBlock> data = finish();
+        const std::string tmp_path = path + ".tmp";
+        int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) return false;
+
+        const char* bytes = reinterpret_cast<const char*>(data.data());
+        size_t size = data.size_bytes();
+        while (size > 0) {
+            ssize_t written = ::write(fd, bytes, size);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                ::close(fd);
+                return false;
+            }
+            bytes += written;
+            size -= static_cast<size_t>(written);
+        }
+        const bool synced = ::fdatasync(fd) == 0;
+        ::close(fd);
+        return synced && std::rename(tmp_path.c_str(), path.c_str()) == 0;
+    }
+
+private:
+    static constexpr size_t NONE = static_cast<size_t>(-1);
+
+    template<typename T>
+    size_t append(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T> && sizeof(T) % sizeof(SnapshotBlock) == 0);
+        size_t index = blocks_.size();
+        blocks_.resize(index + sizeof(T) / sizeof(SnapshotBlock));
+        std::memcpy(&blocks_[index], &value, sizeof(T));
+        return index;
+    }
+
+    template<typename T>
+    T& at(size_t index) {
+        return *reinterpret_cast<T*>(&blocks_[index]);
+    }
+
+    BookSnapshotHeader& header() {
+        return at<BookSnapshotHeader>(0);
+    }
+
+    std::vector<SnapshotBlock> blocks_;
+    size_t symbol_block_ = NONE;
+    size_t level_block_ = NONE;
+    Side level_side_ = Side::BUY;
+    uint64_t journal_sequence_ = 0;
+    TradeStreamHash trades_;
+};
+
+// Уровень снимка: ордера указывают прямо в буфер читателя
+struct SnapshotLevelView {
+    Side side;
+    int price;
+    uint64_t total_quantity;
+    std::span<const OrderRecord> orders;
+};
+
+class BookSnapshotReader {
+public:
+    // false - файл не читается или это не снимок, причина в error()
+    bool readFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return fail("cannot open " + path + ": " + std::strerror(errno));
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || st.st_size % sizeof(SnapshotBlock) != 0) {
+            ::close(fd);
+            return fail(path + " is not a book snapshot");
+        }
+        owned_.resize(static_cast<size_t>(st.st_size) / sizeof(SnapshotBlock));
+        char* bytes = reinterpret_cast<char*>(owned_.data());
+        size_t size = static_cast<size_t>(st.st_size);
+        while (size > 0) {
+            ssize_t got = ::read(fd, bytes, size);
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) {
+                ::close(fd);
+                return fail("cannot read " + path);
+            }
+            bytes += got;
+            size -= static_cast<size_t>(got);
+        }
+        ::close(fd);
+        return open(owned_);
+    }
+
+    // data должна жить, пока читаются уровни
+    bool open(std::span<const SnapshotBlock> data) {
+        data_ = data;
+        error_.clear();
+        if (data_.size() < HEADER_BLOCKS) return fail("snapshot is too short");
+        std::memcpy(&header_, data_.data(), sizeof(header_));
+        if (std::memcmp(header_.magic, BookSnapshotHeader::MAGIC, sizeof(header_.magic)) != 0) {
+            return fail("not a book snapshot");
+        }
+        if (header_.version != BookSnapshotHeader::VERSION) {
+            return fail("snapshot version " + std::to_string(header_.version) + ", expected " +
+                        std::to_string(BookSnapshotHeader::VERSION));
+        }
+        if (header_.checksum != snapshot_detail::checksum(data_)) {
+            return fail("snapshot checksum mismatch");
+        }
+        position_ = HEADER_BLOCKS;
+        symbols_left_ = header_.symbol_count;
+        symbol_index_ = -1;
+        buy_left_ = sell_left_ = 0;
+        return true;
+    }
+
+    [[nodiscard]] const BookSnapshotHeader& header() const {
+        return header_;
+    }
+
+    // Отпечаток сделок на момент снимка: с него продолжается сверка хвоста журнала
+    [[nodiscard]] TradeStreamHash tradeStreamHash() const {
+        return TradeStreamHash(header_.trade_hash, header_.trade_count);
+    }
+
+    // false - символы кончились или снимок поврежден (failed())
+    bool nextSymbol(std::string_view& name) {
+        if (failed() || symbols_left_ == 0) return false;
+        if (buy_left_ + sell_left_ != 0) return fail("levels of the previous symbol were not read");
+        if (position_ + SYMBOL_BLOCKS > data_.size()) return fail("snapshot is truncated");
+
+        std::memcpy(&symbol_, &data_[position_], sizeof(symbol_));
+        position_ += SYMBOL_BLOCKS;
+        --symbols_left_;
+        ++symbol_index_;
+        buy_left_ = symbol_.buy_levels;
+        sell_left_ = symbol_.sell_levels;
+        name = {symbol_.name, strnlen(symbol_.name, SnapshotSymbol::MAX_NAME_LENGTH)};
+        if (name.empty()) return fail("empty symbol name");
+        return true;
+    }
+
+    // false - уровни символа кончились или снимок поврежден (failed())
+    bool nextLevel(SnapshotLevelView& out) {
+        if (failed() || buy_left_ + sell_left_ == 0) return false;
+        const Side side = buy_left_ != 0 ? Side::BUY : Side::SELL;
+        const bool first_of_side = side == Side::BUY ? buy_left_ == symbol_.buy_levels
+                                                     : sell_left_ == symbol_.sell_levels;
+        if (position_ + 1 > data_.size()) return fail("snapshot is truncated");
+
+        SnapshotLevel level;
+        std::memcpy(&level, &data_[position_], sizeof(level));
+        if (level.order_count == 0 || position_ + 1 + level.order_count > data_.size()) {
+            return fail("bad level at price " + std::to_string(level.price));
+        }
+        // Уровни строго от лучшего к худшему: движки строят книгу без поиска
+        if (!first_of_side && (side == Side::BUY ? level.price >= last_price_ : level.price <= last_price_)) {
+            return fail("levels out of order at price " + std::to_string(level.price));
+        }
+
+        const auto* orders = reinterpret_cast<const OrderRecord*>(&data_[position_ + 1]);
+        uint64_t total_quantity = 0;
+        for (uint32_t i = 0; i < level.order_count; ++i) {
+            const OrderRecord& order = orders[i];
+            if (order.price != level.price || order.side() != side || order.type() != OrderType::LIMIT ||
+                order.quantity == 0 || order.symbol_id != static_cast<SymbolId>(symbol_index_)) {
+                return fail("bad order " + std::to_string(order.order_id));
+            }
+            total_quantity += order.quantity;
+        }
+        if (total_quantity != level.total_quantity) {
+            return fail("level quantity mismatch at price " + std::to_string(level.price));
+        }
+
+        position_ += 1 + level.order_count;
+        --(side == Side::BUY ? buy_left_ : sell_left_);
+        last_price_ = level.price;
+        out = {side, level.price, level.total_quantity, {orders, level.order_count}};
+        return true;
+    }
+
+    // Все символы и уровни прочитаны, лишних данных нет
+    [[nodiscard]] bool complete() const {
+        return !failed() && symbols_left_ == 0 && buy_left_ + sell_left_ == 0 && position_ == data_.size();
+    }
+
+    [[nodiscard]] bool failed() const {
+        return !error_.empty();
+    }
+
+    [[nodiscard]] const std::string& error() const {
+        return error_;
+    }
+
+private:
+    static constexpr size_t HEADER_BLOCKS = sizeof(BookSnapshotHeader) / sizeof(SnapshotBlock);
+    static constexpr size_t SYMBOL_BLOCKS = sizeof(SnapshotSymbol) / sizeof(SnapshotBlock);
+
+    bool fail(std::string message) {
+        error_ = std::move(message);
+        return false;
+    }
+
+    std::vector<SnapshotBlock> owned_;
+    std::span<const SnapshotBlock> data_;
+    BookSnapshotHeader header_{};
+    SnapshotSymbol symbol_{};
+    size_t position_ = 0;
+    uint64_t symbols_left_ = 0;
+    int64_t symbol_index_ = -1;
+    uint32_t buy_left_ = 0;
+    uint32_t sell_left_ = 0;
+    int last_price_ = 0;
+    std::string error_;
+};
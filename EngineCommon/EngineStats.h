@@ -0,0 +1,159 @@
+#pragma once
+#include "../EngineConcept/TradeSink.h"
+#include "SeqLock.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// ============================================================================
+// Engine statistics policy.
+//
+// Engines take the policy as their second template parameter. NoEngineStats
+// is the default: an empty type held with [[no_unique_address]], every hook
+// an empty inline function, so the disabled build compiles to the same code
+// as an engine without statistics. EngineStats counts orders, cancels,
+// modifies, fills, levels swept per aggressive order and the longest level
+// queue seen.
+//
+// The counters belong to the matching thread: an engine is driven by one
+// thread, so they are plain integers on a cache line of their own, not
+// atomics. Every publish_interval operations the engine adds its gauges
+// (non-empty levels, ring buffer resizes) and copies the counters into a
+// SeqLock; a monitoring thread polls that copy and never touches the live
+// counters. Rates such as orders/sec come from two snapshots and their
+// timestamps, see EngineStatsSnapshot::ordersPerSecond().
+// ============================================================================
+
+struct EngineStatsSnapshot {
+    uint64_t timestamp_ns = 0;       // steady_clock в момент публикации
+    uint64_t orders = 0;             // submitOrder
+    uint64_t cancels = 0;
+    uint64_t modifies = 0;
+    uint64_t aggressive_orders = 0;  // ордера с хотя бы одной сделкой
+    uint64_t fills = 0;
+    uint64_t levels_swept = 0;       // ценовые уровни, задетые агрессивными ордерами
+    uint64_t max_sweep_depth = 0;
+    uint64_t max_level_queue = 0;    // самая длинная очередь уровня после постановки ордера
+    uint64_t price_levels = 0;       // непустые уровни всех книг на момент публикации
+    uint64_t level_resizes = 0;      // перевыделения кольцевых буферов уровней (V4, V5)
+
+    [[nodiscard]] double fillsPerAggressiveOrder() const {
+        return aggressive_orders == 0 ? 0.0 : static_cast<double>(fills) / static_cast<double>(aggressive_orders);
+    }
+
+    [[nodiscard]] double averageSweepDepth() const {
+        return aggressive_orders == 0 ? 0.0
+                                      : static_cast<double>(levels_swept) / static_cast<double>(aggressive_orders);
+    }
+
+    // Темп между более ранним снимком и этим
+    [[nodiscard]] double ordersPerSecond(const EngineStatsSnapshot& earlier) const {
+        if (timestamp_ns <= earlier.timestamp_ns) return 0.0;
+        return static_cast<double>(orders - earlier.orders) * 1e9 /
+               static_cast<double>(timestamp_ns - earlier.timestamp_ns);
+    }
+};
+
+// Статистика выключена: все вызовы исчезают при инлайне
+struct NoEngineStats {
+    static constexpr bool ENABLED = false;
+
+    void onOrder() {}
+    void onCancel() {}
+    void onModify() {}
+    void onFill(int) {}
+    void onMatchEnd() {}
+    void onRest(size_t) {}
+};
+
+class EngineStats {
+public:
+    static constexpr bool ENABLED = true;
+    static constexpr uint32_t DEFAULT_PUBLISH_INTERVAL = 1024;
+
+    void onOrder() {
+        ++local_.orders;
+    }
+
+    void onCancel() {
+        ++local_.cancels;
+    }
+
+    void onModify() {
+        ++local_.modifies;
+    }
+
+    // Сделки одного входящего ордера идут подряд, уровни - по порядку цен
+    void onFill(int price) {
+        if (sweep_fills_ == 0 || price != sweep_price_) {
+            ++sweep_levels_;
+            sweep_price_ = price;
+        }
+        ++sweep_fills_;
+    }
+
+    // Конец сопоставления входящего ордера
+    void onMatchEnd() {
+        if (sweep_fills_ == 0) return;
+        ++local_.aggressive_orders;
+        local_.fills += sweep_fills_;
+        local_.levels_swept += sweep_levels_;
+        if (sweep_levels_ > local_.max_sweep_depth) local_.max_sweep_depth = sweep_levels_;
+        sweep_fills_ = 0;
+        sweep_levels_ = 0;
+    }
+
+    // Ордер встал в очередь, queue_length - живые ордера уровня вместе с ним
+    void onRest(size_t queue_length) {
+        if (queue_length > local_.max_level_queue) local_.max_level_queue = queue_length;
+    }
+
+    // true - прошло publish_interval операций, движку пора вызвать publish()
+    bool tick() {
+        if (++since_publish_ < publish_interval_) return false;
+        since_publish_ = 0;
+        return true;
+    }
+
+    void publish(uint64_t price_levels, uint64_t level_resizes) {
+        local_.price_levels = price_levels;
+        local_.level_resizes = level_resizes;
+        local_.timestamp_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        published_.store(local_);
+    }
+
+    // 1 - публикация после каждой операции, для тестов и отладки
+    void setPublishInterval(uint32_t operations) {
+        publish_interval_ = operations == 0 ? 1 : operations;
+        since_publish_ = 0;
+    }
+
+    // Можно читать из любого потока
+    [[nodiscard]] const SeqLock<EngineStatsSnapshot>& snapshot() const {
+        return published_;
+    }
+
+private:
+    // Пишет только поток матчинга
+    alignas(CACHE_LINE_SIZE) EngineStatsSnapshot local_{};
+    uint64_t sweep_fills_ = 0;
+    uint64_t sweep_levels_ = 0;
+    int sweep_price_ = 0;
+    uint32_t since_publish_ = 0;
+    uint32_t publish_interval_ = DEFAULT_PUBLISH_INTERVAL;
+
+    SeqLock<EngineStatsSnapshot> published_;
+};
+
+// Тот же движок с другой статистикой: BasicMatchingEngineV4<S> -> BasicMatchingEngineV4<S, EngineStats>
+template<typename Engine, typename Stats>
+struct RebindEngineStats;
+
+template<template<TradeSink, typename> class BasicEngine, TradeSink Sink, typename OldStats, typename NewStats>
+struct RebindEngineStats<BasicEngine<Sink, OldStats>, NewStats> {
+    using type = BasicEngine<Sink, NewStats>;
+};
+
+template<typename Engine, typename Stats>
+using RebindEngineStatsT = typename RebindEngineStats<Engine, Stats>::type;
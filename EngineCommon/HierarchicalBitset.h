@@ -0,0 +1,264 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// ============================================================================
+// Hierarchical occupancy bitset.
+//
+// The bottom layer holds one bit per slot, every layer above holds one bit
+// per non-zero 64-bit word of the layer below, up to a single root word.
+// findNext/findPrev touch one word per layer, so the nearest set bit costs
+// the same no matter how many clear slots lie in between.
+// ============================================================================
+
+class HierarchicalBitset {
+public:
+    static constexpr size_t NPOS = static_cast<size_t>(-1);
+
+    HierarchicalBitset() = default;
+
+    explicit HierarchicalBitset(size_t bits) {
+        reset(bits);
+    }
+
+    // Очищает все биты и задает емкость
+    void reset(size_t bits) {
+        bits_ = bits;
+        layers_.clear();
+        size_t words = (bits + 63) / 64;
+        do {
+            layers_.emplace_back(words, 0);
+            words = (words + 63) / 64;
+        } while (layers_.back().size() > 1);
+        // layers_[0] - листья, layers_.back() - корень
+    }
+
+    [[nodiscard]] size_t size() const {
+        return bits_;
+    }
+
+    [[nodiscard]] bool test(size_t i) const {
+        return (layers_[0][i / 64] >> (i % 64)) & 1;
+    }
+
+    void set(size_t i) {
+        for (auto& layer : layers_) {
+            uint64_t& word = layer[i / 64];
+            bool was_empty = word == 0;
+            word |= uint64_t{1} << (i % 64);
+            if (!was_empty) return;  // выше уже отмечено
+            i /= 64;
+        }
+    }
+
+    void clear(size_t i) {
+        for (auto& layer : layers_) {
+            uint64_t& word = layer[i / 64];
+            word &= ~(uint64_t{1} << (i % 64));
+            if (word != 0) return;  // слово не опустело - родитель не меняется
+            i /= 64;
+        }
+    }
+
+    // Наименьший установленный бит >= i
+    [[nodiscard]] size_t findNext(size_t i) const {
+        if (i >= bits_) return NPOS;
+
+        size_t layer = 0;
+        while (true) {
+            size_t w = i / 64;
+            uint64_t word = layers_[layer][w] & (~uint64_t{0} << (i % 64));
+            if (word != 0) {
+                i = w * 64 + std::countr_zero(word);
+                break;
+            }
+            if (++layer == layers_.size() || w + 1 >= layers_[layer - 1].size()) return NPOS;
+            i = w + 1;
+        }
+
+        while (layer-- > 0) {
+            i = i * 64 + std::countr_zero(layers_[layer][i]);
+        }
+        return i;
+    }
+
+    // Наибольший установленный бит <= i
+    [[nodiscard]] size_t findPrev(size_t i) const {
+        if (bits_ == 0) return NPOS;
+        if (i >= bits_) i = bits_ - 1;
+
+        size_t layer = 0;
+        while (true) {
+            size_t w = i / 64;
+            uint64_t word = layers_[layer][w] & (~uint64_t{0} >> (63 - i % 64));
+            if (word != 0) {
+                i = w * 64 + 63 - std::countl_zero(word);
+                break;
+            }
+            if (++layer == layers_.size() || w == 0) return NPOS;
+            i = w - 1;
+        }
+
+        while (layer-- > 0) {
+            i = i * 64 + 63 - std::countl_zero(layers_[layer][i]);
+        }
+        return i;
+    }
+
+private:
+    size_t bits_ = 0;
+    std::vector<std::vector<uint64_t>> layers_;
+};
+
+// Непустые ценовые уровни в окне из WINDOW тиков вокруг первой увиденной цены.
+// Для книг на std::map: цены вне окна обслуживает сама map.
+//
+// Книг тысячи, а занят обычно узкий диапазон у рынка, поэтому листья
+// выделяются блоками по BLOCK_TICKS тиков при первой цене внутри блока:
+// до первой цены индекс пуст, дальше - слово сводки и указатель на блок
+// (1 КБ на сторону книги) и 512 байт на каждый блок, где встречалась цена.
+class PriceOccupancyIndex {
+public:
+    static constexpr size_t WINDOW = size_t{1} << 18;  // три слоя: 64^3 тиков
+    static constexpr size_t BLOCK_TICKS = 64 * 64;      // один блок листьев
+
+    [[nodiscard]] bool covers(int price) const {
+        int64_t offset = int64_t{price} - base_tick_;
+        return anchored_ && offset >= 0 && offset < static_cast<int64_t>(WINDOW);
+    }
+
+    [[nodiscard]] int lowestPrice() const {
+        return base_tick_;
+    }
+
+    [[nodiscard]] int highestPrice() const {
+        return base_tick_ + static_cast<int>(WINDOW) - 1;
+    }
+
+    void markNonEmpty(int price) {
+        if (!anchored_) {
+            anchored_ = true;
+            base_tick_ = price - static_cast<int>(WINDOW / 2);
+            summary_.assign(BLOCKS, 0);
+            blocks_.resize(BLOCKS);
+        }
+        if (covers(price)) {
+            set(static_cast<size_t>(price - base_tick_));
+        }
+    }
+
+    void markEmpty(int price) {
+        if (covers(price)) {
+            clear(static_cast<size_t>(price - base_tick_));
+        }
+    }
+
+    // Ближайшая непустая цена <= price (>= price), price внутри окна
+    [[nodiscard]] std::optional<int> findAtOrBelow(int price) const {
+        size_t idx = findPrev(static_cast<size_t>(price - base_tick_));
+        if (idx == HierarchicalBitset::NPOS) return std::nullopt;
+        return base_tick_ + static_cast<int>(idx);
+    }
+
+    [[nodiscard]] std::optional<int> findAtOrAbove(int price) const {
+        size_t idx = findNext(static_cast<size_t>(price - base_tick_));
+        if (idx == HierarchicalBitset::NPOS) return std::nullopt;
+        return base_tick_ + static_cast<int>(idx);
+    }
+
+    // Байты в куче: сводка и выделенные блоки листьев
+    [[nodiscard]] size_t allocatedBytes() const {
+        return summary_.capacity() * sizeof(uint64_t) +
+               blocks_.capacity() * sizeof(std::unique_ptr<LeafBlock>) +
+               static_cast<size_t>(std::popcount(allocated_)) * sizeof(LeafBlock);
+    }
+
+private:
+    static constexpr size_t BLOCKS = WINDOW / BLOCK_TICKS;  // 64, по биту в root_
+    static_assert(BLOCKS == 64);
+
+    using LeafBlock = std::array<uint64_t, BLOCK_TICKS / 64>;
+
+    // Маска битов слова строго выше (ниже) позиции bit
+    static uint64_t above(size_t bit) {
+        return bit == 63 ? 0 : ~uint64_t{0} << (bit + 1);
+    }
+
+    static uint64_t below(size_t bit) {
+        return bit == 0 ? 0 : ~uint64_t{0} >> (64 - bit);
+    }
+
+    void set(size_t i) {
+        size_t block = i / BLOCK_TICKS;
+        size_t word = i / 64 % 64;
+        if (!blocks_[block]) {
+            blocks_[block] = std::make_unique<LeafBlock>();  // нули
+            allocated_ |= uint64_t{1} << block;
+        }
+        (*blocks_[block])[word] |= uint64_t{1} << (i % 64);
+        summary_[block] |= uint64_t{1} << word;
+        root_ |= uint64_t{1} << block;
+    }
+
+    void clear(size_t i) {
+        size_t block = i / BLOCK_TICKS;
+        size_t word = i / 64 % 64;
+        if (!blocks_[block]) return;
+        // Блок остается выделенным: уровни у рынка пустеют и заполняются снова
+        uint64_t& leaf = (*blocks_[block])[word];
+        leaf &= ~(uint64_t{1} << (i % 64));
+        if (leaf != 0) return;
+        summary_[block] &= ~(uint64_t{1} << word);
+        if (summary_[block] == 0) root_ &= ~(uint64_t{1} << block);
+    }
+
+    // Наименьший установленный бит >= i
+    [[nodiscard]] size_t findNext(size_t i) const {
+        size_t block = i / BLOCK_TICKS;
+        size_t word = i / 64 % 64;
+        if (summary_[block] >> word & 1) {
+            uint64_t leaf = (*blocks_[block])[word] & (~uint64_t{0} << (i % 64));
+            if (leaf != 0) return block * BLOCK_TICKS + word * 64 + std::countr_zero(leaf);
+        }
+        uint64_t words = summary_[block] & above(word);
+        if (words == 0) {
+            uint64_t rest = root_ & above(block);
+            if (rest == 0) return HierarchicalBitset::NPOS;
+            block = std::countr_zero(rest);
+            words = summary_[block];
+        }
+        word = std::countr_zero(words);
+        return block * BLOCK_TICKS + word * 64 + std::countr_zero((*blocks_[block])[word]);
+    }
+
+    // Наибольший установленный бит <= i
+    [[nodiscard]] size_t findPrev(size_t i) const {
+        size_t block = i / BLOCK_TICKS;
+        size_t word = i / 64 % 64;
+        if (summary_[block] >> word & 1) {
+            uint64_t leaf = (*blocks_[block])[word] & (~uint64_t{0} >> (63 - i % 64));
+            if (leaf != 0) return block * BLOCK_TICKS + word * 64 + 63 - std::countl_zero(leaf);
+        }
+        uint64_t words = summary_[block] & below(word);
+        if (words == 0) {
+            uint64_t rest = root_ & below(block);
+            if (rest == 0) return HierarchicalBitset::NPOS;
+            block = 63 - std::countl_zero(rest);
+            words = summary_[block];
+        }
+        word = 63 - std::countl_zero(words);
+        return block * BLOCK_TICKS + word * 64 + 63 - std::countl_zero((*blocks_[block])[word]);
+    }
+
+    uint64_t root_ = 0;                                  // бит на блок с непустыми словами
+    uint64_t allocated_ = 0;                             // бит на выделенный блок
+    std::vector<uint64_t> summary_;                      // по слову на блок: бит на непустое слово листьев
+    std::vector<std::unique_ptr<LeafBlock>> blocks_;     // листья, nullptr - в блоке не было цен
+    int base_tick_ = 0;
+    bool anchored_ = false;
+};
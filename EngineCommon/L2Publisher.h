@@ -0,0 +1,85 @@
+#pragma once
+#include "../EngineConcept/MarketData.h"
+#include <functional>
+#include <span>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// Incremental L2 publisher.
+//
+// The engine touches every level it is about to change; the first touch in
+// an operation remembers the level's aggregate before the change. At the end
+// of submitOrder/cancelOrder/modifyOrder publish() compares it with the
+// level's current aggregate and emits one ADD/CHANGE/DELETE per level, so an
+// aggressive sweep through N orders on K levels yields a single batch of at
+// most K + 1 updates. Disabled by default: touch() is then a single branch.
+// ============================================================================
+
+class L2Publisher {
+public:
+    using Callback = std::function<void(std::span<const L2Update>)>;
+
+    // Пачка уходит в callback; без callback ее можно забрать через updates()
+    void setCallback(Callback callback) {
+        callback_ = std::move(callback);
+        enabled_ = static_cast<bool>(callback_);
+    }
+
+    void setEnabled(bool enabled) {
+        enabled_ = enabled;
+        touched_.clear();
+        updates_.clear();
+    }
+
+    [[nodiscard]] bool enabled() const {
+        return enabled_;
+    }
+
+    // Вызывается до изменения уровня. Book::levelAt(side, price) -> DepthLevel
+    template<typename Book>
+    void touch(const Book& book, Side side, int price) {
+        if (!enabled_) return;
+        // Свип касается одного уровня много раз подряд: ищем с конца
+        for (auto it = touched_.rbegin(); it != touched_.rend(); ++it) {
+            if (it->price == price && it->side == side) return;
+        }
+        touched_.push_back({side, price, book.levelAt(side, price)});
+    }
+
+    template<typename Book>
+    void publish(SymbolId symbol_id, const Book& book) {
+        if (!enabled_) return;
+        updates_.clear();
+        for (const Touched& touched : touched_) {
+            DepthLevel now = book.levelAt(touched.side, touched.price);
+            if (now == touched.before) continue;  // например, ордер встал и тут же снят
+
+            L2Update::Action action = touched.before.order_count == 0 ? L2Update::Action::ADD
+                    : now.order_count == 0 ? L2Update::Action::DELETE
+                    : L2Update::Action::CHANGE;
+            updates_.push_back({symbol_id, touched.side, action, touched.price, now.order_count, now.quantity});
+        }
+        touched_.clear();
+        if (callback_ && !updates_.empty()) {
+            callback_(updates_);
+        }
+    }
+
+    // Пачка последней операции
+    [[nodiscard]] std::span<const L2Update> updates() const {
+        return updates_;
+    }
+
+private:
+    struct Touched {
+        Side side;
+        int price;
+        DepthLevel before;
+    };
+
+    std::vector<Touched> touched_;
+    std::vector<L2Update> updates_;
+    Callback callback_;
+    bool enabled_ = false;
+};
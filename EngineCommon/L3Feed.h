@@ -0,0 +1,73 @@
+#pragma once
+#include "../EngineConcept/MarketData.h"
+#include "SpscQueue.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// ============================================================================
+// L3 feed writer.
+//
+// Events go into an SpscQueue allocated once by enable(), so the matching
+// thread only copies 48 bytes per event and a consumer may drain the ring
+// from another thread. A full ring never blocks matching: the event is
+// dropped and counted, its sequence number is still consumed, so the
+// consumer sees the gap. Disabled by default.
+// ============================================================================
+
+class L3Feed {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+
+    // Вызывается до начала торговли: здесь единственная аллокация кольца
+    void enable(size_t capacity = DEFAULT_CAPACITY) {
+        queue_ = std::make_unique<SpscQueue<L3Event>>(capacity);
+    }
+
+    [[nodiscard]] bool enabled() const {
+        return queue_ != nullptr;
+    }
+
+    void add(SymbolId symbol_id, Side side, uint64_t order_id, int price, uint64_t quantity, uint64_t timestamp) {
+        record(L3Event::Type::ADD, symbol_id, side, order_id, price, quantity, timestamp);
+    }
+
+    void execute(SymbolId symbol_id, Side side, uint64_t order_id, int price, uint64_t quantity, uint64_t timestamp) {
+        record(L3Event::Type::EXECUTE, symbol_id, side, order_id, price, quantity, timestamp);
+    }
+
+    void cancel(SymbolId symbol_id, Side side, uint64_t order_id, int price, uint64_t quantity, uint64_t timestamp) {
+        record(L3Event::Type::CANCEL, symbol_id, side, order_id, price, quantity, timestamp);
+    }
+
+    void replace(SymbolId symbol_id, Side side, uint64_t order_id, int price, uint64_t quantity, uint64_t timestamp) {
+        record(L3Event::Type::REPLACE, symbol_id, side, order_id, price, quantity, timestamp);
+    }
+
+    // Сторона потребителя
+    bool poll(L3Event& event) {
+        return queue_ != nullptr && queue_->tryPop(event);
+    }
+
+    [[nodiscard]] uint64_t dropped() const {
+        return dropped_;
+    }
+
+private:
+    void record(L3Event::Type type, SymbolId symbol_id, Side side, uint64_t order_id,
+                int price, uint64_t quantity, uint64_t timestamp) {
+        if (!queue_) return;
+        if (symbol_id >= sequences_.size()) {
+            sequences_.resize(symbol_id + 1, 0);  // один раз на новый символ
+        }
+        L3Event event{++sequences_[symbol_id], timestamp, order_id, quantity, symbol_id, price, side, type};
+        if (!queue_->tryPush(event)) {
+            ++dropped_;
+        }
+    }
+
+    std::unique_ptr<SpscQueue<L3Event>> queue_;
+    std::vector<uint64_t> sequences_;
+    uint64_t dropped_ = 0;
+};
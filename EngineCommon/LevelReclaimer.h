@@ -0,0 +1,108 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <vector>
+
+// ============================================================================
+// Empty price level reclamation for map-based books.
+//
+// A level that empties near the touch is likely to be refilled soon, so it
+// stays in the map and keeps its node. Two rules bound how many such levels
+// a side can retain:
+//   - a level that empties more than `price_band` ticks away from the best
+//     price of its side is erased at once;
+//   - at most `max_retained` emptied levels wait in a FIFO. When a new one
+//     arrives, the oldest is handed back to the book, which erases it if it
+//     is still empty.
+// The FIFO starts empty and doubles up to `max_retained` as levels empty, so
+// a book that never churns costs nothing; the limit is set per book.
+// Everything happens inline on the matching thread, amortized O(1) per
+// emptied level.
+// ============================================================================
+
+class EmptyLevelReclaimer {
+public:
+    static constexpr size_t DEFAULT_MAX_RETAINED = 1024;
+    static constexpr int DEFAULT_PRICE_BAND = 4096;
+
+    explicit EmptyLevelReclaimer(size_t max_retained = DEFAULT_MAX_RETAINED,
+                                 int price_band = DEFAULT_PRICE_BAND)
+            : max_retained_(max_retained < 1 ? 1 : max_retained),
+              price_band_(price_band) {}
+
+    // Новый лимит действует со следующего retain(): лишние кандидаты
+    // вытесняются по одному вместе с ним
+    void setMaxRetained(size_t max_retained) {
+        max_retained_ = max_retained < 1 ? 1 : max_retained;
+    }
+
+    [[nodiscard]] size_t maxRetained() const {
+        return max_retained_;
+    }
+
+    // Пустая сторона книги: полосы нет, работает только лимит очереди
+    [[nodiscard]] bool outsideBand(int price, std::optional<int> best_price) const {
+        return best_price.has_value() && std::abs(int64_t{price} - *best_price) > price_band_;
+    }
+
+    // Метка опустевшего уровня: уровень хранит ее, пока снова не опустеет
+    uint64_t nextStamp() {
+        return ++stamp_;
+    }
+
+    // Ставит уровень в очередь. Если очередь полна, самый старый кандидат
+    // уходит в evict(price, stamp); книга удаляет уровень, только если он
+    // все еще пуст и его метка совпадает (иначе его успели заполнить).
+    template<typename Evict>
+    void retain(int price, uint64_t stamp, Evict&& evict) {
+        while (count_ >= max_retained_) {
+            Candidate oldest = candidates_[head_];
+            head_ = (head_ + 1) & (candidates_.size() - 1);
+            --count_;
+            evict(oldest.price, oldest.stamp);
+        }
+        if (count_ == candidates_.size()) {
+            grow();
+        }
+        candidates_[(head_ + count_) & (candidates_.size() - 1)] = {price, stamp};
+        ++count_;
+    }
+
+    [[nodiscard]] size_t pending() const {
+        return count_;
+    }
+
+    [[nodiscard]] size_t capacity() const {
+        return candidates_.size();
+    }
+
+private:
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    struct Candidate {
+        int price;
+        uint64_t stamp;
+    };
+
+    // Удвоение кольца, не больше степени двойки над лимитом
+    void grow() {
+        size_t new_size = std::min(std::max(candidates_.size() * 2, MIN_CAPACITY), std::bit_ceil(max_retained_));
+        std::vector<Candidate> new_candidates(new_size);
+        for (size_t i = 0; i < count_; ++i) {
+            new_candidates[i] = candidates_[(head_ + i) & (candidates_.size() - 1)];
+        }
+        candidates_ = std::move(new_candidates);
+        head_ = 0;
+    }
+
+    std::vector<Candidate> candidates_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    size_t max_retained_;
+    int price_band_;
+    uint64_t stamp_ = 0;
+};
@@ -0,0 +1,105 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// Order-id -> location map without per-entry allocations.
+//
+// Open addressing with linear probing in a power-of-two table, erase shifts
+// the following entries back instead of leaving tombstones, so lookups stay
+// short under constant insert/erase churn. The table only grows when the
+// load factor passes 1/2: reserve() for the expected resting depth keeps
+// the hot path allocation free. Every key is valid, UINT64_MAX included:
+// a slot carries its own occupancy flag instead of reserving a sentinel key.
+// ============================================================================
+
+template<typename Value>
+class OrderIdMap {
+public:
+    explicit OrderIdMap(size_t expected = 1024) {
+        reserve(expected);
+    }
+
+    void reserve(size_t expected) {
+        size_t capacity = std::bit_ceil(std::max<size_t>(expected * 2, 16));
+        if (capacity > slots_.size()) {
+            rehash(capacity);
+        }
+    }
+
+    [[nodiscard]] size_t size() const {
+        return size_;
+    }
+
+    [[nodiscard]] Value* find(uint64_t key) {
+        for (size_t i = home(key);; i = (i + 1) & mask_) {
+            if (!slots_[i].occupied) return nullptr;
+            if (slots_[i].key == key) return &slots_[i].value;
+        }
+    }
+
+    void insert_or_assign(uint64_t key, const Value& value) {
+        if ((size_ + 1) * 2 > slots_.size()) {
+            rehash(slots_.size() * 2);
+        }
+        size_t i = home(key);
+        while (slots_[i].occupied && slots_[i].key != key) {
+            i = (i + 1) & mask_;
+        }
+        if (!slots_[i].occupied) ++size_;
+        slots_[i] = {key, true, value};
+    }
+
+    bool erase(uint64_t key) {
+        size_t i = home(key);
+        while (slots_[i].occupied && slots_[i].key != key) {
+            i = (i + 1) & mask_;
+        }
+        if (!slots_[i].occupied) return false;
+
+        // Backward shift: подтягиваем хвост кластера, чтобы цепочки проб не рвались
+        for (size_t j = (i + 1) & mask_; slots_[j].occupied; j = (j + 1) & mask_) {
+            size_t h = home(slots_[j].key);
+            // slots_[j] можно перенести в дыру i, если его домашний слот не лежит в (i, j]
+            if (((j - h) & mask_) >= ((j - i) & mask_)) {
+                slots_[i] = slots_[j];
+                i = j;
+            }
+        }
+        slots_[i].occupied = false;
+        --size_;
+        return true;
+    }
+
+private:
+    struct Slot {
+        uint64_t key = 0;
+        bool occupied = false;
+        Value value{};
+    };
+
+    [[nodiscard]] size_t home(uint64_t key) const {
+        // Фибоначчиево хеширование: последовательные id расходятся по таблице
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<Slot> old = std::move(slots_);
+        slots_.assign(capacity, Slot{});
+        mask_ = capacity - 1;
+        shift_ = 64 - std::countr_zero(capacity);
+        size_ = 0;
+        for (const Slot& slot : old) {
+            if (slot.occupied) insert_or_assign(slot.key, slot.value);
+        }
+    }
+
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+    int shift_ = 64;
+    size_t size_ = 0;
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// Engine-owned pool of order records.
+//
+// Slots are carved out of slabs allocated up front, a free slot stores the
+// link to the next free one in place of the record (intrusive free list), so
+// acquire/release are a couple of pointer moves. A new slab is allocated only
+// when the pool runs dry: size the first slab for the peak resting depth and
+// the steady state performs no heap allocations.
+// ============================================================================
+
+template<typename T>
+class OrderPool {
+public:
+    static constexpr size_t DEFAULT_SLAB_SIZE = 65536;
+
+    struct Stats {
+        size_t capacity;         // слотов во всех слабах
+        size_t in_use;           // занятых слотов сейчас
+        size_t high_water_mark;  // максимум in_use за время жизни пула
+        size_t slabs;            // >1 означает, что пул рос на горячем пути
+    };
+
+    explicit OrderPool(size_t slab_size = DEFAULT_SLAB_SIZE) : slab_size_(slab_size) {
+        addSlab();
+    }
+
+    OrderPool(const OrderPool&) = delete;
+    OrderPool& operator=(const OrderPool&) = delete;
+
+    ~OrderPool() {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            // Разрушаем записи, которые так и не вернули в пул
+            std::vector<const Slot*> free_slots;
+            for (const Slot* slot = free_; slot != nullptr; slot = slot->next_free) {
+                free_slots.push_back(slot);
+            }
+            std::sort(free_slots.begin(), free_slots.end());
+            for (auto& slab : slabs_) {
+                for (size_t i = 0; i < slab_size_; ++i) {
+                    if (!std::binary_search(free_slots.begin(), free_slots.end(), &slab[i])) {
+                        std::destroy_at(&slab[i].value);
+                    }
+                }
+            }
+        }
+    }
+
+    template<typename... Args>
+    T* acquire(Args&&... args) {
+        if (free_ == nullptr) {
+            addSlab();
+        }
+        Slot* slot = free_;
+        free_ = slot->next_free;
+
+        T* object = std::construct_at(&slot->value, std::forward<Args>(args)...);
+        high_water_mark_ = std::max(high_water_mark_, ++in_use_);
+        return object;
+    }
+
+    void release(T* object) {
+        std::destroy_at(object);
+        Slot* slot = reinterpret_cast<Slot*>(object);  // член union и сам union взаимопреобразуемы
+        slot->next_free = free_;
+        free_ = slot;
+        --in_use_;
+    }
+
+    [[nodiscard]] Stats stats() const {
+        return {slabs_.size() * slab_size_, in_use_, high_water_mark_, slabs_.size()};
+    }
+
+private:
+    union Slot {
+        T value;
+        Slot* next_free;
+
+        Slot() : next_free(nullptr) {}
+        ~Slot() {}
+    };
+
+    void addSlab() {
+        auto slab = std::make_unique<Slot[]>(slab_size_);
+        for (size_t i = slab_size_; i-- > 0;) {
+            slab[i].next_free = free_;
+            free_ = &slab[i];
+        }
+        slabs_.push_back(std::move(slab));
+    }
+
+    size_t slab_size_;
+    std::vector<std::unique_ptr<Slot[]>> slabs_;
+    Slot* free_ = nullptr;
+    size_t in_use_ = 0;
+    size_t high_water_mark_ = 0;
+};
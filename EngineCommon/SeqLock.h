@@ -0,0 +1,82 @@
+#pragma once
+#include "SpscQueue.h"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// ============================================================================
+// Single-writer sequence lock.
+//
+// The writer bumps the sequence to odd, copies the value, bumps it to even;
+// it never waits for readers. A reader copies the value between two loads of
+// the sequence and keeps the copy only if both loads saw the same even
+// number. tryLoad() is one attempt and therefore wait-free; load() retries,
+// which only happens while a store is in flight (a few stores long).
+// The payload is kept in relaxed atomic words so torn reads are not races.
+// ============================================================================
+
+template<typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T>, "значение копируется по словам");
+    static_assert(sizeof(T) % sizeof(uint64_t) == 0, "размер должен быть кратен 8 байтам");
+
+    static constexpr size_t WORDS = sizeof(T) / sizeof(uint64_t);
+
+public:
+    SeqLock() {
+        store(T{});
+    }
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    // Только поток-писатель
+    void store(const T& value) {
+        const auto words = std::bit_cast<std::array<uint64_t, WORDS>>(value);
+
+        const uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; ++i) {
+            words_[i].store(words[i], std::memory_order_relaxed);
+        }
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    // false - писатель как раз обновлял значение, out не тронут
+    bool tryLoad(T& out) const {
+        const uint64_t before = sequence_.load(std::memory_order_acquire);
+        if (before & 1) return false;
+
+        std::array<uint64_t, WORDS> words;
+        for (size_t i = 0; i < WORDS; ++i) {
+            words[i] = words_[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence_.load(std::memory_order_relaxed) != before) return false;
+
+        out = std::bit_cast<T>(words);
+        return true;
+    }
+
+    [[nodiscard]] T load() const {
+        T value;
+        SpinBackoff backoff;
+        while (!tryLoad(value)) {
+            backoff.pause();
+        }
+        return value;
+    }
+
+    // Число завершенных записей: читатель видит, менялось ли значение
+    [[nodiscard]] uint64_t version() const {
+        return sequence_.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> sequence_{0};
+    std::array<std::atomic<uint64_t>, WORDS> words_{};
+};
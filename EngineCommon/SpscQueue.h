@@ -0,0 +1,97 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// ============================================================================
+// Lock-free single-producer / single-consumer ring buffer.
+//
+// Head and tail live on separate cache lines, each side keeps a cached copy
+// of the other side's index and only reloads it when the ring looks full
+// (producer) or empty (consumer), so an uncontended push or pop touches no
+// shared cache line besides the slot itself.
+// ============================================================================
+
+inline constexpr size_t CACHE_LINE_SIZE = 64;
+
+template<typename T>
+class SpscQueue {
+    static_assert(std::is_trivially_copyable_v<T>, "элементы копируются через слот кольца");
+
+public:
+    explicit SpscQueue(size_t capacity)
+            : slots_(std::bit_ceil(capacity < 2 ? size_t{2} : capacity)),
+              mask_(slots_.size() - 1) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    [[nodiscard]] size_t capacity() const {
+        return slots_.size();
+    }
+
+    // Только поток-производитель
+    bool tryPush(const T& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ == slots_.size()) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ == slots_.size()) return false;
+        }
+        slots_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Только поток-потребитель
+    bool tryPop(T& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) return false;
+        }
+        value = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Приблизительно: точное значение только когда обе стороны стоят
+    [[nodiscard]] bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> slots_;
+    size_t mask_;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_{0};  // пишет потребитель
+    size_t cached_tail_ = 0;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_{0};  // пишет производитель
+    size_t cached_head_ = 0;
+};
+
+// Ожидание на кольце: сначала крутимся, потом уступаем ядро, чтобы
+// производитель и потребитель не голодали на одном CPU
+class SpinBackoff {
+public:
+    void pause() {
+        if (++spins_ < SPIN_LIMIT) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    void reset() {
+        spins_ = 0;
+    }
+
+private:
+    static constexpr unsigned SPIN_LIMIT = 64;
+    unsigned spins_ = 0;
+};
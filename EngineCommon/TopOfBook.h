@@ -0,0 +1,63 @@
+#pragma once
+#include "../EngineConcept/MarketData.h"
+#include "SeqLock.h"
+#include <cstddef>
+#include <deque>
+
+// ============================================================================
+// Per-symbol top-of-book snapshots for threads other than the matching one.
+//
+// Once enabled, the matching thread calls publish() after every operation;
+// a snapshot is rewritten only when the best levels actually changed, so
+// readers spinning on an unchanged book do not pull its cache line away from
+// the writer. Disabled by default: publish() is then a single branch.
+// Slots live in a deque and never move: a reader resolves snapshot(id) once
+// after the symbol is registered and may keep the reference for the session.
+// ============================================================================
+
+class TopOfBookBoard {
+public:
+    // Регистрация символов - до запуска читателей, как и для книг
+    void ensure(SymbolId symbol_id) {
+        while (slots_.size() <= symbol_id) {
+            slots_.emplace_back();
+        }
+    }
+
+    void setEnabled(bool enabled) {
+        enabled_ = enabled;
+    }
+
+    [[nodiscard]] bool enabled() const {
+        return enabled_;
+    }
+
+    // Book::topOfBook() -> TopOfBook
+    template<typename Book>
+    void publish(SymbolId symbol_id, const Book& book) {
+        if (!enabled_) return;
+        ensure(symbol_id);
+        const TopOfBook top = book.topOfBook();
+        Slot& slot = slots_[symbol_id];
+        if (top == slot.published) return;
+        slot.published = top;
+        slot.snapshot.store(top);
+    }
+
+    [[nodiscard]] const SeqLock<TopOfBook>& snapshot(SymbolId symbol_id) const {
+        return slots_[symbol_id].snapshot;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return slots_.size();
+    }
+
+private:
+    struct Slot {
+        SeqLock<TopOfBook> snapshot;
+        TopOfBook published{};  // копия писателя, читатели ее не трогают
+    };
+
+    std::deque<Slot> slots_;
+    bool enabled_ = false;
+};
@@ -0,0 +1,77 @@
+#pragma once
+#include "Order.h"
+#include <cstdint>
+
+// ============================================================================
+// Market data views of the book.
+//
+// DepthLevel is the aggregate of one price level: every engine maintains
+// quantity and order count per level incrementally (adds, fills, partial
+// fills, cancels, modifies), so a depth snapshot reads N levels and never
+// walks individual orders.
+// ============================================================================
+
+struct DepthLevel {
+    int price;
+    uint32_t order_count;
+    uint64_t quantity;
+
+    bool operator==(const DepthLevel&) const = default;
+};
+
+// Инкрементальное L2-обновление: новое состояние уровня после операции
+struct L2Update {
+    enum class Action : uint8_t {
+        ADD,     // уровень появился
+        CHANGE,  // изменились количество или число ордеров
+        DELETE   // уровень опустел, order_count и quantity нулевые
+    };
+
+    SymbolId symbol_id;
+    Side side;
+    Action action;
+    int price;
+    uint32_t order_count;
+    uint64_t quantity;
+};
+
+// ============================================================================
+// L3 (order-by-order) event.
+//
+// sequence is gap-free per symbol: a consumer that sees a jump knows it lost
+// events and must resynchronise from a snapshot. timestamp is the engine
+// clock (next_timestamp_) at the moment of the event.
+//   ADD      order rests with `quantity` at `price`
+//   EXECUTE  resting order traded `quantity` (remaining size drops by it,
+//            the order leaves the book at zero)
+//   CANCEL   order left the book, `quantity` is what was still resting
+//   REPLACE  quantity reduced in place to `quantity`, time priority kept
+// A price change is CANCEL followed by executions of the re-entered order
+// as an aggressor (not reported) and possibly ADD with the same order_id.
+// ============================================================================
+
+struct L3Event {
+    enum class Type : uint8_t {
+        ADD,
+        EXECUTE,
+        CANCEL,
+        REPLACE
+    };
+
+    uint64_t sequence;
+    uint64_t timestamp;
+    uint64_t order_id;
+    uint64_t quantity;
+    SymbolId symbol_id;
+    int price;
+    Side side;
+    Type type;
+};
+
+// Лучшие цены обеих сторон; пустая сторона - order_count == 0
+struct TopOfBook {
+    DepthLevel bid;
+    DepthLevel ask;
+
+    bool operator==(const TopOfBook&) const = default;
+};
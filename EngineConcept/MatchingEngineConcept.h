@@ -1,7 +1,10 @@
 #pragma once
+#include "MarketData.h"
 #include "Order.h"
+#include "SymbolRegistry.h"
 #include <concepts>
 #include <memory>
+#include <span>
 #include <string>
 #include <vector>
 #include <functional>
@@ -16,13 +19,26 @@ template<typename T>
 concept MatchingEngineConcept = requires(T engine,
                                          const T const_engine,
                                          std::unique_ptr<Order> order,
+                                         const OrderRecord& record,
                                          const std::string& symbol,
+                                         uint64_t order_id,
+                                         uint64_t quantity,
+                                         int price,
+                                         Side side,
+                                         size_t levels,
                                          std::function<void(const Trade&)> callback) {
-    { engine.submitOrder(std::move(order)) } -> std::same_as<void>;
+    { engine.submitOrder(std::move(order)) } -> std::same_as<bool>;
+    { engine.submitOrder(record) } -> std::same_as<bool>;
+    { engine.registerSymbol(symbol) } -> std::same_as<SymbolId>;
+    { engine.cancelOrder(order_id) } -> std::same_as<bool>;
+    { engine.modifyOrder(order_id, quantity, price) } -> std::same_as<bool>;
 
     { const_engine.getBuyOrderCount() } -> std::same_as<size_t>;
     { const_engine.getSellOrderCount() } -> std::same_as<size_t>;
-    //{ const_engine.getTrades() } -> std::convertible_to<const std::vector<Trade>&>;
+    { const_engine.getBuyOrderCount(symbol) } -> std::same_as<size_t>;
+    { const_engine.getSellOrderCount(symbol) } -> std::same_as<size_t>;
+    { const_engine.getTrades() } -> std::convertible_to<std::span<const Trade>>;
+    { const_engine.getDepth(symbol, side, levels) } -> std::same_as<std::vector<DepthLevel>>;
 
     { engine.clearTrades() } -> std::same_as<void>;
     { engine.setTradeCallback(callback) } -> std::same_as<void>;
@@ -1,6 +1,12 @@
 #pragma once
 #include <cstdint>
+#include <limits>
 #include <string>
+#include <type_traits>
+
+// Dense per-session symbol identifier, see SymbolRegistry.h
+using SymbolId = uint32_t;
+inline constexpr SymbolId INVALID_SYMBOL_ID = std::numeric_limits<SymbolId>::max();
 
 enum class OrderType {
     LIMIT,
@@ -12,6 +18,49 @@ enum class Side {
     SELL
 };
 
+// Compact order layout for the hot path: trivially copyable, 32 bytes, so two
+// records share a cache line in price-level queues and can be memcpy'd into
+// ring buffers and journals. Quantity is 32-bit, side and type are packed
+// into flags.
+struct alignas(32) OrderRecord {
+    static constexpr uint8_t SELL_FLAG = 1 << 0;
+    static constexpr uint8_t MARKET_FLAG = 1 << 1;
+
+    uint64_t order_id;
+    uint64_t timestamp;
+    int32_t price;
+    uint32_t quantity;
+    SymbolId symbol_id;
+    uint8_t flags;
+
+    [[nodiscard]] Side side() const {
+        return (flags & SELL_FLAG) ? Side::SELL : Side::BUY;
+    }
+
+    [[nodiscard]] OrderType type() const {
+        return (flags & MARKET_FLAG) ? OrderType::MARKET : OrderType::LIMIT;
+    }
+
+    [[nodiscard]] static uint8_t packFlags(Side side, OrderType type) {
+        return static_cast<uint8_t>((side == Side::SELL ? SELL_FLAG : 0) |
+                                    (type == OrderType::MARKET ? MARKET_FLAG : 0));
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<OrderRecord>);
+static_assert(sizeof(OrderRecord) == 32, "two OrderRecords per 64-byte cache line");
+
+// Largest quantity an OrderRecord can carry. Engines and the pipeline reject
+// larger orders and modifies at ingress instead of truncating them.
+inline constexpr uint64_t MAX_ORDER_QUANTITY = std::numeric_limits<uint32_t>::max();
+
+// The caller checks quantity against MAX_ORDER_QUANTITY first
+inline OrderRecord makeOrderRecord(uint64_t id, SymbolId sym_id, Side side, OrderType type,
+                                   int price, uint64_t quantity, uint64_t timestamp) {
+    return OrderRecord{id, timestamp, static_cast<int32_t>(price), static_cast<uint32_t>(quantity),
+                       sym_id, OrderRecord::packFlags(side, type)};
+}
+
 struct Order {
     uint64_t order_id;
     std::string symbol;
@@ -20,21 +69,44 @@ struct Order {
     int price;
     uint64_t quantity;
     uint64_t timestamp;
+    SymbolId symbol_id;
 
     Order(uint64_t id, const std::string& sym, Side s, OrderType t,
           int p, uint64_t q, uint64_t ts)
             : order_id(id), symbol(sym), side(s), type(t),
-              price(p), quantity(q), timestamp(ts) {}
+              price(p), quantity(q), timestamp(ts), symbol_id(INVALID_SYMBOL_ID) {}
+
+    // Hot-path constructor: the symbol was interned at session start,
+    // the engine routes by symbol_id and never touches the string
+    Order(uint64_t id, SymbolId sym_id, Side s, OrderType t,
+          int p, uint64_t q, uint64_t ts)
+            : order_id(id), side(s), type(t),
+              price(p), quantity(q), timestamp(ts), symbol_id(sym_id) {}
+
+    explicit Order(const OrderRecord& record)
+            : order_id(record.order_id), side(record.side()), type(record.type()),
+              price(record.price), quantity(record.quantity),
+              timestamp(record.timestamp), symbol_id(record.symbol_id) {}
+
+    // The symbol must already be interned: the record keeps only symbol_id
+    [[nodiscard]] OrderRecord toRecord() const {
+        return makeOrderRecord(order_id, symbol_id, side, type, price, quantity, timestamp);
+    }
 };
 
+// Fields in decreasing size order, so the record has no padding holes
 struct Trade {
     uint64_t buy_order_id;
     uint64_t sell_order_id;
-    int price;
     uint64_t quantity;
     uint64_t timestamp;
+    int price;
+
+    Trade() = default;  // slots of preallocated rings
 
     Trade(uint64_t buy_id, uint64_t sell_id, int p, uint64_t q, uint64_t ts)
             : buy_order_id(buy_id), sell_order_id(sell_id),
-              price(p), quantity(q), timestamp(ts) {}
-};
\ No newline at end of file
+              quantity(q), timestamp(ts), price(p) {}
+};
+
+static_assert(std::is_trivially_copyable_v<Trade>);
\ No newline at end of file
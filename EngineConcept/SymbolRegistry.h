@@ -0,0 +1,92 @@
+#pragma once
+#include "Order.h"
+#include <cassert>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ============================================================================
+// Symbol registry: interns symbols into dense SymbolId values at session start.
+// Strings are hashed only when a symbol is registered or looked up by name,
+// the matching path indexes books by SymbolId.
+// ============================================================================
+
+class SymbolRegistry {
+public:
+    SymbolId intern(const std::string& symbol) {
+        auto [it, inserted] = ids_.try_emplace(symbol, static_cast<SymbolId>(names_.size()));
+        if (inserted) {
+            names_.push_back(symbol);
+        }
+        return it->second;
+    }
+
+    [[nodiscard]] SymbolId find(const std::string& symbol) const {
+        auto it = ids_.find(symbol);
+        return it == ids_.end() ? INVALID_SYMBOL_ID : it->second;
+    }
+
+    [[nodiscard]] const std::string& name(SymbolId id) const {
+        return names_[id];
+    }
+
+    [[nodiscard]] size_t size() const {
+        return names_.size();
+    }
+
+private:
+    std::unordered_map<std::string, SymbolId> ids_;
+    std::vector<std::string> names_;
+};
+
+// Per-symbol books addressed by SymbolId: book(id) is a plain vector index.
+// Register all symbols before handing out references to books, registering
+// a new symbol may reallocate the storage.
+template<typename Book>
+class PerSymbolBooks {
+public:
+    SymbolId registerSymbol(const std::string& symbol) {
+        SymbolId id = registry_.intern(symbol);
+        if (id >= books_.size()) {
+            books_.resize(id + 1);
+        }
+        return id;
+    }
+
+    void reserve(size_t symbols) {
+        books_.reserve(symbols);
+    }
+
+    Book& book(SymbolId id) {
+        assert(id < books_.size());
+        return books_[id];
+    }
+
+    [[nodiscard]] const Book& book(SymbolId id) const {
+        assert(id < books_.size());
+        return books_[id];
+    }
+
+    // nullptr if the symbol was never registered
+    [[nodiscard]] const Book* find(const std::string& symbol) const {
+        SymbolId id = registry_.find(symbol);
+        return id == INVALID_SYMBOL_ID ? nullptr : &books_[id];
+    }
+
+    [[nodiscard]] const SymbolRegistry& registry() const {
+        return registry_;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return books_.size();
+    }
+
+    auto begin() { return books_.begin(); }
+    auto end() { return books_.end(); }
+    [[nodiscard]] auto begin() const { return books_.begin(); }
+    [[nodiscard]] auto end() const { return books_.end(); }
+
+private:
+    SymbolRegistry registry_;
+    std::vector<Book> books_;
+};
@@ -0,0 +1,227 @@
+#pragma once
+#include "Order.h"
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// Trade output policy of the engines.
+//
+// An engine is a template over its sink and calls sink.onTrade(trade) for
+// every fill, so a concrete sink is inlined into the matching loop.
+// CallbackTradeSink is the type-erased adapter behind setTradeCallback,
+// BufferedTradeSink collects the fills of an order into a contiguous buffer
+// and hands them out as one span.
+// ============================================================================
+
+template<typename S>
+concept TradeSink = requires(S sink, const Trade& trade) {
+    { sink.onTrade(trade) } -> std::same_as<void>;
+};
+
+// Адаптер под std::function: косвенный вызов на каждую сделку
+class CallbackTradeSink {
+public:
+    using Callback = std::function<void(const Trade&)>;
+
+    void setCallback(Callback callback) {
+        callback_ = std::move(callback);
+    }
+
+    void onTrade(const Trade& trade) {
+        if (callback_) {
+            callback_(trade);
+        }
+    }
+
+private:
+    Callback callback_;
+};
+
+// Сделки никому не нужны: например, прогрев книги
+struct NullTradeSink {
+    void onTrade(const Trade&) {}
+};
+
+// Engines expose setTradeCallback only when the sink can store a callback
+template<typename S>
+concept CallbackSettableSink = TradeSink<S> && requires(S sink, CallbackTradeSink::Callback callback) {
+    sink.setCallback(std::move(callback));
+};
+
+// ============================================================================
+// Batched output: the matching loop only appends to a preallocated buffer,
+// the consumer receives the fills as one contiguous span after every
+// orders_per_flush orders.
+// ============================================================================
+
+class BufferedTradeSink {
+public:
+    using Callback = CallbackTradeSink::Callback;
+    using BatchCallback = std::function<void(std::span<const Trade>)>;
+
+    static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+    explicit BufferedTradeSink(size_t capacity = DEFAULT_CAPACITY, size_t orders_per_flush = 1)
+            : orders_per_flush_(orders_per_flush) {
+        trades_.reserve(capacity);
+    }
+
+    void setBatchCallback(BatchCallback callback) {
+        batch_callback_ = std::move(callback);
+    }
+
+    // Совместимость с setTradeCallback: сделки отдаются по одной при сбросе пачки
+    void setCallback(Callback callback) {
+        trade_callback_ = std::move(callback);
+    }
+
+    void onTrade(const Trade& trade) {
+        trades_.push_back(trade);  // емкость зарезервирована, растет только при переполнении
+    }
+
+    // Вызывается движком до и после обработки каждого ордера
+    void beginOrder() {
+        if (flushed_) {
+            trades_.clear();
+            flushed_ = false;
+        }
+    }
+
+    void endOrder() {
+        if (++pending_orders_ >= orders_per_flush_) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (batch_callback_) {
+            batch_callback_(trades());
+        }
+        if (trade_callback_) {
+            for (const Trade& trade : trades_) {
+                trade_callback_(trade);
+            }
+        }
+        pending_orders_ = 0;
+        flushed_ = true;
+    }
+
+    // Сделки текущей пачки: после сброса остаются доступны до следующего ордера
+    [[nodiscard]] std::span<const Trade> trades() const {
+        return trades_;
+    }
+
+    void clear() {
+        trades_.clear();
+        pending_orders_ = 0;
+        flushed_ = false;
+    }
+
+private:
+    std::vector<Trade> trades_;
+    size_t orders_per_flush_;
+    size_t pending_orders_ = 0;
+    bool flushed_ = false;
+    BatchCallback batch_callback_;
+    Callback trade_callback_;
+};
+
+// ============================================================================
+// Trade stream fingerprint: an order-sensitive hash of the fills. Timestamps
+// are left out, they are engine-local counters, so two engines (or a replay
+// of a journal) agree exactly when they produced the same fills in the same
+// order.
+// ============================================================================
+
+class TradeStreamHash {
+public:
+    TradeStreamHash() = default;
+
+    // Продолжение отпечатка с сохраненной точки (снимок книги)
+    TradeStreamHash(uint64_t value, uint64_t count) : hash_(value), count_(count) {}
+
+    void add(const Trade& trade) {
+        mix(trade.buy_order_id);
+        mix(trade.sell_order_id);
+        mix(static_cast<uint32_t>(trade.price));
+        mix(trade.quantity);
+        ++count_;
+    }
+
+    [[nodiscard]] uint64_t value() const {
+        return hash_;
+    }
+
+    [[nodiscard]] uint64_t count() const {
+        return count_;
+    }
+
+private:
+    // FNV-1a по 64-битным словам
+    void mix(uint64_t word) {
+        hash_ = (hash_ ^ word) * 0x100000001b3ull;
+    }
+
+    uint64_t hash_ = 0xcbf29ce484222325ull;
+    uint64_t count_ = 0;
+};
+
+// Сделки не хранятся, считается только отпечаток: replay журнала
+class HashingTradeSink {
+public:
+    HashingTradeSink() = default;
+
+    explicit HashingTradeSink(const TradeStreamHash& start) : hash_(start) {}
+
+    void onTrade(const Trade& trade) {
+        hash_.add(trade);
+    }
+
+    [[nodiscard]] const TradeStreamHash& streamHash() const {
+        return hash_;
+    }
+
+private:
+    TradeStreamHash hash_;
+};
+
+template<typename S>
+concept BatchingTradeSink = TradeSink<S> && requires(S sink, const S const_sink) {
+    sink.beginOrder();
+    sink.endOrder();
+    sink.clear();
+    { const_sink.trades() } -> std::convertible_to<std::span<const Trade>>;
+};
+
+// Границы пачки вокруг обработки одного ордера, для прочих sink - no-op
+template<TradeSink S>
+void beginTradeBatch(S& sink) {
+    if constexpr (BatchingTradeSink<S>) {
+        sink.beginOrder();
+    }
+}
+
+template<TradeSink S>
+void endTradeBatch(S& sink) {
+    if constexpr (BatchingTradeSink<S>) {
+        sink.endOrder();
+    }
+}
+
+// Тот же движок с другим sink: BasicMatchingEngineV4<A> -> BasicMatchingEngineV4<B>,
+// остальные параметры (политика статистики) сохраняются
+template<typename Engine, TradeSink NewSink>
+struct RebindTradeSink;
+
+template<template<TradeSink, typename...> class BasicEngine, TradeSink OldSink, typename... Policies,
+         TradeSink NewSink>
+struct RebindTradeSink<BasicEngine<OldSink, Policies...>, NewSink> {
+    using type = BasicEngine<NewSink, Policies...>;
+};
+
+template<typename Engine, TradeSink NewSink>
+using RebindTradeSinkT = typename RebindTradeSink<Engine, NewSink>::type;
@@ -1,11 +1,14 @@
 #include "EnginImpl/V1/MatchingEngineV1.h"
 #include "EnginImpl/V2/MatchingEngineV2.h"
 #include "EnginImpl/V2_prealloc/MatchingEngineV2_prealloc.h"
+#include "EnginImpl/V3/MatchingEngineV3.h"
+#include "EnginImpl/V4/MatchingEngineV4.h"
+#include "EnginImpl/V5/MatchingEngineV5.h"
 #include <gtest/gtest.h>
 
 //EngineTestTypes lists the implementations that will be used in the tests in the Tests folder
 
 using EngineTestTypes = ::testing::Types<
-        MatchingEngineV2_prealloc, MatchingEngineV2
+        MatchingEngineV2_prealloc, MatchingEngineV2, MatchingEngineV3, MatchingEngineV4, MatchingEngineV5
         //add another implementation that is located in the EnginImpl folder
         >;
\ No newline at end of file
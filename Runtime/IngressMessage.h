@@ -0,0 +1,31 @@
+#pragma once
+#include "../EngineConcept/Order.h"
+#include <cstdint>
+
+// Команда во входящем кольце
+struct IngressMessage {
+    enum class Kind : uint8_t {
+        NEW_ORDER,
+        CANCEL,  // значим только order.order_id
+        MODIFY   // order_id, новые price и quantity
+    };
+
+    OrderRecord order;
+    Kind kind;
+};
+
+// Применяет команду к движку: общий путь для потока матчинга и replay журнала
+template<typename Engine>
+void applyCommand(Engine& engine, IngressMessage::Kind kind, const OrderRecord& order) {
+    switch (kind) {
+        case IngressMessage::Kind::NEW_ORDER:
+            engine.submitOrder(order);
+            break;
+        case IngressMessage::Kind::CANCEL:
+            engine.cancelOrder(order.order_id);
+            break;
+        case IngressMessage::Kind::MODIFY:
+            engine.modifyOrder(order.order_id, order.quantity, order.price);
+            break;
+    }
+}
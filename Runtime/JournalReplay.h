@@ -0,0 +1,201 @@
+#pragma once
+#include "../EngineConcept/Order.h"
+#include "../EngineConcept/TradeSink.h"
+#include "../EngineCommon/BookSnapshot.h"
+#include "IngressMessage.h"
+#include "OrderJournal.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ============================================================================
+// Deterministic replay of an OrderJournal file.
+//
+// JournalReader maps the file read-only and validates it once: header,
+// checksums and contiguous sequence numbers. Records after the first bad one
+// (a torn tail after a crash) are not exposed. replayJournal() then feeds
+// the records straight from the mapping into an engine whose sink hashes the
+// trade stream, and compares the hash with every CHECKPOINT record: a
+// mismatch means the engine did not reproduce the recorded session.
+//
+// Any BasicMatchingEngineVx can be used, rebound to HashingTradeSink via
+// ReplayEngineT. Besides verification this is the fast-startup path (the
+// book is rebuilt from the local file) and a realistic benchmark input.
+//
+// Fast restart: a snapshot (BookSnapshot.h) records the journal sequence and
+// the trade stream hash it was taken at. Restore it into an engine whose
+// sink resumes that hash, then replay journalTail() only.
+// ============================================================================
+
+class JournalReader {
+public:
+    JournalReader() = default;
+
+    JournalReader(const JournalReader&) = delete;
+    JournalReader& operator=(const JournalReader&) = delete;
+
+    ~JournalReader() {
+        close();
+    }
+
+    // false - файл не открылся или это не журнал, причина в error()
+    bool open(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return fail("cannot open " + path + ": " + std::strerror(errno));
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            return fail("cannot stat " + path);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ < sizeof(JournalFileHeader)) {
+            ::close(fd);
+            return fail(path + " is too short for a journal header");
+        }
+
+        void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        ::close(fd);  // отображение держит файл само
+        if (mapped == MAP_FAILED) {
+            mapped_ = nullptr;
+            return fail("cannot map " + path + ": " + std::strerror(errno));
+        }
+        mapped_ = static_cast<const char*>(mapped);
+        ::madvise(mapped, size_, MADV_SEQUENTIAL);
+
+        JournalFileHeader header;
+        std::memcpy(&header, mapped_, sizeof(header));
+        if (std::memcmp(header.magic, JournalFileHeader::MAGIC, sizeof(header.magic)) != 0) {
+            return fail(path + " is not an order journal");
+        }
+        if (header.version != JournalFileHeader::VERSION || header.record_size != sizeof(JournalRecord)) {
+            return fail(path + " has journal version " + std::to_string(header.version) +
+                        ", expected " + std::to_string(JournalFileHeader::VERSION));
+        }
+
+        // Заголовок 64 байта, mmap выровнен по странице: записи выровнены
+        const auto* records = reinterpret_cast<const JournalRecord*>(mapped_ + sizeof(JournalFileHeader));
+        const size_t available = (size_ - sizeof(JournalFileHeader)) / sizeof(JournalRecord);
+        size_t valid = 0;
+        while (valid < available && records[valid].follows(valid)) {
+            ++valid;
+        }
+        records_ = {records, valid};
+        return true;
+    }
+
+    void close() {
+        if (mapped_ != nullptr) {
+            ::munmap(const_cast<char*>(mapped_), size_);
+            mapped_ = nullptr;
+        }
+        records_ = {};
+        size_ = 0;
+    }
+
+    [[nodiscard]] std::span<const JournalRecord> records() const {
+        return records_;
+    }
+
+    // Байты за последней целой записью: недописанный хвост
+    [[nodiscard]] size_t discardedBytes() const {
+        return mapped_ == nullptr ? 0 : size_ - sizeof(JournalFileHeader) - records_.size_bytes();
+    }
+
+    [[nodiscard]] size_t fileSize() const {
+        return size_;
+    }
+
+    [[nodiscard]] const std::string& error() const {
+        return error_;
+    }
+
+private:
+    bool fail(std::string message) {
+        error_ = std::move(message);
+        close();
+        return false;
+    }
+
+    const char* mapped_ = nullptr;
+    size_t size_ = 0;
+    std::span<const JournalRecord> records_;
+    std::string error_;
+};
+
+template<typename Engine>
+using ReplayEngineT = RebindTradeSinkT<Engine, HashingTradeSink>;
+
+struct ReplayResult {
+    uint64_t commands = 0;
+    uint64_t symbols = 0;
+    uint64_t checkpoints = 0;   // сверенные контрольные точки
+    uint64_t trades = 0;
+    uint64_t trade_hash = 0;
+    uint64_t mismatch_sequence = 0;  // первая несовпавшая запись, 0 - расхождений нет
+    double seconds = 0;
+
+    [[nodiscard]] bool verified() const {
+        return mismatch_sequence == 0;
+    }
+};
+
+// Записи после снимка, взятого на sequence (номер записи = индекс + 1)
+inline std::span<const JournalRecord> journalTail(std::span<const JournalRecord> records, uint64_t sequence) {
+    return records.subspan(std::min<uint64_t>(sequence, records.size()));
+}
+
+// Снимок движка после replay первых sequence записей журнала
+template<typename Engine>
+bool saveReplaySnapshot(Engine& engine, uint64_t sequence, BookSnapshotWriter& out) {
+    out.setJournalPosition(sequence, engine.tradeSink().streamHash());
+    return engine.saveSnapshot(out);
+}
+
+// Engine - свежий движок с HashingTradeSink (ReplayEngineT<...>).
+// Останавливается на первом расхождении с контрольной точкой или на
+// символе, получившем не тот SymbolId.
+template<typename Engine>
+ReplayResult replayJournal(std::span<const JournalRecord> records, Engine& engine) {
+    ReplayResult result;
+    auto begin = std::chrono::steady_clock::now();
+    for (const JournalRecord& record : records) {
+        switch (record.type) {
+            case JournalRecord::Type::COMMAND:
+                applyCommand(engine, record.kind, record.order);
+                ++result.commands;
+                break;
+            case JournalRecord::Type::SYMBOL:
+                if (engine.registerSymbol(std::string(record.symbolName())) != result.symbols) {
+                    result.mismatch_sequence = record.sequence;
+                }
+                ++result.symbols;
+                break;
+            case JournalRecord::Type::CHECKPOINT: {
+                const TradeStreamHash& hash = engine.tradeSink().streamHash();
+                if (hash.count() != record.checkpoint.trade_count ||
+                    hash.value() != record.checkpoint.trade_hash) {
+                    result.mismatch_sequence = record.sequence;
+                } else {
+                    ++result.checkpoints;
+                }
+                break;
+            }
+        }
+        if (result.mismatch_sequence != 0) break;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    result.seconds = std::chrono::duration<double>(end - begin).count();
+    result.trades = engine.tradeSink().streamHash().count();
+    result.trade_hash = engine.tradeSink().streamHash().value();
+    return result;
+}
@@ -0,0 +1,220 @@
+#pragma once
+#include "../EngineConcept/Order.h"
+#include "../EngineConcept/TradeSink.h"
+#include "../EngineCommon/SpscQueue.h"
+#include "../EnginImpl/V4/MatchingEngineV4.h"
+#include "IngressMessage.h"
+#include "OrderJournal.h"
+#include "ThreadAffinity.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// Threaded matching pipeline.
+//
+// Decoder thread -> ingress SPSC ring -> matching thread (owns the engine)
+// -> trade SPSC ring -> publisher thread. The matching thread is the only
+// one touching the books, so the engine itself stays single-threaded.
+// Engine is any BasicMatchingEngineVx instance, its sink is rebound to the
+// outbound trade ring. With a journal path configured, the matching thread
+// appends every command to an OrderJournal before applying it, plus the
+// registered symbols at start and periodic trade stream checkpoints.
+// ============================================================================
+
+// Сделки уходят из потока матчинга во внешнее кольцо. Если публикатор
+// отстал, поток матчинга ждет: сделки не теряются. Отпечаток потока
+// сделок пишется в контрольные точки журнала.
+class SpscTradeSink {
+public:
+    explicit SpscTradeSink(SpscQueue<Trade>* queue = nullptr) : queue_(queue) {}
+
+    void onTrade(const Trade& trade) {
+        hash_.add(trade);
+        SpinBackoff backoff;
+        while (!queue_->tryPush(trade)) {
+            backoff.pause();
+        }
+    }
+
+    [[nodiscard]] const TradeStreamHash& streamHash() const {
+        return hash_;
+    }
+
+private:
+    SpscQueue<Trade>* queue_;
+    TradeStreamHash hash_;
+};
+
+template<typename Engine = MatchingEngineV4>
+class MatchingPipeline {
+public:
+    using EngineType = RebindTradeSinkT<Engine, SpscTradeSink>;
+
+    struct Config {
+        size_t ingress_capacity = 65536;
+        size_t trade_capacity = 65536;
+        int matching_cpu = -1;  // -1 - поток матчинга без привязки к ядру
+        OrderJournal::Config journal;  // пустой path - без журнала
+    };
+
+    explicit MatchingPipeline(Config config = {})
+            : config_(config),
+              ingress_(config.ingress_capacity),
+              trades_(config.trade_capacity),
+              engine_(SpscTradeSink(&trades_)) {
+        if (!config_.journal.path.empty()) {
+            journal_ = std::make_unique<OrderJournal>(config_.journal);
+        }
+    }
+
+    MatchingPipeline(const MatchingPipeline&) = delete;
+    MatchingPipeline& operator=(const MatchingPipeline&) = delete;
+
+    ~MatchingPipeline() {
+        stop();
+    }
+
+    // Символы регистрируются до start(): после старта движком владеет поток матчинга
+    SymbolId registerSymbol(const std::string& symbol) {
+        SymbolId symbol_id = engine_.registerSymbol(symbol);
+        if (symbol_id == symbols_.size()) {
+            symbols_.push_back(symbol);  // для журнала: SymbolId = порядок регистрации
+        }
+        return symbol_id;
+    }
+
+    // false - не открылся журнал, в нем уже есть записи или имя символа не
+    // помещается в запись, поток матчинга не запущен. Книга конвейера
+    // начинается пустой и отпечаток сделок считается с нуля, поэтому журнал
+    // прошлой сессии он не продолжает: каждой сессии - свой файл
+    bool start() {
+        if (journal_) {
+            if (!journal_->start()) return false;
+            if (journal_->recoveredRecords() != 0) {
+                journal_->stop();
+                return false;
+            }
+            for (const std::string& symbol : symbols_) {
+                if (journal_->appendSymbol(symbol) == 0) {
+                    journal_->stop();
+                    return false;
+                }
+            }
+        }
+        running_.store(true, std::memory_order_release);
+        matching_thread_ = std::thread([this] { run(); });
+        return true;
+    }
+
+    // Дорабатывает все, что было поставлено в очередь до вызова stop()
+    void stop() {
+        requestStop();
+        join();
+    }
+
+    // Раздельно, чтобы остановить несколько конвейеров параллельно
+    void requestStop() {
+        running_.store(false, std::memory_order_release);
+    }
+
+    // Журнал закрывается после потока матчинга: все принятое уже в кольце
+    void join() {
+        if (matching_thread_.joinable()) {
+            matching_thread_.join();
+        }
+        if (journal_) {
+            journal_->stop();
+        }
+    }
+
+    // Методы try* вызывает только один поток-производитель
+    bool trySubmit(const OrderRecord& order) {
+        return ingress_.tryPush({order, IngressMessage::Kind::NEW_ORDER});
+    }
+
+    bool tryCancel(uint64_t order_id) {
+        OrderRecord order{};
+        order.order_id = order_id;
+        return ingress_.tryPush({order, IngressMessage::Kind::CANCEL});
+    }
+
+    // false и для количества, которое не помещается в запись: такой modify
+    // не пройдет и при повторе
+    bool tryModify(uint64_t order_id, uint64_t new_quantity, int new_price) {
+        if (new_quantity > MAX_ORDER_QUANTITY) return false;
+        OrderRecord order{};
+        order.order_id = order_id;
+        order.quantity = static_cast<uint32_t>(new_quantity);
+        order.price = new_price;
+        return ingress_.tryPush({order, IngressMessage::Kind::MODIFY});
+    }
+
+    // Только поток-публикатор
+    bool tryPopTrade(Trade& trade) {
+        return trades_.tryPop(trade);
+    }
+
+    [[nodiscard]] uint64_t processedCount() const {
+        return processed_.load(std::memory_order_relaxed);
+    }
+
+    // Доступ к книгам - только когда поток матчинга остановлен
+    EngineType& engine() {
+        return engine_;
+    }
+
+    // nullptr, если журнал не настроен
+    [[nodiscard]] const OrderJournal* journal() const {
+        return journal_.get();
+    }
+
+private:
+    void run() {
+        pinCurrentThread(config_.matching_cpu);
+
+        SpinBackoff backoff;
+        IngressMessage message;
+        while (true) {
+            if (ingress_.tryPop(message)) {
+                dispatch(message);
+                backoff.reset();
+            } else if (!running_.load(std::memory_order_acquire)) {
+                // stop() уже вызван: добираем остаток и выходим
+                if (!ingress_.tryPop(message)) break;
+                dispatch(message);
+            } else {
+                backoff.pause();
+            }
+        }
+        if (journal_) {
+            journal_->appendCheckpoint(engine_.tradeSink().streamHash());
+        }
+    }
+
+    void dispatch(const IngressMessage& message) {
+        if (journal_) {
+            journal_->append(message);  // сначала журнал, потом книга
+        }
+        applyCommand(engine_, message.kind, message.order);
+        if (journal_ && ++since_checkpoint_ == journal_->config().checkpoint_every) {
+            journal_->appendCheckpoint(engine_.tradeSink().streamHash());
+            since_checkpoint_ = 0;
+        }
+        processed_.store(processed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    Config config_;
+    SpscQueue<IngressMessage> ingress_;
+    SpscQueue<Trade> trades_;
+    EngineType engine_;
+    std::unique_ptr<OrderJournal> journal_;
+    std::vector<std::string> symbols_;
+    size_t since_checkpoint_ = 0;
+    std::thread matching_thread_;
+    std::atomic<bool> running_{false};
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> processed_{0};
+};
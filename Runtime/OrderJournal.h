@@ -0,0 +1,458 @@
+#pragma once
+#include "../EngineConcept/Order.h"
+#include "../EngineConcept/TradeSink.h"
+#include "../EngineCommon/SpscQueue.h"
+#include "IngressMessage.h"
+#include "ThreadAffinity.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ============================================================================
+// Write-ahead journal of the order flow.
+//
+// The matching thread appends every accepted command before applying it:
+// append() stamps a journal sequence and pushes a 64-byte record into an
+// SPSC ring, no syscalls. A dedicated I/O thread drains the ring into a
+// staging buffer and commits it in groups: one write() per group of up to
+// `group_records` records, or earlier when the ring ran dry and the oldest
+// staged record waited `group_timeout`. fdatasync follows every
+// `sync_every_groups` groups (0 - never, durability is then left to the page
+// cache). durableSequence() is the last sequence known to be on disk.
+//
+// A full ring makes the matching thread wait: nothing is applied to the book
+// without being journaled. File layout: JournalFileHeader, then records.
+// One file holds one session: SYMBOL records in registration order (their
+// position is the SymbolId), then COMMAND records interleaved with
+// CHECKPOINT records carrying the trade stream hash up to that point, so a
+// replay can prove it reproduced the session (see JournalReplay.h).
+//
+// Reopening an existing file continues it: start() checks the header, keeps
+// the records up to the first one with a bad checksum or sequence, cuts off
+// the torn tail behind them and numbers new records from there.
+// ============================================================================
+
+struct JournalFileHeader {
+    static constexpr char MAGIC[8] = {'M', 'E', 'J', 'R', 'N', 'L', '0', '1'};
+    static constexpr uint32_t VERSION = 2;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint8_t reserved[48];
+};
+
+static_assert(sizeof(JournalFileHeader) == 64, "записи за заголовком выровнены по 64 байтам");
+
+struct JournalRecord {
+    enum class Type : uint8_t {
+        COMMAND,     // order + kind
+        SYMBOL,      // symbol, SymbolId - порядковый номер среди SYMBOL
+        CHECKPOINT   // checkpoint: сделки всех команд до этой записи
+    };
+
+    static constexpr size_t MAX_SYMBOL_LENGTH = 32;
+
+    struct Checkpoint {
+        uint64_t trade_count;
+        uint64_t trade_hash;
+    };
+
+    union {
+        OrderRecord order;
+        Checkpoint checkpoint;
+        char symbol[MAX_SYMBOL_LENGTH];  // без завершающего нуля, если имя занимает все 32 байта
+    };
+    uint64_t sequence;
+    uint32_t checksum;  // по полям записи, ловит недописанный хвост файла
+    IngressMessage::Kind kind;
+    Type type;
+    uint8_t reserved[18];
+
+    [[nodiscard]] uint32_t computeChecksum() const {
+        // FNV-1a по значимым полям: байты выравнивания не участвуют
+        uint64_t hash = 0xcbf29ce484222325ull;
+        auto mix = [&hash](uint64_t value) {
+            hash = (hash ^ value) * 0x100000001b3ull;
+        };
+        mix(sequence);
+        mix(static_cast<uint8_t>(type));
+        switch (type) {
+            case Type::COMMAND:
+                mix(order.order_id);
+                mix(order.timestamp);
+                mix(static_cast<uint32_t>(order.price));
+                mix(order.quantity);
+                mix(order.symbol_id);
+                mix(order.flags);
+                mix(static_cast<uint8_t>(kind));
+                break;
+            case Type::SYMBOL:
+                for (char c : symbol) mix(static_cast<uint8_t>(c));
+                break;
+            case Type::CHECKPOINT:
+                mix(checkpoint.trade_count);
+                mix(checkpoint.trade_hash);
+                break;
+        }
+        return static_cast<uint32_t>(hash ^ (hash >> 32));
+    }
+
+    [[nodiscard]] std::string_view symbolName() const {
+        return {symbol, strnlen(symbol, MAX_SYMBOL_LENGTH)};
+    }
+
+    // Целая запись, идущая сразу за записью previous_sequence
+    [[nodiscard]] bool follows(uint64_t previous_sequence) const {
+        return sequence == previous_sequence + 1 && checksum == computeChecksum();
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<JournalRecord>);
+static_assert(sizeof(JournalRecord) == 64, "одна запись - одна кеш-линия");
+
+class OrderJournal {
+public:
+    struct Config {
+        std::string path;
+        size_t ring_capacity = 65536;
+        size_t group_records = 1024;                    // записей на один write()
+        std::chrono::microseconds group_timeout{200};  // сколько ждать добора группы
+        size_t sync_every_groups = 1;                   // 0 - без fdatasync
+        int io_cpu = -1;
+        size_t checkpoint_every = 65536;  // команд между контрольными точками, 0 - только при остановке
+    };
+
+    explicit OrderJournal(Config config)
+            : config_(std::move(config)),
+              ring_(config_.ring_capacity) {
+        if (config_.group_records == 0) config_.group_records = 1;
+        staging_.reserve(config_.group_records);
+    }
+
+    OrderJournal(const OrderJournal&) = delete;
+    OrderJournal& operator=(const OrderJournal&) = delete;
+
+    ~OrderJournal() {
+        stop();
+    }
+
+    // Открывает файл на дозапись; новый файл получает заголовок, существующий
+    // продолжается после последней целой записи (см. recover()).
+    // false - файл не открылся, это не журнал этой версии или запись не
+    // удалась, см. lastError()
+    bool start() {
+        fd_ = ::open(config_.path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0) return fail();
+
+        struct stat st{};
+        if (::fstat(fd_, &st) != 0) return fail();
+        if (st.st_size == 0) {
+            JournalFileHeader header{};
+            std::memcpy(header.magic, JournalFileHeader::MAGIC, sizeof(header.magic));
+            header.version = JournalFileHeader::VERSION;
+            header.record_size = sizeof(JournalRecord);
+            if (!writeAll(&header, sizeof(header)) || ::fdatasync(fd_) != 0) return fail();
+        } else if (!recover(static_cast<uint64_t>(st.st_size))) {
+            return false;
+        }
+
+        running_.store(true, std::memory_order_release);
+        io_thread_ = std::thread([this] { run(); });
+        return true;
+    }
+
+    // Дописывает все, что было принято до вызова stop(), и закрывает файл
+    void stop() {
+        running_.store(false, std::memory_order_release);
+        if (io_thread_.joinable()) {
+            io_thread_.join();
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    [[nodiscard]] const Config& config() const {
+        return config_;
+    }
+
+    // Методы append* вызывает только поток матчинга (до его старта - поток,
+    // запускающий сессию). Возвращают порядковый номер записи в журнале
+    uint64_t append(const IngressMessage& message) {
+        JournalRecord record{};
+        record.type = JournalRecord::Type::COMMAND;
+        record.order = message.order;
+        record.kind = message.kind;
+        return push(record);
+    }
+
+    // 0 - имя длиннее MAX_SYMBOL_LENGTH, запись не сделана
+    uint64_t appendSymbol(std::string_view symbol) {
+        if (symbol.size() > JournalRecord::MAX_SYMBOL_LENGTH) return 0;
+        JournalRecord record{};
+        record.type = JournalRecord::Type::SYMBOL;
+        std::memset(record.symbol, 0, sizeof(record.symbol));
+        std::memcpy(record.symbol, symbol.data(), symbol.size());
+        return push(record);
+    }
+
+    uint64_t appendCheckpoint(const TradeStreamHash& trades) {
+        JournalRecord record{};
+        record.type = JournalRecord::Type::CHECKPOINT;
+        record.checkpoint = {trades.count(), trades.value()};
+        return push(record);
+    }
+
+    [[nodiscard]] uint64_t appendedSequence() const {
+        return next_sequence_;
+    }
+
+    // Записи до этого номера включительно уже на диске
+    [[nodiscard]] uint64_t durableSequence() const {
+        return durable_sequence_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] bool failed() const {
+        return failed_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] int lastError() const {
+        return last_error_;
+    }
+
+    // Что start() нашел в существующем файле: целые записи (из них SYMBOL)
+    // и отрезанный недописанный хвост
+    [[nodiscard]] uint64_t recoveredRecords() const {
+        return recovered_records_;
+    }
+
+    [[nodiscard]] uint64_t recoveredSymbols() const {
+        return recovered_symbols_;
+    }
+
+    [[nodiscard]] uint64_t truncatedBytes() const {
+        return truncated_bytes_;
+    }
+
+    // Статистика потока I/O; читать после stop()
+    [[nodiscard]] uint64_t groupsWritten() const {
+        return groups_written_;
+    }
+
+    [[nodiscard]] uint64_t syncs() const {
+        return syncs_;
+    }
+
+    [[nodiscard]] uint64_t bytesWritten() const {
+        return bytes_written_;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t RECOVERY_CHUNK = 4096;  // записей на один pread при проверке
+
+    // Проверка файла прошлой сессии: заголовок, затем записи подряд, пока
+    // номер идет без пропусков и сходится контрольная сумма. Все после
+    // первой плохой записи - недописанный хвост, он отрезается до начала
+    // новой дозаписи, иначе новые записи оказались бы за мусором.
+    bool recover(uint64_t file_size) {
+        JournalFileHeader header{};
+        if (file_size < sizeof(header)) return fail(EINVAL);
+        if (!readAt(&header, sizeof(header), 0)) return fail();
+        if (std::memcmp(header.magic, JournalFileHeader::MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != JournalFileHeader::VERSION || header.record_size != sizeof(JournalRecord)) {
+            return fail(EINVAL);
+        }
+
+        const uint64_t available = (file_size - sizeof(header)) / sizeof(JournalRecord);
+        std::vector<JournalRecord> chunk(std::min<uint64_t>(available, RECOVERY_CHUNK));
+        uint64_t valid = 0;
+        uint64_t symbols = 0;
+        bool torn = false;
+        while (valid < available && !torn) {
+            const size_t count = static_cast<size_t>(std::min<uint64_t>(chunk.size(), available - valid));
+            if (!readAt(chunk.data(), count * sizeof(JournalRecord),
+                        sizeof(header) + valid * sizeof(JournalRecord))) {
+                return fail();
+            }
+            for (size_t i = 0; i < count; ++i) {
+                if (!chunk[i].follows(valid)) {
+                    torn = true;
+                    break;
+                }
+                if (chunk[i].type == JournalRecord::Type::SYMBOL) ++symbols;
+                ++valid;
+            }
+        }
+
+        const uint64_t valid_size = sizeof(header) + valid * sizeof(JournalRecord);
+        if (valid_size < file_size && ::ftruncate(fd_, static_cast<off_t>(valid_size)) != 0) return fail();
+        if (::fdatasync(fd_) != 0) return fail();
+
+        truncated_bytes_ = file_size - valid_size;
+        recovered_records_ = valid;
+        recovered_symbols_ = symbols;
+        next_sequence_ = valid;
+        written_sequence_ = valid;
+        durable_sequence_.store(valid, std::memory_order_release);
+        return true;
+    }
+
+    bool readAt(void* data, size_t size, uint64_t offset) {
+        char* bytes = static_cast<char*>(data);
+        while (size > 0) {
+            ssize_t read = ::pread(fd_, bytes, size, static_cast<off_t>(offset));
+            if (read < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            if (read == 0) {
+                errno = EIO;  // файл укоротили, пока его читали
+                return false;
+            }
+            bytes += read;
+            size -= static_cast<size_t>(read);
+            offset += static_cast<uint64_t>(read);
+        }
+        return true;
+    }
+
+    uint64_t push(JournalRecord& record) {
+        record.sequence = ++next_sequence_;
+        record.checksum = record.computeChecksum();
+
+        SpinBackoff backoff;
+        while (!ring_.tryPush(record)) {
+            backoff.pause();  // I/O отстает: ждем, а не теряем записи
+        }
+        return record.sequence;
+    }
+
+    void run() {
+        pinCurrentThread(config_.io_cpu);
+
+        SpinBackoff backoff;
+        JournalRecord record;
+        Clock::time_point group_started{};
+        while (true) {
+            if (ring_.tryPop(record)) {
+                if (staging_.empty()) group_started = Clock::now();
+                staging_.push_back(record);
+                if (staging_.size() == config_.group_records) commit();
+                backoff.reset();
+                continue;
+            }
+
+            const bool stopping = !running_.load(std::memory_order_acquire);
+            if (stopping && ring_.empty()) {
+                commit();
+                break;
+            }
+            // Кольцо пусто: группа уходит, если ждать добора уже дольше таймаута
+            if (!staging_.empty() && Clock::now() - group_started >= config_.group_timeout) {
+                commit();
+            }
+            backoff.pause();
+        }
+        if (config_.sync_every_groups != 0 && groups_since_sync_ != 0 && !failed()) {
+            sync();
+        }
+    }
+
+    void commit() {
+        if (staging_.empty()) return;
+        const uint64_t last_sequence = staging_.back().sequence;
+        const size_t bytes = staging_.size() * sizeof(JournalRecord);
+        // После ошибки записи журнал только выбирает кольцо: матчинг не встает,
+        // durableSequence() больше не растет
+        const bool skip = failed();
+        const bool written = !skip && writeAll(staging_.data(), bytes);
+        staging_.clear();
+        if (!written) {
+            if (!skip) fail();
+            return;
+        }
+
+        ++groups_written_;
+        bytes_written_ += bytes;
+        written_sequence_ = last_sequence;
+        if (config_.sync_every_groups == 0) {
+            durable_sequence_.store(written_sequence_, std::memory_order_release);
+        } else if (++groups_since_sync_ == config_.sync_every_groups) {
+            sync();
+        }
+    }
+
+    void sync() {
+        if (::fdatasync(fd_) != 0) {
+            fail();
+            return;
+        }
+        ++syncs_;
+        groups_since_sync_ = 0;
+        durable_sequence_.store(written_sequence_, std::memory_order_release);
+    }
+
+    bool writeAll(const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0) {
+            ssize_t written = ::write(fd_, bytes, size);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            bytes += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    bool fail() {
+        return fail(errno);
+    }
+
+    bool fail(int error) {
+        last_error_ = error;
+        failed_.store(true, std::memory_order_release);
+        return false;
+    }
+
+    Config config_;
+    SpscQueue<JournalRecord> ring_;
+    std::vector<JournalRecord> staging_;
+    std::thread io_thread_;
+    int fd_ = -1;
+    int last_error_ = 0;
+
+    uint64_t next_sequence_ = 0;  // поток матчинга
+
+    // Итог recover(), пишется в start()
+    uint64_t recovered_records_ = 0;
+    uint64_t recovered_symbols_ = 0;
+    uint64_t truncated_bytes_ = 0;
+
+    // Поток I/O
+    uint64_t written_sequence_ = 0;
+    size_t groups_since_sync_ = 0;
+    uint64_t groups_written_ = 0;
+    uint64_t syncs_ = 0;
+    uint64_t bytes_written_ = 0;
+
+    std::atomic<bool> running_{false};
+    std::atomic<bool> failed_{false};
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> durable_sequence_{0};
+};
@@ -0,0 +1,146 @@
+#pragma once
+#include "../EngineConcept/Order.h"
+#include "../EngineConcept/SymbolRegistry.h"
+#include "../EngineCommon/SpscQueue.h"
+#include "MatchingPipeline.h"
+#include "ThreadAffinity.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// Symbol-sharded matching runtime.
+//
+// Symbols are partitioned across N shards, every shard is a MatchingPipeline
+// with its own thread and its own books, nothing is shared between shards.
+// A single router thread hashes the global SymbolId to a shard and pushes
+// into that shard's SPSC ingress ring; one publisher thread drains the
+// per-shard trade rings.
+// ============================================================================
+
+template<typename Engine = MatchingEngineV4>
+class ShardedMatchingRuntime {
+public:
+    using Shard = MatchingPipeline<Engine>;
+
+    struct Config {
+        size_t shards = 1;
+        size_t ingress_capacity = 65536;
+        size_t trade_capacity = 65536;
+        int first_cpu = -1;  // shard i -> ядро first_cpu + i, -1 - без привязки
+    };
+
+    explicit ShardedMatchingRuntime(Config config) {
+        size_t count = config.shards == 0 ? 1 : config.shards;
+        shards_.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            typename Shard::Config shard_config;
+            shard_config.ingress_capacity = config.ingress_capacity;
+            shard_config.trade_capacity = config.trade_capacity;
+            shard_config.matching_cpu = config.first_cpu < 0
+                    ? -1
+                    : (config.first_cpu + static_cast<int>(i)) % availableCpuCount();
+            shards_.push_back(std::make_unique<Shard>(shard_config));
+        }
+    }
+
+    // Глобальный SymbolId для ордеров; книга создается только в своем шарде
+    SymbolId registerSymbol(const std::string& symbol) {
+        SymbolId id = registry_.intern(symbol);
+        if (id >= routes_.size()) {
+            uint32_t shard = shardFor(id);
+            routes_.push_back({shard, shards_[shard]->registerSymbol(symbol)});
+        }
+        return id;
+    }
+
+    [[nodiscard]] size_t shardCount() const {
+        return shards_.size();
+    }
+
+    // Фибоначчиев хеш: соседние id расходятся по разным шардам
+    [[nodiscard]] uint32_t shardFor(SymbolId id) const {
+        uint64_t hash = (uint64_t{id} * 0x9E3779B97F4A7C15ull) >> 32;
+        return static_cast<uint32_t>(hash % shards_.size());
+    }
+
+    // false - какой-то шард не запустился; уже запущенные останавливаются,
+    // и рантайм остается целиком остановленным
+    bool start() {
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            if (!shards_[i]->start()) {
+                for (size_t j = 0; j < i; ++j) shards_[j]->requestStop();
+                for (size_t j = 0; j < i; ++j) shards_[j]->join();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Шарды дорабатывают свои очереди; сделки должен выбирать публикатор
+    void stop() {
+        for (auto& shard : shards_) shard->requestStop();
+        for (auto& shard : shards_) shard->join();
+    }
+
+    // Методы маршрутизатора: вызывает один поток
+    bool trySubmit(const OrderRecord& order) {
+        const Route& route = routes_[order.symbol_id];
+        OrderRecord local = order;
+        local.symbol_id = route.local_symbol_id;
+        return shards_[route.shard]->trySubmit(local);
+    }
+
+    void submit(const OrderRecord& order) {
+        SpinBackoff backoff;
+        while (!trySubmit(order)) {
+            backoff.pause();
+        }
+    }
+
+    // Маршрутизатор не помнит, в каком шарде стоит ордер: снятие и изменение
+    // адресуются по символу, как в биржевых протоколах
+    bool tryCancel(SymbolId symbol_id, uint64_t order_id) {
+        return shards_[routes_[symbol_id].shard]->tryCancel(order_id);
+    }
+
+    bool tryModify(SymbolId symbol_id, uint64_t order_id, uint64_t new_quantity, int new_price) {
+        return shards_[routes_[symbol_id].shard]->tryModify(order_id, new_quantity, new_price);
+    }
+
+    // Поток-публикатор: выбирает сделки всех шардов, возвращает их число
+    template<typename F>
+    size_t pollTrades(F&& on_trade) {
+        size_t polled = 0;
+        Trade trade;
+        for (auto& shard : shards_) {
+            while (shard->tryPopTrade(trade)) {
+                on_trade(trade);
+                ++polled;
+            }
+        }
+        return polled;
+    }
+
+    [[nodiscard]] uint64_t processedCount() const {
+        uint64_t processed = 0;
+        for (const auto& shard : shards_) processed += shard->processedCount();
+        return processed;
+    }
+
+    // Доступ к книгам шарда - только после stop()
+    typename Shard::EngineType& shardEngine(size_t shard) {
+        return shards_[shard]->engine();
+    }
+
+private:
+    struct Route {
+        uint32_t shard;
+        SymbolId local_symbol_id;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    SymbolRegistry registry_;
+    std::vector<Route> routes_;  // индекс - глобальный SymbolId
+};
@@ -1,6 +1,16 @@
 #include "../EngineConcept/MatchingEngineConcept.h"
 #include "../EngineTestTypes.h"
+#include "../EngineCommon/BookSnapshot.h"
+#include "../EngineCommon/EngineStats.h"
+#include "../Runtime/JournalReplay.h"
+#include "../Runtime/MatchingPipeline.h"
+#include "L3BookReconstructor.h"
 #include <gtest/gtest.h>
+#include <atomic>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <thread>
 
 // ============================================================================
 // The tests use the MatchingEngineConcept concept. To test any implementation, you need to add it to the EngineTestTypes file.
@@ -21,11 +31,11 @@ TYPED_TEST_SUITE(GenericMatchingEngineTest, EngineTestTypes);
 TYPED_TEST(GenericMatchingEngineTest, SimpleLimitMatch) {
     auto& engine = this->engine;
 
-    auto buy = std::make_shared<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 100.0, 10, 0);
-    auto sell = std::make_shared<Order>(2, "AAPL", Side::SELL, OrderType::LIMIT, 100.0, 10, 0);
+    auto buy = std::make_unique<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 100.0, 10, 0);
+    auto sell = std::make_unique<Order>(2, "AAPL", Side::SELL, OrderType::LIMIT, 100.0, 10, 0);
 
-    engine.submitOrder(buy);
-    engine.submitOrder(sell);
+    engine.submitOrder(std::move(buy));
+    engine.submitOrder(std::move(sell));
 
     auto trades = engine.getTrades();
     EXPECT_EQ(trades.size(), 1);
@@ -40,11 +50,11 @@ TYPED_TEST(GenericMatchingEngineTest, SimpleLimitMatch) {
 TYPED_TEST(GenericMatchingEngineTest, PartialFill) {
     auto& engine = this->engine;
 
-    auto buy = std::make_shared<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 100.0, 15, 0);
-    auto sell = std::make_shared<Order>(2, "AAPL", Side::SELL, OrderType::LIMIT, 100.0, 10, 0);
+    auto buy = std::make_unique<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 100.0, 15, 0);
+    auto sell = std::make_unique<Order>(2, "AAPL", Side::SELL, OrderType::LIMIT, 100.0, 10, 0);
 
-    engine.submitOrder(buy);
-    engine.submitOrder(sell);
+    engine.submitOrder(std::move(buy));
+    engine.submitOrder(std::move(sell));
 
     auto trades = engine.getTrades();
     EXPECT_EQ(trades.size(), 1);
@@ -56,13 +66,13 @@ TYPED_TEST(GenericMatchingEngineTest, PartialFill) {
 TYPED_TEST(GenericMatchingEngineTest, PricePriority) {
     auto& engine = this->engine;
 
-    auto buy1 = std::make_shared<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 99.0, 10, 1);
-    auto buy2 = std::make_shared<Order>(2, "AAPL", Side::BUY, OrderType::LIMIT, 101.0, 10, 2);
-    auto sell = std::make_shared<Order>(3, "AAPL", Side::SELL, OrderType::LIMIT, 100.0, 10, 3);
+    auto buy1 = std::make_unique<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 99.0, 10, 1);
+    auto buy2 = std::make_unique<Order>(2, "AAPL", Side::BUY, OrderType::LIMIT, 101.0, 10, 2);
+    auto sell = std::make_unique<Order>(3, "AAPL", Side::SELL, OrderType::LIMIT, 100.0, 10, 3);
 
-    engine.submitOrder(buy1);
-    engine.submitOrder(buy2);
-    engine.submitOrder(sell);
+    engine.submitOrder(std::move(buy1));
+    engine.submitOrder(std::move(buy2));
+    engine.submitOrder(std::move(sell));
 
     auto trades = engine.getTrades();
     EXPECT_EQ(trades.size(), 1);
@@ -73,13 +83,13 @@ TYPED_TEST(GenericMatchingEngineTest, PricePriority) {
 TYPED_TEST(GenericMatchingEngineTest, TimePriority) {
     auto& engine = this->engine;
 
-    auto buy1 = std::make_shared<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 100.0, 10, 1);
-    auto buy2 = std::make_shared<Order>(2, "AAPL", Side::BUY, OrderType::LIMIT, 100.0, 10, 2);
-    auto sell = std::make_shared<Order>(3, "AAPL", Side::SELL, OrderType::LIMIT, 100.0, 10, 3);
+    auto buy1 = std::make_unique<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 100.0, 10, 1);
+    auto buy2 = std::make_unique<Order>(2, "AAPL", Side::BUY, OrderType::LIMIT, 100.0, 10, 2);
+    auto sell = std::make_unique<Order>(3, "AAPL", Side::SELL, OrderType::LIMIT, 100.0, 10, 3);
 
-    engine.submitOrder(buy1);
-    engine.submitOrder(buy2);
-    engine.submitOrder(sell);
+    engine.submitOrder(std::move(buy1));
+    engine.submitOrder(std::move(buy2));
+    engine.submitOrder(std::move(sell));
 
     auto trades = engine.getTrades();
     EXPECT_EQ(trades.size(), 1);
@@ -89,13 +99,13 @@ TYPED_TEST(GenericMatchingEngineTest, TimePriority) {
 TYPED_TEST(GenericMatchingEngineTest, MarketOrderBuy) {
     auto& engine = this->engine;
 
-    auto sell1 = std::make_shared<Order>(1, "AAPL", Side::SELL, OrderType::LIMIT, 100.0, 5, 1);
-    auto sell2 = std::make_shared<Order>(2, "AAPL", Side::SELL, OrderType::LIMIT, 101.0, 5, 2);
-    auto market_buy = std::make_shared<Order>(3, "AAPL", Side::BUY, OrderType::MARKET, 0.0, 8, 3);
+    auto sell1 = std::make_unique<Order>(1, "AAPL", Side::SELL, OrderType::LIMIT, 100.0, 5, 1);
+    auto sell2 = std::make_unique<Order>(2, "AAPL", Side::SELL, OrderType::LIMIT, 101.0, 5, 2);
+    auto market_buy = std::make_unique<Order>(3, "AAPL", Side::BUY, OrderType::MARKET, 0.0, 8, 3);
 
-    engine.submitOrder(sell1);
-    engine.submitOrder(sell2);
-    engine.submitOrder(market_buy);
+    engine.submitOrder(std::move(sell1));
+    engine.submitOrder(std::move(sell2));
+    engine.submitOrder(std::move(market_buy));
 
     auto trades = engine.getTrades();
     EXPECT_EQ(trades.size(), 2);
@@ -109,13 +119,13 @@ TYPED_TEST(GenericMatchingEngineTest, MarketOrderBuy) {
 TYPED_TEST(GenericMatchingEngineTest, MarketOrderSell) {
     auto& engine = this->engine;
 
-    auto buy1 = std::make_shared<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 101.0, 5, 1);
-    auto buy2 = std::make_shared<Order>(2, "AAPL", Side::BUY, OrderType::LIMIT, 100.0, 5, 2);
-    auto market_sell = std::make_shared<Order>(3, "AAPL", Side::SELL, OrderType::MARKET, 0.0, 8, 3);
+    auto buy1 = std::make_unique<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 101.0, 5, 1);
+    auto buy2 = std::make_unique<Order>(2, "AAPL", Side::BUY, OrderType::LIMIT, 100.0, 5, 2);
+    auto market_sell = std::make_unique<Order>(3, "AAPL", Side::SELL, OrderType::MARKET, 0.0, 8, 3);
 
-    engine.submitOrder(buy1);
-    engine.submitOrder(buy2);
-    engine.submitOrder(market_sell);
+    engine.submitOrder(std::move(buy1));
+    engine.submitOrder(std::move(buy2));
+    engine.submitOrder(std::move(market_sell));
 
     auto trades = engine.getTrades();
     EXPECT_EQ(trades.size(), 2);
@@ -128,11 +138,11 @@ TYPED_TEST(GenericMatchingEngineTest, MarketOrderSell) {
 TYPED_TEST(GenericMatchingEngineTest, NoMatch) {
     auto& engine = this->engine;
 
-    auto buy = std::make_shared<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 99.0, 10, 1);
-    auto sell = std::make_shared<Order>(2, "AAPL", Side::SELL, OrderType::LIMIT, 101.0, 10, 2);
+    auto buy = std::make_unique<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 99.0, 10, 1);
+    auto sell = std::make_unique<Order>(2, "AAPL", Side::SELL, OrderType::LIMIT, 101.0, 10, 2);
 
-    engine.submitOrder(buy);
-    engine.submitOrder(sell);
+    engine.submitOrder(std::move(buy));
+    engine.submitOrder(std::move(sell));
 
     auto trades = engine.getTrades();
     EXPECT_EQ(trades.size(), 0);
@@ -143,15 +153,15 @@ TYPED_TEST(GenericMatchingEngineTest, NoMatch) {
 TYPED_TEST(GenericMatchingEngineTest, MultipleTrades) {
     auto& engine = this->engine;
 
-    auto sell1 = std::make_shared<Order>(1, "AAPL", Side::SELL, OrderType::LIMIT, 100.0, 5, 1);
-    auto sell2 = std::make_shared<Order>(2, "AAPL", Side::SELL, OrderType::LIMIT, 100.0, 5, 2);
-    auto sell3 = std::make_shared<Order>(3, "AAPL", Side::SELL, OrderType::LIMIT, 100.0, 5, 3);
-    auto buy = std::make_shared<Order>(4, "AAPL", Side::BUY, OrderType::LIMIT, 100.0, 12, 4);
+    auto sell1 = std::make_unique<Order>(1, "AAPL", Side::SELL, OrderType::LIMIT, 100.0, 5, 1);
+    auto sell2 = std::make_unique<Order>(2, "AAPL", Side::SELL, OrderType::LIMIT, 100.0, 5, 2);
+    auto sell3 = std::make_unique<Order>(3, "AAPL", Side::SELL, OrderType::LIMIT, 100.0, 5, 3);
+    auto buy = std::make_unique<Order>(4, "AAPL", Side::BUY, OrderType::LIMIT, 100.0, 12, 4);
 
-    engine.submitOrder(sell1);
-    engine.submitOrder(sell2);
-    engine.submitOrder(sell3);
-    engine.submitOrder(buy);
+    engine.submitOrder(std::move(sell1));
+    engine.submitOrder(std::move(sell2));
+    engine.submitOrder(std::move(sell3));
+    engine.submitOrder(std::move(buy));
 
     auto trades = engine.getTrades();
     EXPECT_EQ(trades.size(), 3);
@@ -165,14 +175,757 @@ TYPED_TEST(GenericMatchingEngineTest, MultipleTrades) {
 TYPED_TEST(GenericMatchingEngineTest, DifferentSymbols) {
     auto& engine = this->engine;
 
-    auto buy_aapl = std::make_shared<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 100.0, 10, 1);
-    auto sell_googl = std::make_shared<Order>(2, "GOOGL", Side::SELL, OrderType::LIMIT, 100.0, 10, 2);
+    auto buy_aapl = std::make_unique<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 100.0, 10, 1);
+    auto sell_googl = std::make_unique<Order>(2, "GOOGL", Side::SELL, OrderType::LIMIT, 100.0, 10, 2);
 
-    engine.submitOrder(buy_aapl);
-    engine.submitOrder(sell_googl);
+    engine.submitOrder(std::move(buy_aapl));
+    engine.submitOrder(std::move(sell_googl));
 
     auto trades = engine.getTrades();
     EXPECT_EQ(trades.size(), 0);
     EXPECT_EQ(engine.getBuyOrderCount("AAPL"), 1);
     EXPECT_EQ(engine.getSellOrderCount("GOOGL"), 1);
-}
\ No newline at end of file
+}
+
+TYPED_TEST(GenericMatchingEngineTest, CancelRestingOrder) {
+    auto& engine = this->engine;
+
+    engine.submitOrder(std::make_unique<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 100, 10, 0));
+
+    EXPECT_TRUE(engine.cancelOrder(1));
+    EXPECT_FALSE(engine.cancelOrder(1));
+    EXPECT_FALSE(engine.cancelOrder(42));
+
+    engine.submitOrder(std::make_unique<Order>(2, "AAPL", Side::SELL, OrderType::LIMIT, 100, 10, 0));
+
+    EXPECT_EQ(engine.getTrades().size(), 0);
+    EXPECT_EQ(engine.getBuyOrderCount("AAPL"), 0);
+    EXPECT_EQ(engine.getSellOrderCount("AAPL"), 1);
+}
+
+TYPED_TEST(GenericMatchingEngineTest, CancelMiddleOfLevelKeepsQueue) {
+    auto& engine = this->engine;
+
+    engine.submitOrder(std::make_unique<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 100, 10, 0));
+    engine.submitOrder(std::make_unique<Order>(2, "AAPL", Side::BUY, OrderType::LIMIT, 100, 10, 0));
+    engine.submitOrder(std::make_unique<Order>(3, "AAPL", Side::BUY, OrderType::LIMIT, 100, 10, 0));
+
+    EXPECT_TRUE(engine.cancelOrder(2));
+
+    engine.submitOrder(std::make_unique<Order>(4, "AAPL", Side::SELL, OrderType::LIMIT, 100, 20, 0));
+
+    auto trades = engine.getTrades();
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[0].buy_order_id, 1);
+    EXPECT_EQ(trades[1].buy_order_id, 3);
+    EXPECT_EQ(engine.getBuyOrderCount("AAPL"), 0);
+}
+
+TYPED_TEST(GenericMatchingEngineTest, ModifyQuantityDownKeepsPriority) {
+    auto& engine = this->engine;
+
+    engine.submitOrder(std::make_unique<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 100, 10, 0));
+    engine.submitOrder(std::make_unique<Order>(2, "AAPL", Side::BUY, OrderType::LIMIT, 100, 10, 0));
+
+    EXPECT_TRUE(engine.modifyOrder(1, 4, 100));
+
+    engine.submitOrder(std::make_unique<Order>(3, "AAPL", Side::SELL, OrderType::LIMIT, 100, 10, 0));
+
+    auto trades = engine.getTrades();
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[0].buy_order_id, 1);
+    EXPECT_EQ(trades[0].quantity, 4);
+    EXPECT_EQ(trades[1].buy_order_id, 2);
+    EXPECT_EQ(trades[1].quantity, 6);
+}
+
+TYPED_TEST(GenericMatchingEngineTest, ModifyPriceLosesPriority) {
+    auto& engine = this->engine;
+
+    engine.submitOrder(std::make_unique<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 99, 10, 0));
+    engine.submitOrder(std::make_unique<Order>(2, "AAPL", Side::BUY, OrderType::LIMIT, 100, 10, 0));
+
+    EXPECT_TRUE(engine.modifyOrder(1, 10, 100));
+
+    engine.submitOrder(std::make_unique<Order>(3, "AAPL", Side::SELL, OrderType::LIMIT, 100, 10, 0));
+
+    auto trades = engine.getTrades();
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].buy_order_id, 2);
+}
+
+TYPED_TEST(GenericMatchingEngineTest, ModifyPriceCrossesSpread) {
+    auto& engine = this->engine;
+
+    engine.submitOrder(std::make_unique<Order>(1, "AAPL", Side::SELL, OrderType::LIMIT, 101, 5, 0));
+    engine.submitOrder(std::make_unique<Order>(2, "AAPL", Side::BUY, OrderType::LIMIT, 100, 10, 0));
+
+    EXPECT_TRUE(engine.modifyOrder(2, 10, 101));
+
+    auto trades = engine.getTrades();
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].buy_order_id, 2);
+    EXPECT_EQ(trades[0].sell_order_id, 1);
+    EXPECT_EQ(trades[0].quantity, 5);
+    EXPECT_EQ(engine.getBuyOrderCount("AAPL"), 1);
+    EXPECT_EQ(engine.getSellOrderCount("AAPL"), 0);
+}
+
+TYPED_TEST(GenericMatchingEngineTest, OversizedQuantityRejected) {
+    auto& engine = this->engine;
+    const uint64_t oversized = MAX_ORDER_QUANTITY + 5;
+
+    EXPECT_FALSE(engine.submitOrder(std::make_unique<Order>(1, "AAPL", Side::SELL, OrderType::LIMIT, 100, oversized, 0)));
+    EXPECT_EQ(engine.getSellOrderCount("AAPL"), 0);
+
+    // Усеченное количество (5) не должно встать в книгу и торговать
+    EXPECT_TRUE(engine.submitOrder(std::make_unique<Order>(2, "AAPL", Side::BUY, OrderType::LIMIT, 100, 10, 0)));
+    EXPECT_FALSE(engine.submitOrder(std::make_unique<Order>(3, "AAPL", Side::SELL, OrderType::MARKET, 0, oversized, 0)));
+    EXPECT_TRUE(engine.getTrades().empty());
+
+    EXPECT_FALSE(engine.modifyOrder(2, oversized, 100));
+    EXPECT_FALSE(engine.modifyOrder(2, oversized, 101));
+    EXPECT_EQ(engine.getBuyOrderCount("AAPL"), 1);
+
+    engine.submitOrder(std::make_unique<Order>(4, "AAPL", Side::SELL, OrderType::LIMIT, 100, 10, 0));
+    auto trades = engine.getTrades();
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].buy_order_id, 2);
+    EXPECT_EQ(trades[0].quantity, 10);
+    EXPECT_EQ(trades[0].price, 100);
+
+    typename MatchingPipeline<TypeParam>::Config config;
+    MatchingPipeline<TypeParam> pipeline(config);
+    EXPECT_FALSE(pipeline.tryModify(2, oversized, 100));
+}
+
+TYPED_TEST(GenericMatchingEngineTest, DuplicateLiveOrderIdRejected) {
+    auto& engine = this->engine;
+    const SymbolId symbol_id = engine.registerSymbol("AAPL");
+
+    EXPECT_TRUE(engine.submitOrder(std::make_unique<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 100, 10, 0)));
+    // Тот же id, пока первый ордер стоит: не встает в книгу и не торгует
+    EXPECT_FALSE(engine.submitOrder(std::make_unique<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 101, 5, 0)));
+    EXPECT_FALSE(engine.submitOrder(makeOrderRecord(1, symbol_id, Side::SELL, OrderType::LIMIT, 100, 4, 0)));
+    EXPECT_TRUE(engine.getTrades().empty());
+    EXPECT_EQ(engine.getBuyOrderCount("AAPL"), 1);
+    EXPECT_EQ(engine.getSellOrderCount("AAPL"), 0);
+
+    EXPECT_TRUE(engine.submitOrder(std::make_unique<Order>(2, "AAPL", Side::BUY, OrderType::LIMIT, 99, 10, 0)));
+    EXPECT_TRUE(engine.submitOrder(std::make_unique<Order>(3, "AAPL", Side::SELL, OrderType::LIMIT, 100, 10, 0)));
+    auto trades = engine.getTrades();
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].buy_order_id, 1);
+    EXPECT_EQ(trades[0].quantity, 10);
+
+    // Исполненный id свободен, стоящий ордер 2 по-прежнему снимается
+    EXPECT_FALSE(engine.cancelOrder(1));
+    EXPECT_TRUE(engine.submitOrder(std::make_unique<Order>(1, "AAPL", Side::SELL, OrderType::LIMIT, 105, 3, 0)));
+    EXPECT_EQ(engine.getSellOrderCount("AAPL"), 1);
+    EXPECT_TRUE(engine.cancelOrder(2));
+    EXPECT_TRUE(engine.cancelOrder(1));
+    EXPECT_EQ(engine.getBuyOrderCount("AAPL"), 0);
+    EXPECT_EQ(engine.getSellOrderCount("AAPL"), 0);
+}
+
+TYPED_TEST(GenericMatchingEngineTest, MaxOrderIdIsOrdinary) {
+    auto& engine = this->engine;
+    const uint64_t max_id = std::numeric_limits<uint64_t>::max();
+
+    // Неизвестный id на краю диапазона: не путается с пустым слотом индекса
+    EXPECT_FALSE(engine.cancelOrder(max_id));
+    EXPECT_FALSE(engine.modifyOrder(max_id, 5, 100));
+
+    EXPECT_TRUE(engine.submitOrder(std::make_unique<Order>(max_id, "AAPL", Side::BUY, OrderType::LIMIT, 100, 10, 0)));
+    EXPECT_FALSE(engine.submitOrder(std::make_unique<Order>(max_id, "AAPL", Side::BUY, OrderType::LIMIT, 99, 10, 0)));
+    EXPECT_EQ(engine.getBuyOrderCount("AAPL"), 1);
+    EXPECT_TRUE(engine.modifyOrder(max_id, 4, 100));
+
+    engine.submitOrder(std::make_unique<Order>(1, "AAPL", Side::SELL, OrderType::LIMIT, 100, 10, 0));
+    auto trades = engine.getTrades();
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].buy_order_id, max_id);
+    EXPECT_EQ(trades[0].quantity, 4);
+    EXPECT_FALSE(engine.cancelOrder(max_id));
+
+    EXPECT_TRUE(engine.submitOrder(std::make_unique<Order>(max_id, "AAPL", Side::SELL, OrderType::LIMIT, 105, 3, 0)));
+    EXPECT_TRUE(engine.cancelOrder(max_id));
+    EXPECT_TRUE(engine.cancelOrder(1));
+    EXPECT_EQ(engine.getBuyOrderCount("AAPL"), 0);
+    EXPECT_EQ(engine.getSellOrderCount("AAPL"), 0);
+}
+
+TYPED_TEST(GenericMatchingEngineTest, NextBestLevelAcrossEmptyLevels) {
+    auto& engine = this->engine;
+
+    engine.submitOrder(std::make_unique<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 100, 10, 0));
+    engine.submitOrder(std::make_unique<Order>(2, "AAPL", Side::BUY, OrderType::LIMIT, 95, 10, 0));
+    engine.submitOrder(std::make_unique<Order>(3, "AAPL", Side::BUY, OrderType::LIMIT, 5, 10, 0));
+    EXPECT_TRUE(engine.cancelOrder(2));
+
+    engine.submitOrder(std::make_unique<Order>(4, "AAPL", Side::SELL, OrderType::LIMIT, 1, 15, 0));
+
+    auto trades = engine.getTrades();
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[0].buy_order_id, 1);
+    EXPECT_EQ(trades[0].price, 100);
+    EXPECT_EQ(trades[1].buy_order_id, 3);
+    EXPECT_EQ(trades[1].price, 5);
+    EXPECT_EQ(trades[1].quantity, 5);
+}
+
+TYPED_TEST(GenericMatchingEngineTest, BatchedTradesFlushEveryNOrders) {
+    BufferedTradeSink sink(16, 2);
+    std::vector<size_t> batch_sizes;
+    sink.setBatchCallback([&](std::span<const Trade> batch) {
+        batch_sizes.push_back(batch.size());
+    });
+    TypeParam engine(std::move(sink));
+
+    engine.submitOrder(std::make_unique<Order>(1, "AAPL", Side::SELL, OrderType::LIMIT, 100, 5, 0));
+    engine.submitOrder(std::make_unique<Order>(2, "AAPL", Side::SELL, OrderType::LIMIT, 101, 5, 0));
+    ASSERT_EQ(batch_sizes.size(), 1);
+    EXPECT_EQ(batch_sizes[0], 0);
+
+    engine.submitOrder(std::make_unique<Order>(3, "AAPL", Side::BUY, OrderType::LIMIT, 101, 8, 0));
+    EXPECT_EQ(batch_sizes.size(), 1);  // пачка еще не сброшена
+    EXPECT_EQ(engine.getTrades().size(), 2);
+
+    engine.submitOrder(std::make_unique<Order>(4, "AAPL", Side::BUY, OrderType::MARKET, 0, 1, 0));
+    ASSERT_EQ(batch_sizes.size(), 2);
+    EXPECT_EQ(batch_sizes[1], 3);
+
+    auto trades = engine.getTrades();
+    ASSERT_EQ(trades.size(), 3);
+    EXPECT_EQ(trades[0].sell_order_id, 1);
+    EXPECT_EQ(trades[1].sell_order_id, 2);
+    EXPECT_EQ(trades[2].buy_order_id, 4);
+    EXPECT_EQ(trades[2].quantity, 1);
+}
+
+TYPED_TEST(GenericMatchingEngineTest, OrderCountsCountOrdersNotLevels) {
+    auto& engine = this->engine;
+
+    engine.submitOrder(std::make_unique<Order>(1, "AAPL", Side::BUY, OrderType::LIMIT, 100, 10, 0));
+    engine.submitOrder(std::make_unique<Order>(2, "AAPL", Side::BUY, OrderType::LIMIT, 100, 10, 0));
+    engine.submitOrder(std::make_unique<Order>(3, "AAPL", Side::BUY, OrderType::LIMIT, 99, 10, 0));
+    engine.submitOrder(std::make_unique<Order>(4, "AAPL", Side::SELL, OrderType::LIMIT, 105, 10, 0));
+    engine.submitOrder(std::make_unique<Order>(5, "AAPL", Side::SELL, OrderType::LIMIT, 105, 10, 0));
+    EXPECT_EQ(engine.getBuyOrderCount("AAPL"), 3);
+    EXPECT_EQ(engine.getSellOrderCount("AAPL"), 2);
+
+    EXPECT_TRUE(engine.cancelOrder(2));
+    engine.submitOrder(std::make_unique<Order>(6, "AAPL", Side::SELL, OrderType::LIMIT, 100, 10, 0));
+    EXPECT_EQ(engine.getBuyOrderCount(), 1);
+    EXPECT_EQ(engine.getSellOrderCount(), 2);
+
+    if constexpr (requires { engine.getBuyLevelCount(); }) {
+        EXPECT_EQ(engine.getBuyLevelCount(), 1);
+        EXPECT_EQ(engine.getSellLevelCount(), 1);
+    }
+}
+
+TYPED_TEST(GenericMatchingEngineTest, EmptyLevelsAreReclaimed) {
+    auto& engine = this->engine;
+
+    // Цена уходит далеко, каждый уровень один раз заполняется и пустеет
+    for (uint64_t i = 0; i < 20000; ++i) {
+        engine.submitOrder(std::make_unique<Order>(i + 1, "AAPL", Side::BUY, OrderType::LIMIT,
+                                                   1000 + static_cast<int>(i), 10, 0));
+        EXPECT_TRUE(engine.cancelOrder(i + 1));
+    }
+    EXPECT_EQ(engine.getBuyOrderCount(), 0);
+
+    if constexpr (requires { engine.getRetainedLevelCount(); }) {
+        EXPECT_EQ(engine.getBuyLevelCount(), 0);
+        EXPECT_LE(engine.getRetainedLevelCount(), EmptyLevelReclaimer::DEFAULT_MAX_RETAINED);
+
+        // Лимит своей книги: остальные книги его не видят
+        const SymbolId msft = engine.registerSymbol("MSFT");
+        engine.setMaxRetainedEmptyLevels(msft, 8);
+        const size_t retained_before = engine.getRetainedLevelCount();
+        for (uint64_t i = 0; i < 100; ++i) {
+            engine.submitOrder(std::make_unique<Order>(30000 + i, msft, Side::SELL, OrderType::LIMIT,
+                                                       500 + static_cast<int>(i), 10, 0));
+            EXPECT_TRUE(engine.cancelOrder(30000 + i));
+        }
+        EXPECT_EQ(engine.getRetainedLevelCount(), retained_before + 8);
+    }
+}
+
+TYPED_TEST(GenericMatchingEngineTest, DepthTracksPartialFillsAndCancels) {
+    auto& engine = this->engine;
+
+    engine.submitOrder(std::make_unique<Order>(1, "AAPL", Side::SELL, OrderType::LIMIT, 101, 10, 0));
+    engine.submitOrder(std::make_unique<Order>(2, "AAPL", Side::SELL, OrderType::LIMIT, 101, 20, 0));
+    engine.submitOrder(std::make_unique<Order>(3, "AAPL", Side::SELL, OrderType::LIMIT, 102, 5, 0));
+    engine.submitOrder(std::make_unique<Order>(4, "AAPL", Side::SELL, OrderType::LIMIT, 103, 7, 0));
+    engine.submitOrder(std::make_unique<Order>(5, "AAPL", Side::BUY, OrderType::LIMIT, 99, 8, 0));
+
+    // Частичное исполнение второго ордера уровня 101
+    engine.submitOrder(std::make_unique<Order>(6, "AAPL", Side::BUY, OrderType::LIMIT, 101, 14, 0));
+    // Снятие из середины очереди и уменьшение количества
+    EXPECT_TRUE(engine.cancelOrder(3));
+    EXPECT_TRUE(engine.modifyOrder(4, 3, 103));
+    engine.submitOrder(std::make_unique<Order>(7, "AAPL", Side::SELL, OrderType::LIMIT, 104, 1, 0));
+
+    auto asks = engine.getDepth("AAPL", Side::SELL, 2);
+    ASSERT_EQ(asks.size(), 2);
+    EXPECT_EQ(asks[0], (DepthLevel{101, 1, 16}));
+    EXPECT_EQ(asks[1], (DepthLevel{103, 1, 3}));
+
+    auto bids = engine.getDepth("AAPL", Side::BUY, 10);
+    ASSERT_EQ(bids.size(), 1);
+    EXPECT_EQ(bids[0], (DepthLevel{99, 1, 8}));
+
+    engine.submitOrder(std::make_unique<Order>(8, "AAPL", Side::BUY, OrderType::MARKET, 0, 17, 0));
+    asks = engine.getDepth("AAPL", Side::SELL, 10);
+    ASSERT_EQ(asks.size(), 2);
+    EXPECT_EQ(asks[0], (DepthLevel{103, 1, 2}));
+    EXPECT_EQ(asks[1], (DepthLevel{104, 1, 1}));
+    EXPECT_TRUE(engine.getDepth("MSFT", Side::BUY, 5).empty());
+}
+
+// Цены на порядки дальше окна лестницы V5: далекие уровни не растягивают окно
+TYPED_TEST(GenericMatchingEngineTest, WidePriceSpread) {
+    auto& engine = this->engine;
+
+    engine.submitOrder(std::make_unique<Order>(1, "AAPL", Side::SELL, OrderType::LIMIT, 100, 10, 0));
+    engine.submitOrder(std::make_unique<Order>(2, "AAPL", Side::SELL, OrderType::LIMIT, 10'000'000, 10, 0));
+    engine.submitOrder(std::make_unique<Order>(3, "AAPL", Side::SELL, OrderType::LIMIT, 1'000'000'000, 10, 0));
+    engine.submitOrder(std::make_unique<Order>(4, "AAPL", Side::SELL, OrderType::LIMIT, 5'000'000, 10, 0));
+    engine.submitOrder(std::make_unique<Order>(5, "AAPL", Side::BUY, OrderType::LIMIT, 50, 10, 0));
+    engine.submitOrder(std::make_unique<Order>(6, "AAPL", Side::BUY, OrderType::LIMIT, 1, 10, 0));
+
+    auto asks = engine.getDepth("AAPL", Side::SELL, 10);
+    ASSERT_EQ(asks.size(), 4);
+    EXPECT_EQ(asks[0].price, 100);
+    EXPECT_EQ(asks[1].price, 5'000'000);
+    EXPECT_EQ(asks[2].price, 10'000'000);
+    EXPECT_EQ(asks[3].price, 1'000'000'000);
+
+    EXPECT_TRUE(engine.modifyOrder(4, 5, 5'000'000));
+    EXPECT_TRUE(engine.cancelOrder(2));
+
+    engine.submitOrder(std::make_unique<Order>(7, "AAPL", Side::BUY, OrderType::MARKET, 0, 25, 0));
+    auto trades = engine.getTrades();
+    ASSERT_EQ(trades.size(), 3);
+    EXPECT_EQ(trades[0].price, 100);
+    EXPECT_EQ(trades[1].price, 5'000'000);
+    EXPECT_EQ(trades[1].quantity, 5);
+    EXPECT_EQ(trades[2].price, 1'000'000'000);
+    EXPECT_EQ(engine.getSellOrderCount("AAPL"), 0);
+
+    // Лучшая цена уходит далеко вверх, прежние уровни остаются в книге
+    engine.submitOrder(std::make_unique<Order>(8, "AAPL", Side::BUY, OrderType::LIMIT, 900'000'000, 10, 0));
+    auto bids = engine.getDepth("AAPL", Side::BUY, 10);
+    ASSERT_EQ(bids.size(), 3);
+    EXPECT_EQ(bids[0].price, 900'000'000);
+    EXPECT_EQ(bids[1].price, 50);
+    EXPECT_EQ(bids[2].price, 1);
+
+    engine.submitOrder(std::make_unique<Order>(9, "AAPL", Side::SELL, OrderType::MARKET, 0, 15, 0));
+    trades = engine.getTrades();
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[0].price, 900'000'000);
+    EXPECT_EQ(trades[1].price, 50);
+    EXPECT_EQ(trades[1].quantity, 5);
+    EXPECT_EQ(engine.getBuyOrderCount("AAPL"), 2);
+}
+
+TYPED_TEST(GenericMatchingEngineTest, L2UpdatesCoalescedPerSubmit) {
+    auto& engine = this->engine;
+    std::vector<std::vector<L2Update>> batches;
+    engine.setL2Callback([&](std::span<const L2Update> updates) {
+        batches.emplace_back(updates.begin(), updates.end());
+    });
+
+    engine.submitOrder(std::make_unique<Order>(1, "AAPL", Side::SELL, OrderType::LIMIT, 101, 10, 0));
+    engine.submitOrder(std::make_unique<Order>(2, "AAPL", Side::SELL, OrderType::LIMIT, 101, 5, 0));
+    engine.submitOrder(std::make_unique<Order>(3, "AAPL", Side::SELL, OrderType::LIMIT, 102, 5, 0));
+    engine.submitOrder(std::make_unique<Order>(4, "AAPL", Side::SELL, OrderType::LIMIT, 103, 5, 0));
+    ASSERT_EQ(batches.size(), 4);
+    EXPECT_EQ(batches[1][0].action, L2Update::Action::CHANGE);
+    EXPECT_EQ(batches[1][0].order_count, 2);
+    EXPECT_EQ(batches[1][0].quantity, 15);
+    batches.clear();
+
+    // Свип через три ордера на двух уровнях и остаток в книге - одна пачка
+    engine.submitOrder(std::make_unique<Order>(5, "AAPL", Side::BUY, OrderType::LIMIT, 102, 25, 0));
+    ASSERT_EQ(batches.size(), 1);
+    ASSERT_EQ(batches[0].size(), 3);
+    EXPECT_EQ(batches[0][0].side, Side::SELL);
+    EXPECT_EQ(batches[0][0].price, 101);
+    EXPECT_EQ(batches[0][0].action, L2Update::Action::DELETE);
+    EXPECT_EQ(batches[0][1].price, 102);
+    EXPECT_EQ(batches[0][1].action, L2Update::Action::DELETE);
+    EXPECT_EQ(batches[0][2].side, Side::BUY);
+    EXPECT_EQ(batches[0][2].price, 102);
+    EXPECT_EQ(batches[0][2].action, L2Update::Action::ADD);
+    EXPECT_EQ(batches[0][2].order_count, 1);
+    EXPECT_EQ(batches[0][2].quantity, 5);
+
+    // Частичное исполнение - CHANGE, снятие последнего ордера уровня - DELETE
+    engine.submitOrder(std::make_unique<Order>(6, "AAPL", Side::SELL, OrderType::MARKET, 0, 2, 0));
+    EXPECT_TRUE(engine.cancelOrder(4));
+    EXPECT_FALSE(engine.cancelOrder(42));
+    ASSERT_EQ(batches.size(), 3);
+    EXPECT_EQ(batches[1].size(), 1);
+    EXPECT_EQ(batches[1][0].action, L2Update::Action::CHANGE);
+    EXPECT_EQ(batches[1][0].quantity, 3);
+    EXPECT_EQ(batches[2].size(), 1);
+    EXPECT_EQ(batches[2][0].price, 103);
+    EXPECT_EQ(batches[2][0].action, L2Update::Action::DELETE);
+    EXPECT_EQ(batches[2][0].symbol_id, batches[0][0].symbol_id);
+}
+
+TYPED_TEST(GenericMatchingEngineTest, L3FeedRebuildsBook) {
+    auto& engine = this->engine;
+    engine.enableL3Feed();
+    const SymbolId symbols[] = {engine.registerSymbol("AAPL"), engine.registerSymbol("MSFT")};
+
+    L3BookReconstructor reconstructed;
+    std::mt19937 rng(11);
+    uint64_t next_id = 1;
+    for (int i = 0; i < 5000; ++i) {
+        const SymbolId symbol_id = symbols[rng() % 2];
+        const int price = 100 + static_cast<int>(rng() % 20);
+        switch (rng() % 8) {
+            case 0: case 1: case 2: case 3:
+                engine.submitOrder(std::make_unique<Order>(next_id++, symbol_id, rng() % 2 ? Side::BUY : Side::SELL,
+                                                           rng() % 16 ? OrderType::LIMIT : OrderType::MARKET,
+                                                           price, 1 + rng() % 40, 0));
+                break;
+            case 4: case 5:
+                engine.cancelOrder(1 + rng() % next_id);
+                break;
+            default:
+                engine.modifyOrder(1 + rng() % next_id, rng() % 50, price);
+        }
+
+        L3Event event;
+        while (engine.pollL3Event(event)) {
+            ASSERT_TRUE(reconstructed.apply(event)) << reconstructed.error();
+        }
+        if (i % 50 == 0) {
+            for (SymbolId id : symbols) {
+                const std::string& name = id == symbols[0] ? "AAPL" : "MSFT";
+                EXPECT_EQ(reconstructed.depth(id, Side::BUY), engine.getDepth(name, Side::BUY, 100));
+                EXPECT_EQ(reconstructed.depth(id, Side::SELL), engine.getDepth(name, Side::SELL, 100));
+            }
+        }
+    }
+    EXPECT_EQ(engine.getL3DroppedEvents(), 0);
+}
+
+TYPED_TEST(GenericMatchingEngineTest, TopOfBookSnapshotFollowsBook) {
+    auto& engine = this->engine;
+    engine.enableTopOfBook();
+    const SymbolId symbol_id = engine.registerSymbol("AAPL");
+    const SeqLock<TopOfBook>& snapshot = engine.topOfBookSnapshot(symbol_id);
+    EXPECT_EQ(engine.getTopOfBook(symbol_id), TopOfBook{});
+
+    // Читатель в другом потоке: разорванный снимок дал бы пересеченную книгу
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> crossed{0};
+    std::thread reader([&] {
+        TopOfBook top;
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (snapshot.tryLoad(top) && top.bid.order_count != 0 && top.ask.order_count != 0 &&
+                top.bid.price >= top.ask.price) {
+                crossed.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    });
+
+    std::mt19937 rng(5);
+    for (uint64_t id = 1; id <= 5000; ++id) {
+        engine.submitOrder(std::make_unique<Order>(id, symbol_id, rng() % 2 ? Side::BUY : Side::SELL,
+                                                   OrderType::LIMIT, 100 + static_cast<int>(rng() % 10),
+                                                   1 + rng() % 20, 0));
+        if (id % 3 == 0) engine.cancelOrder(id - 1);
+
+        auto bids = engine.getDepth("AAPL", Side::BUY, 1);
+        auto asks = engine.getDepth("AAPL", Side::SELL, 1);
+        TopOfBook expected{};
+        if (!bids.empty()) expected.bid = bids[0];
+        if (!asks.empty()) expected.ask = asks[0];
+        ASSERT_EQ(engine.getTopOfBook(symbol_id), expected);
+    }
+    stop = true;
+    reader.join();
+    EXPECT_EQ(crossed.load(), 0);
+}
+
+TYPED_TEST(GenericMatchingEngineTest, EngineStatsSnapshotCountsOperations) {
+    // По умолчанию статистики нет вовсе: ни API, ни счетчиков
+    static_assert(!requires(TypeParam& e) { e.getStats(); });
+
+    RebindEngineStatsT<TypeParam, EngineStats> engine;
+    engine.setStatsPublishInterval(1);
+    const SymbolId symbol_id = engine.registerSymbol("AAPL");
+    const uint64_t published_before = engine.statsSnapshot().version();
+
+    for (uint64_t id = 1; id <= 3; ++id) {
+        engine.submitOrder(std::make_unique<Order>(id, symbol_id, Side::SELL, OrderType::LIMIT, 101, 5, 0));
+    }
+    engine.submitOrder(std::make_unique<Order>(4, symbol_id, Side::SELL, OrderType::LIMIT, 102, 5, 0));
+    engine.submitOrder(std::make_unique<Order>(5, symbol_id, Side::SELL, OrderType::LIMIT, 103, 5, 0));
+    // 3 сделки на 101 и одна на 102: два уровня
+    engine.submitOrder(std::make_unique<Order>(6, symbol_id, Side::BUY, OrderType::LIMIT, 102, 20, 0));
+    engine.submitOrder(std::make_unique<Order>(7, symbol_id, Side::BUY, OrderType::LIMIT, 100, 1, 0));
+    EXPECT_TRUE(engine.cancelOrder(7));
+    engine.submitOrder(std::make_unique<Order>(8, symbol_id, Side::BUY, OrderType::LIMIT, 99, 10, 0));
+    EXPECT_TRUE(engine.modifyOrder(8, 5, 99));
+
+    EngineStatsSnapshot stats = engine.getStats();
+    EXPECT_GT(engine.statsSnapshot().version(), published_before);
+    EXPECT_EQ(stats.orders, 8);
+    EXPECT_EQ(stats.cancels, 1);
+    EXPECT_EQ(stats.modifies, 1);
+    EXPECT_EQ(stats.aggressive_orders, 1);
+    EXPECT_EQ(stats.fills, 4);
+    EXPECT_EQ(stats.max_sweep_depth, 2);
+    EXPECT_DOUBLE_EQ(stats.fillsPerAggressiveOrder(), 4.0);
+    EXPECT_DOUBLE_EQ(stats.averageSweepDepth(), 2.0);
+    EXPECT_EQ(stats.max_level_queue, 3);
+    EXPECT_EQ(stats.price_levels, 2);  // 103 и 99
+
+    // 20 ордеров на одном уровне: кольцо 8 -> 16 -> 32
+    for (uint64_t id = 100; id < 120; ++id) {
+        engine.submitOrder(std::make_unique<Order>(id, symbol_id, Side::BUY, OrderType::LIMIT, 98, 1, 0));
+    }
+    stats = engine.getStats();
+    EXPECT_EQ(stats.max_level_queue, 20);
+    EXPECT_EQ(stats.price_levels, 3);
+    if constexpr (requires { engine.getLevelResizes(); }) {
+        EXPECT_EQ(stats.level_resizes, 2);
+    } else {
+        EXPECT_EQ(stats.level_resizes, 0);
+    }
+}
+
+TYPED_TEST(GenericMatchingEngineTest, JournalReplayReproducesTrades) {
+    const std::string path = ::testing::TempDir() + "replay_" + this->engine.name() + ".wal";
+    std::remove(path.c_str());
+
+    typename MatchingPipeline<TypeParam>::Config config;
+    config.journal.path = path;
+    config.journal.sync_every_groups = 0;
+    config.journal.checkpoint_every = 100;
+    MatchingPipeline<TypeParam> pipeline(config);
+    const SymbolId symbols[] = {pipeline.registerSymbol("AAPL"), pipeline.registerSymbol("MSFT")};
+    ASSERT_TRUE(pipeline.start());
+
+    std::mt19937 rng(17);
+    uint64_t next_id = 1;
+    for (int i = 0; i < 3000; ++i) {
+        const int price = 100 + static_cast<int>(rng() % 20);
+        bool pushed = false;
+        while (!pushed) {
+            switch (rng() % 8) {
+                case 0:
+                    pushed = pipeline.tryCancel(1 + rng() % next_id);
+                    break;
+                case 1:
+                    pushed = pipeline.tryModify(1 + rng() % next_id, rng() % 50, price);
+                    break;
+                default:
+                    pushed = pipeline.trySubmit(makeOrderRecord(next_id, symbols[rng() % 2],
+                                                                rng() % 2 ? Side::BUY : Side::SELL,
+                                                                rng() % 16 ? OrderType::LIMIT : OrderType::MARKET,
+                                                                price, 1 + rng() % 40, 0));
+                    if (pushed) ++next_id;
+            }
+        }
+    }
+    pipeline.stop();
+    ASSERT_FALSE(pipeline.journal()->failed());
+
+    JournalReader reader;
+    ASSERT_TRUE(reader.open(path)) << reader.error();
+    EXPECT_EQ(reader.records().size(), pipeline.journal()->appendedSequence());
+    EXPECT_EQ(reader.discardedBytes(), 0);
+
+    ReplayEngineT<TypeParam> replayed;
+    const ReplayResult result = replayJournal(reader.records(), replayed);
+    EXPECT_TRUE(result.verified());
+    EXPECT_EQ(result.commands, 3000);
+    EXPECT_EQ(result.symbols, 2);
+    EXPECT_EQ(result.checkpoints, 31);  // 30 периодических и одна при остановке
+    EXPECT_GT(result.trades, 0);
+    EXPECT_EQ(result.trade_hash, pipeline.engine().tradeSink().streamHash().value());
+    for (const char* name : {"AAPL", "MSFT"}) {
+        EXPECT_EQ(replayed.getDepth(name, Side::BUY, 100), pipeline.engine().getDepth(name, Side::BUY, 100));
+        EXPECT_EQ(replayed.getDepth(name, Side::SELL, 100), pipeline.engine().getDepth(name, Side::SELL, 100));
+    }
+
+    // Измененные объемы дают другие сделки: расхождение на контрольной точке
+    std::vector<JournalRecord> tampered(reader.records().begin(), reader.records().end());
+    for (JournalRecord& record : tampered) {
+        if (record.type == JournalRecord::Type::COMMAND && record.kind == IngressMessage::Kind::NEW_ORDER) {
+            record.order.quantity += 1000;
+        }
+    }
+    ReplayEngineT<TypeParam> diverged;
+    EXPECT_FALSE(replayJournal(tampered, diverged).verified());
+
+    reader.close();
+    std::remove(path.c_str());
+}
+
+TYPED_TEST(GenericMatchingEngineTest, JournalReopenContinuesSequence) {
+    const std::string path = ::testing::TempDir() + "reopen_" + this->engine.name() + ".wal";
+    std::remove(path.c_str());
+
+    OrderJournal::Config config;
+    config.path = path;
+    config.sync_every_groups = 0;
+    auto append_orders = [](OrderJournal& journal, uint64_t first_id) {
+        for (uint64_t id = first_id; id < first_id + 10; ++id) {
+            journal.append({makeOrderRecord(id, 0, id % 2 ? Side::BUY : Side::SELL, OrderType::LIMIT,
+                                            100 + static_cast<int>(id % 3), 5, 0),
+                            IngressMessage::Kind::NEW_ORDER});
+        }
+    };
+    {
+        OrderJournal journal(config);
+        ASSERT_TRUE(journal.start());
+        journal.appendSymbol("AAPL");
+        append_orders(journal, 1);
+        journal.stop();
+    }
+
+    // Недописанный хвост: половина записи после сбоя
+    {
+        FILE* file = std::fopen(path.c_str(), "ab");
+        ASSERT_NE(file, nullptr);
+        const char garbage[sizeof(JournalRecord) / 2] = {1};
+        std::fwrite(garbage, 1, sizeof(garbage), file);
+        std::fclose(file);
+    }
+
+    {
+        OrderJournal journal(config);
+        ASSERT_TRUE(journal.start());
+        EXPECT_EQ(journal.recoveredRecords(), 11);
+        EXPECT_EQ(journal.recoveredSymbols(), 1);
+        EXPECT_EQ(journal.truncatedBytes(), sizeof(JournalRecord) / 2);
+        EXPECT_EQ(journal.durableSequence(), 11);
+        append_orders(journal, 11);
+        EXPECT_EQ(journal.appendedSequence(), 21);
+        journal.stop();
+        EXPECT_FALSE(journal.failed());
+    }
+
+    JournalReader reader;
+    ASSERT_TRUE(reader.open(path)) << reader.error();
+    EXPECT_EQ(reader.records().size(), 21);
+    EXPECT_EQ(reader.discardedBytes(), 0);
+    ReplayEngineT<TypeParam> replayed;
+    const ReplayResult result = replayJournal(reader.records(), replayed);
+    EXPECT_TRUE(result.verified());
+    EXPECT_EQ(result.commands, 20);
+    reader.close();
+
+    // Конвейер начинает книгу с нуля и не дописывает чужую сессию
+    typename MatchingPipeline<TypeParam>::Config pipeline_config;
+    pipeline_config.journal = config;
+    MatchingPipeline<TypeParam> pipeline(pipeline_config);
+    EXPECT_FALSE(pipeline.start());
+
+    // Файл, который не является журналом, не трогается
+    {
+        FILE* file = std::fopen(path.c_str(), "wb");
+        ASSERT_NE(file, nullptr);
+        std::fputs("not a journal, just some text that is longer than a journal header......", file);
+        std::fclose(file);
+    }
+    OrderJournal foreign(config);
+    EXPECT_FALSE(foreign.start());
+    EXPECT_EQ(foreign.lastError(), EINVAL);
+    foreign.stop();
+    struct stat st{};
+    ASSERT_EQ(::stat(path.c_str(), &st), 0);
+    EXPECT_GT(st.st_size, static_cast<off_t>(sizeof(JournalFileHeader)));
+
+    std::remove(path.c_str());
+}
+
+TYPED_TEST(GenericMatchingEngineTest, SnapshotRestoreContinuesSession) {
+    auto& engine = this->engine;
+    const SymbolId symbols[] = {engine.registerSymbol("AAPL"), engine.registerSymbol("MSFT")};
+
+    std::mt19937 rng(23);
+    uint64_t next_id = 1;
+    auto step = [&](auto& target, std::mt19937 gen) {
+        const SymbolId symbol_id = symbols[gen() % 2];
+        const int price = 100 + static_cast<int>(gen() % 20);
+        switch (gen() % 8) {
+            case 0: case 1: case 2: case 3: case 4:
+                target.submitOrder(makeOrderRecord(next_id, symbol_id, gen() % 2 ? Side::BUY : Side::SELL,
+                                                   gen() % 16 ? OrderType::LIMIT : OrderType::MARKET,
+                                                   price, 1 + gen() % 40, 0));
+                break;
+            case 5:
+                target.cancelOrder(1 + gen() % next_id);
+                break;
+            default:
+                target.modifyOrder(1 + gen() % next_id, gen() % 50, price);
+        }
+    };
+    for (int i = 0; i < 3000; ++i, ++next_id) {
+        step(engine, std::mt19937(rng()));
+    }
+
+    BookSnapshotWriter writer;
+    ASSERT_TRUE(engine.saveSnapshot(writer));
+    const std::string path = ::testing::TempDir() + "snapshot_" + engine.name() + ".bin";
+    ASSERT_TRUE(writer.writeFile(path));
+    BookSnapshotReader reader;
+    ASSERT_TRUE(reader.readFile(path)) << reader.error();
+    std::remove(path.c_str());
+    EXPECT_EQ(reader.header().order_count, engine.getBuyOrderCount() + engine.getSellOrderCount());
+
+    TypeParam restored;
+    ASSERT_TRUE(restored.restoreSnapshot(reader)) << reader.error();
+    EXPECT_EQ(restored.getBuyOrderCount(), engine.getBuyOrderCount());
+    EXPECT_EQ(restored.getSellOrderCount(), engine.getSellOrderCount());
+    for (const char* name : {"AAPL", "MSFT"}) {
+        EXPECT_EQ(restored.getDepth(name, Side::BUY, 100), engine.getDepth(name, Side::BUY, 100));
+        EXPECT_EQ(restored.getDepth(name, Side::SELL, 100), engine.getDepth(name, Side::SELL, 100));
+    }
+
+    // Та же сессия дальше: приоритеты, id и счетчик времени дают те же сделки
+    for (int i = 0; i < 3000; ++i, ++next_id) {
+        const uint32_t seed = rng();
+        engine.clearTrades();
+        restored.clearTrades();
+        step(engine, std::mt19937(seed));
+        step(restored, std::mt19937(seed));
+        auto expected = engine.getTrades();
+        auto actual = restored.getTrades();
+        ASSERT_EQ(actual.size(), expected.size()) << "operation " << i;
+        for (size_t t = 0; t < expected.size(); ++t) {
+            EXPECT_EQ(actual[t].buy_order_id, expected[t].buy_order_id);
+            EXPECT_EQ(actual[t].sell_order_id, expected[t].sell_order_id);
+            EXPECT_EQ(actual[t].quantity, expected[t].quantity);
+            EXPECT_EQ(actual[t].timestamp, expected[t].timestamp);
+        }
+    }
+
+    // Поврежденный снимок не принимается, движок не трогается
+    std::vector<SnapshotBlock> corrupted(writer.finish().begin(), writer.finish().end());
+    corrupted.back().bytes[0] ^= 1;
+    BookSnapshotReader bad;
+    EXPECT_FALSE(bad.open(corrupted));
+    EXPECT_FALSE(engine.restoreSnapshot(reader));  // в движке уже есть ордера
+
+    // Заголовок тоже под суммой: число символов, позиция журнала, отпечаток сделок
+    for (size_t byte = 0; byte < sizeof(BookSnapshotHeader); ++byte) {
+        std::vector<SnapshotBlock> flipped(writer.finish().begin(), writer.finish().end());
+        flipped[byte / sizeof(SnapshotBlock)].bytes[byte % sizeof(SnapshotBlock)] ^= 1;
+        BookSnapshotReader flipped_reader;
+        EXPECT_FALSE(flipped_reader.open(flipped)) << "header byte " << byte;
+    }
+}
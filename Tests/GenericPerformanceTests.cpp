@@ -1,105 +1,128 @@
 #include "../EngineConcept/MatchingEngineConcept.h"
 #include "../EngineTestTypes.h"
+#include "../Runtime/ShardedMatchingRuntime.h"
+#include "../Benchmarks/WorkloadGenerator.h"
+#include "../Benchmarks/BenchmarkResults.h"
+#include "../Benchmarks/PerfCounters.h"
 #include <gtest/gtest.h>
 #include <chrono>
+#include <cstdlib>
+#include <filesystem>
 #include <random>
 #include <iomanip>
+#include <sstream>
+#include <thread>
 
 // ============================================================================
 // The tests use the MatchingEngineConcept concept. To test any implementation, you need to add it to the EngineTestTypes file.
 // ============================================================================
 
-struct BenchmarkMetrics {
-    double avg_latency_ns;
-    double p50_latency_ns;
-    double p95_latency_ns;
-    double p99_latency_ns;
-    double p999_latency_ns;
-    double max_latency_ns;
-    double throughput_ops_per_sec;
-    //size_t total_trades;
-    size_t total_orders;
-    const char* engine_name;
-
-    void print(const std::string& test_name) const {
-        std::cout << "\n╔════════════════════════════════════════════════════════════╗\n";
-        std::cout << "║ " << std::left << std::setw(56) << test_name << " ║\n";
-        std::cout << "║ Engine: " << std::left << std::setw(49) << engine_name << " ║\n";
-        std::cout << "╠════════════════════════════════════════════════════════════╣\n";
-        std::cout << std::fixed << std::setprecision(2);
-        std::cout << "║ Total Orders:    " << std::setw(38) << total_orders << " ║\n";
-        //std::cout << "║ Total Trades:    " << std::setw(38) << total_trades << " ║\n";
-        //std::cout << "║ Match Rate:      " << std::setw(35) << (100.0 * total_trades / total_orders) << "% ║\n";
-        std::cout << "╟────────────────────────────────────────────────────────────╢\n";
-        std::cout << "║ LATENCY (nanoseconds)                                      ║\n";
-        std::cout << "║   Average:       " << std::setw(38) << avg_latency_ns << " ns ║\n";
-        std::cout << "║   P50 (median):  " << std::setw(38) << p50_latency_ns << " ns ║\n";
-        std::cout << "║   P95:           " << std::setw(38) << p95_latency_ns << " ns ║\n";
-        std::cout << "║   P99:           " << std::setw(38) << p99_latency_ns << " ns ║\n";
-        std::cout << "║   P99.9:         " << std::setw(38) << p999_latency_ns << " ns ║\n";
-        std::cout << "║   Max:           " << std::setw(38) << max_latency_ns << " ns ║\n";
-        std::cout << "╟────────────────────────────────────────────────────────────╢\n";
-        std::cout << "║ THROUGHPUT                                                 ║\n";
-        std::cout << "║   " << std::setw(54) << throughput_ops_per_sec << " ops/sec ║\n";
-        std::cout << "╚════════════════════════════════════════════════════════════╝\n";
+// BENCHMARK_RESULTS=out.json[,out.csv] - записать все прогоны runBenchmark по завершении.
+// BENCHMARK_BASELINE - путь к базовой линии с порогами SLA, по умолчанию Benchmarks/baseline.json
+BenchmarkReport& benchmarkReport() {
+    static BenchmarkReport report;
+    return report;
+}
+
+class BenchmarkReportEnvironment : public ::testing::Environment {
+public:
+    void TearDown() override {
+        const char* paths = std::getenv("BENCHMARK_RESULTS");
+        if (paths == nullptr || benchmarkReport().empty()) return;
+        std::stringstream list(paths);
+        std::string path;
+        while (std::getline(list, path, ',')) {
+            if (benchmarkReport().write(path)) {
+                std::cout << "Benchmark results written to " << path << "\n";
+            } else {
+                std::cerr << "Cannot write benchmark results to " << path << "\n";
+            }
+        }
     }
 };
 
+[[maybe_unused]] const ::testing::Environment* const report_environment =
+        ::testing::AddGlobalTestEnvironment(new BenchmarkReportEnvironment);
+
 template<MatchingEngineConcept Engine>
 class GenericPerformanceBenchmark : public ::testing::Test {
 protected:
-    BenchmarkMetrics runBenchmark(size_t num_orders) {
+    // OrderLayout: Order через unique_ptr либо компактный OrderRecord.
+    // Поток команд генерируется порциями вне замера (WorkloadGenerator.h),
+    // задержки копятся в гистограмме: память не растет с числом ордеров
+    template<typename OrderLayout = Order>
+    BenchmarkMetrics runBenchmark(size_t num_orders, WorkloadConfig config = {}) {
+        static constexpr size_t CHUNK = 1 << 20;
+        config.num_commands = num_orders;
+        WorkloadGenerator generator(config);
+        std::vector<IngressMessage> commands;
+        commands.reserve(std::min(num_orders, CHUNK));
+
+        const uint64_t rss_before = residentBytes();
         Engine engine;
-        std::vector<double> latencies_ns;
-        latencies_ns.reserve(num_orders);
-
-        std::mt19937 rng(42);
-        std::uniform_int_distribution<int> price_dist(9998, 10003);
-        std::uniform_int_distribution<uint64_t> qty_dist(1, 100);
-        std::uniform_int_distribution<int> side_dist(0, 1);
-        std::uniform_int_distribution<int> type_dist(0, 9);
-
-        auto start_total = std::chrono::high_resolution_clock::now();
-
-        for (size_t i = 0; i < num_orders; ++i) {
-            Side side = side_dist(rng) == 0 ? Side::BUY : Side::SELL;
-            OrderType type = type_dist(rng) < 9 ? OrderType::LIMIT : OrderType::MARKET;
-            int price = type == OrderType::LIMIT ? price_dist(rng)  : 0.0;
-            uint64_t qty = qty_dist(rng);
-
-            auto order = std::make_shared<Order>(i, "TEST", side, type, price, qty, 0);
-
-            auto start = std::chrono::high_resolution_clock::now();
-            engine.submitOrder(order);
-            auto end = std::chrono::high_resolution_clock::now();
-
-            double latency_ns = std::chrono::duration<double, std::nano>(end - start).count();
-            latencies_ns.push_back(latency_ns);
+        registerWorkloadSymbols(engine, generator.symbols());
+        LatencyRecorder latency;
+        PerfCounters& counters = threadPerfCounters();
+        PerfReading counted;
+        double total_time_sec = 0;
+        double cpu_time_sec = 0;
+
+        while (generator.remaining() != 0) {
+            commands.clear();
+            generator.generate(commands, CHUNK);
+
+            const double cpu_before = cpuSeconds();
+            counters.start();
+            auto start_chunk = std::chrono::steady_clock::now();
+            for (const IngressMessage& command : commands) {
+                if (command.kind != IngressMessage::Kind::NEW_ORDER) {
+                    latency.measure([&] { applyCommand(engine, command.kind, command.order); });
+                } else if constexpr (std::is_same_v<OrderLayout, OrderRecord>) {
+                    latency.measure([&] { engine.submitOrder(command.order); });
+                } else {
+                    auto order = std::make_unique<Order>(command.order);
+
+                    latency.measure([&] { engine.submitOrder(std::move(order)); });
+                }
+            }
+            auto end_chunk = std::chrono::steady_clock::now();
+            counted += counters.stop();
+            total_time_sec += std::chrono::duration<double>(end_chunk - start_chunk).count();
+            cpu_time_sec += cpuSeconds() - cpu_before;
         }
 
-        auto end_total = std::chrono::high_resolution_clock::now();
-        double total_time_sec = std::chrono::duration<double>(end_total - start_total).count();
-
-        std::sort(latencies_ns.begin(), latencies_ns.end());
-
         BenchmarkMetrics metrics;
+        metrics.benchmark = std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()) + "/" +
+                            config.name + "/" + (std::is_same_v<OrderLayout, OrderRecord> ? "OrderRecord" : "Order") +
+                            "/" + std::to_string(num_orders);
         metrics.total_orders = num_orders;
-        //metrics.total_trades = engine.getTrades().size();
         metrics.engine_name = engine.name();
-
-        double sum = 0;
-        for (double lat : latencies_ns) sum += lat;
-        metrics.avg_latency_ns = sum / latencies_ns.size();
-
-        metrics.p50_latency_ns = latencies_ns[latencies_ns.size() / 2];
-        metrics.p95_latency_ns = latencies_ns[latencies_ns.size() * 95 / 100];
-        metrics.p99_latency_ns = latencies_ns[latencies_ns.size() * 99 / 100];
-        metrics.p999_latency_ns = latencies_ns[latencies_ns.size() * 999 / 1000];
-        metrics.max_latency_ns = latencies_ns.back();
+        metrics.setWorkload(config);
+        metrics.setLatency(latency);
         metrics.throughput_ops_per_sec = num_orders / total_time_sec;
+        const uint64_t rss_after = residentBytes();
+        metrics.rss_growth_bytes = rss_after - std::min(rss_after, rss_before);
+        metrics.cpu_seconds = cpu_time_sec;
+        metrics.counters = counted.perOperation(num_orders);
 
+        benchmarkReport().add(metrics);
         return metrics;
     }
+
+    // Правило SLA текущего теста для Engine из базовой линии; nullptr - файла или правила нет
+    static const SlaRule* slaRule() {
+        static BenchmarkBaseline baseline;
+        static const bool loaded = [] {
+            const char* path = std::getenv("BENCHMARK_BASELINE");
+            const std::string file = path != nullptr
+                    ? std::string(path)
+                    : (std::filesystem::path(__FILE__).parent_path().parent_path() / "Benchmarks" / "baseline.json").string();
+            if (!baseline.load(file)) std::cerr << baseline.error() << "\n";
+            return baseline.error().empty();
+        }();
+        if (!loaded) return nullptr;
+        return baseline.sla(::testing::UnitTest::GetInstance()->current_test_info()->name(), Engine::name());
+    }
 };
 
 TYPED_TEST_SUITE(GenericPerformanceBenchmark, EngineTestTypes);
@@ -126,34 +149,82 @@ TYPED_TEST(GenericPerformanceBenchmark, LargeLoad) {
     EXPECT_GT(metrics.throughput_ops_per_sec, 500);
 }
 
+TYPED_TEST(GenericPerformanceBenchmark, OrderRecordLayout) {
+    auto order_metrics = this->runBenchmark(100000);
+    order_metrics.print("Order layout (100K orders)");
+
+    auto record_metrics = this->template runBenchmark<OrderRecord>(100000);
+    record_metrics.print("OrderRecord layout (100K orders)");
+
+    EXPECT_GT(record_metrics.throughput_ops_per_sec, 1000);
+}
+
+TYPED_TEST(GenericPerformanceBenchmark, WorkloadMixes) {
+    auto sweep = this->runBenchmark(100000, WorkloadConfig::sweepHeavy());
+    sweep.print("Sweep-heavy mix (100K commands)");
+
+    auto cancels = this->runBenchmark(100000, WorkloadConfig::cancelHeavy());
+    cancels.print("Cancel-heavy mix (100K commands)");
+
+    EXPECT_GT(sweep.throughput_ops_per_sec, 1000);
+    EXPECT_GT(cancels.throughput_ops_per_sec, 1000);
+}
+
+// Перцентили гистограммы против точных по отсортированному массиву
+TEST(LatencyHarness, HistogramPercentilesWithinBucketError) {
+    std::mt19937_64 rng(42);
+    std::lognormal_distribution<double> dist(7.0, 1.5);  // медиана ~1100, хвост до миллионов
+    LatencyHistogram histogram;
+    std::vector<uint64_t> exact;
+    for (int i = 0; i < 200000; ++i) {
+        const auto value = static_cast<uint64_t>(dist(rng));
+        histogram.record(value);
+        exact.push_back(value);
+    }
+    std::sort(exact.begin(), exact.end());
+
+    EXPECT_EQ(histogram.count(), exact.size());
+    EXPECT_EQ(histogram.min(), exact.front());
+    EXPECT_EQ(histogram.max(), exact.back());
+    for (double percentile : {1.0, 50.0, 90.0, 99.0, 99.9, 99.99}) {
+        const double truth = static_cast<double>(exact[static_cast<size_t>(exact.size() * percentile / 100.0)]);
+        EXPECT_NEAR(static_cast<double>(histogram.valueAtPercentile(percentile)), truth, truth / 64 + 1)
+                << "P" << percentile;
+    }
+
+    const TscCalibration& calibration = tscCalibration();
+    EXPECT_GT(calibration.ticks_per_ns, 0.0);
+    std::cout << "TSC: " << calibration.ticks_per_ns << " ticks/ns, start/stop pair "
+              << calibration.toNs(static_cast<double>(calibration.overhead_ticks)) << " ns\n";
+}
+
 // ============================================================================
 // SLA TESTS
 // ============================================================================
 
+// Пороги - в правилах "sla" базовой линии (Benchmarks/baseline.json)
 TYPED_TEST(GenericPerformanceBenchmark, SLA_Conservative_100K_OrdersPerSec) {
-    const size_t NUM_ORDERS = 100000;
-    const double MIN_THROUGHPUT = 100000.0;
-    const double MAX_P99_LATENCY_NS = 50000.0;
+    const SlaRule* sla = this->slaRule();
+    ASSERT_NE(sla, nullptr) << "Нет правила SLA в базовой линии";
 
-    auto metrics = this->runBenchmark(NUM_ORDERS);
-    metrics.print("SLA: 100K ops/sec, P99 < 50μs");
-
-    EXPECT_GE(metrics.throughput_ops_per_sec, MIN_THROUGHPUT)
-                        << "Throughput ниже требуемого";
+    auto metrics = this->runBenchmark(100000);
+    metrics.print("SLA: throughput and P99 (baseline.json)");
 
-    EXPECT_LE(metrics.p99_latency_ns, MAX_P99_LATENCY_NS)
-                        << "P99 latency превышает лимит";
+    for (const std::string& violation : slaViolations(*sla, metrics)) {
+        ADD_FAILURE() << "SLA нарушен: " << violation;
+    }
 }
 
 TYPED_TEST(GenericPerformanceBenchmark, SLA_P999_Latency) {
-    const size_t NUM_ORDERS = 1000000;
-    const double MAX_P999_LATENCY_NS = 100000.0;
+    const SlaRule* sla = this->slaRule();
+    ASSERT_NE(sla, nullptr) << "Нет правила SLA в базовой линии";
 
-    auto metrics = this->runBenchmark(NUM_ORDERS);
-    metrics.print("SLA: P99.9 < 100μs");
+    auto metrics = this->runBenchmark(1000000);
+    metrics.print("SLA: P99.9 (baseline.json)");
 
-    EXPECT_LE(metrics.p999_latency_ns, MAX_P999_LATENCY_NS)
-                        << "P99.9 latency превышает лимит";
+    for (const std::string& violation : slaViolations(*sla, metrics)) {
+        ADD_FAILURE() << "SLA нарушен: " << violation;
+    }
 }
 
 // ============================================================================
@@ -189,6 +260,7 @@ TYPED_TEST(GenericPerformanceBenchmark, DegradationAnalysis) {
 TYPED_TEST(GenericPerformanceBenchmark, OrderBookDepthImpact) {
     using Engine = TypeParam;
     Engine engine;
+    const SymbolId symbol_id = engine.registerSymbol("TEST");
 
     std::cout << "\n╔════════════════════════════════════════════════════════════╗\n";
     std::cout << "║           ORDER BOOK DEPTH IMPACT                          ║\n";
@@ -198,40 +270,91 @@ TYPED_TEST(GenericPerformanceBenchmark, OrderBookDepthImpact) {
     std::uniform_real_distribution<double> price_dist(95.0, 105.0);
 
     for (size_t i = 0; i < 10000; ++i) {
-        auto buy = std::make_shared<Order>(i * 2, "TEST", Side::BUY,
+        auto buy = std::make_unique<Order>(i * 2, symbol_id, Side::BUY,
                                            OrderType::LIMIT, price_dist(rng), 10, 0);
-        auto sell = std::make_shared<Order>(i * 2 + 1, "TEST", Side::SELL,
+        auto sell = std::make_unique<Order>(i * 2 + 1, symbol_id, Side::SELL,
                                             OrderType::LIMIT, price_dist(rng) + 10.0, 10, 0);
-        engine.submitOrder(buy);
-        engine.submitOrder(sell);
+        engine.submitOrder(std::move(buy));
+        engine.submitOrder(std::move(sell));
     }
 
     std::cout << "Order book depth - Buy: " << engine.getBuyOrderCount()
               << ", Sell: " << engine.getSellOrderCount() << "\n";
 
-    std::vector<double> latencies;
+    LatencyRecorder latency;
     for (size_t i = 0; i < 1000; ++i) {
-        auto order = std::make_shared<Order>(100000 + i, "TEST", Side::BUY,
+        auto order = std::make_unique<Order>(100000 + i, symbol_id, Side::BUY,
                                              OrderType::LIMIT, 100.0, 10, 0);
 
-        auto start = std::chrono::high_resolution_clock::now();
-        engine.submitOrder(order);
-        auto end = std::chrono::high_resolution_clock::now();
-
-        latencies.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+        latency.measure([&] { engine.submitOrder(std::move(order)); });
     }
 
-    std::sort(latencies.begin(), latencies.end());
-
     std::cout << std::fixed << std::setprecision(2);
     std::cout << "\nLatency with deep order book:\n";
-    std::cout << "  P50:  " << latencies[latencies.size() / 2] << " ns\n";
-    std::cout << "  P95:  " << latencies[latencies.size() * 95 / 100] << " ns\n";
-    std::cout << "  P99:  " << latencies[latencies.size() * 99 / 100] << " ns\n";
+    std::cout << "  P50:  " << latency.percentileNs(50) << " ns\n";
+    std::cout << "  P95:  " << latency.percentileNs(95) << " ns\n";
+    std::cout << "  P99:  " << latency.percentileNs(99) << " ns\n";
 
     EXPECT_GT(engine.getBuyOrderCount(), 9000);
 }
 
+TYPED_TEST(GenericPerformanceBenchmark, CancelReplaceFlow) {
+    using Engine = TypeParam;
+    Engine engine;
+    const SymbolId symbol_id = engine.registerSymbol("TEST");
+
+    std::cout << "\n╔════════════════════════════════════════════════════════════╗\n";
+    std::cout << "║           CANCEL / REPLACE FLOW (90% of messages)          ║\n";
+    std::cout << "╚════════════════════════════════════════════════════════════╝\n";
+
+    const size_t NUM_MESSAGES = 500000;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> price_dist(9990, 10010);
+    std::uniform_int_distribution<uint64_t> qty_dist(1, 100);
+    std::uniform_int_distribution<int> action_dist(0, 9);
+
+    std::vector<uint64_t> resting;
+    LatencyRecorder cancel_latency;
+    LatencyRecorder modify_latency;
+    uint64_t next_id = 0;
+
+    for (size_t i = 0; i < NUM_MESSAGES; ++i) {
+        int action = action_dist(rng);
+
+        if (action == 0 || resting.empty()) {
+            // Пассивные ордера по обе стороны от 10000, без пересечения спреда
+            Side side = i % 2 == 0 ? Side::BUY : Side::SELL;
+            int price = side == Side::BUY ? price_dist(rng) - 11 : price_dist(rng) + 11;
+            engine.submitOrder(std::make_unique<Order>(next_id, symbol_id, side, OrderType::LIMIT,
+                                                       price, qty_dist(rng), 0));
+            resting.push_back(next_id++);
+            continue;
+        }
+
+        size_t victim = rng() % resting.size();
+        if (action < 6) {
+            cancel_latency.measure([&] { engine.cancelOrder(resting[victim]); });
+
+            resting[victim] = resting.back();
+            resting.pop_back();
+        } else {
+            const uint64_t qty = qty_dist(rng);
+            const int price = price_dist(rng);
+            modify_latency.measure([&] { engine.modifyOrder(resting[victim], qty, price); });
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "\nCancel latency (" << cancel_latency.count() << " ops):\n";
+    std::cout << "  P50:  " << cancel_latency.percentileNs(50) << " ns\n";
+    std::cout << "  P99:  " << cancel_latency.percentileNs(99) << " ns\n";
+    std::cout << "Modify latency (" << modify_latency.count() << " ops):\n";
+    std::cout << "  P50:  " << modify_latency.percentileNs(50) << " ns\n";
+    std::cout << "  P99:  " << modify_latency.percentileNs(99) << " ns\n";
+
+    EXPECT_GT(cancel_latency.count(), NUM_MESSAGES / 3);
+}
+
 TYPED_TEST(GenericPerformanceBenchmark, BaselinePerformance) {
     const size_t NUM_ORDERS = 50000000;
 
@@ -248,4 +371,123 @@ TYPED_TEST(GenericPerformanceBenchmark, BaselinePerformance) {
               << metrics.p99_latency_ns << " ns\n\n";
 
     SUCCEED();
-}
\ No newline at end of file
+}
+// ============================================================================
+// MULTI-THREADED: symbol-sharded runtime
+// ============================================================================
+
+struct ShardedMetrics {
+    size_t shards;
+    double throughput_ops_per_sec;
+    uint64_t processed;
+    uint64_t total_trades;
+    uint64_t traded_volume;
+};
+
+template<MatchingEngineConcept Engine>
+class ShardedPerformanceBenchmark : public ::testing::Test {
+protected:
+    static constexpr size_t NUM_SYMBOLS = 64;
+
+    // Тот же поток ордеров, что и в runBenchmark, но размазанный по символам
+    static std::vector<OrderRecord> generateOrders(size_t num_orders) {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<SymbolId> symbol_dist(0, NUM_SYMBOLS - 1);
+        std::uniform_int_distribution<int> price_dist(9998, 10003);
+        std::uniform_int_distribution<uint64_t> qty_dist(1, 100);
+        std::uniform_int_distribution<int> side_dist(0, 1);
+        std::uniform_int_distribution<int> type_dist(0, 9);
+
+        std::vector<OrderRecord> orders;
+        orders.reserve(num_orders);
+        for (size_t i = 0; i < num_orders; ++i) {
+            SymbolId symbol_id = symbol_dist(rng);
+            Side side = side_dist(rng) == 0 ? Side::BUY : Side::SELL;
+            OrderType type = type_dist(rng) < 9 ? OrderType::LIMIT : OrderType::MARKET;
+            int price = type == OrderType::LIMIT ? price_dist(rng) : 0;
+            orders.push_back(makeOrderRecord(i, symbol_id, side, type, price, qty_dist(rng), 0));
+        }
+        return orders;
+    }
+
+    // Текущий поток - маршрутизатор, отдельный поток - публикатор сделок
+    ShardedMetrics runSharded(size_t shards, const std::vector<OrderRecord>& orders) {
+        typename ShardedMatchingRuntime<Engine>::Config config;
+        config.shards = shards;
+        // Ядро 0 оставляем маршрутизатору, если ядер хватает на всех
+        config.first_cpu = availableCpuCount() > static_cast<int>(shards + 1) ? 1 : -1;
+        ShardedMatchingRuntime<Engine> runtime(config);
+        for (size_t s = 0; s < NUM_SYMBOLS; ++s) {
+            runtime.registerSymbol("SYM" + std::to_string(s));
+        }
+
+        ShardedMetrics metrics{shards, 0.0, 0, 0, 0};
+        std::atomic<bool> router_done{false};
+
+        if (!runtime.start()) {
+            ADD_FAILURE() << "шарды не запустились";
+            return metrics;
+        }
+        std::thread publisher([&] {
+            SpinBackoff backoff;
+            auto on_trade = [&](const Trade& trade) {
+                ++metrics.total_trades;
+                metrics.traded_volume += trade.quantity;
+            };
+            while (!router_done.load(std::memory_order_acquire)) {
+                if (runtime.pollTrades(on_trade) == 0) {
+                    backoff.pause();
+                } else {
+                    backoff.reset();
+                }
+            }
+            runtime.pollTrades(on_trade);  // остаток после stop()
+        });
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const OrderRecord& order : orders) {
+            runtime.submit(order);
+        }
+        runtime.stop();
+        auto end = std::chrono::high_resolution_clock::now();
+
+        router_done.store(true, std::memory_order_release);
+        publisher.join();
+
+        metrics.processed = runtime.processedCount();
+        metrics.throughput_ops_per_sec = orders.size() / std::chrono::duration<double>(end - start).count();
+        return metrics;
+    }
+};
+
+TYPED_TEST_SUITE(ShardedPerformanceBenchmark, EngineTestTypes);
+
+TYPED_TEST(ShardedPerformanceBenchmark, ScalingAcrossShards) {
+    const size_t NUM_ORDERS = 400000;
+    const auto orders = this->generateOrders(NUM_ORDERS);
+
+    std::cout << "\n=== Sharded runtime (" << this->NUM_SYMBOLS << " symbols, "
+              << availableCpuCount() << " CPUs) ===\n";
+    std::cout << std::fixed << std::setprecision(2);
+
+    std::vector<ShardedMetrics> results;
+    for (size_t shards : {1, 2, 4}) {
+        results.push_back(this->runSharded(shards, orders));
+        const ShardedMetrics& m = results.back();
+        double efficiency = m.throughput_ops_per_sec / (shards * results.front().throughput_ops_per_sec);
+        std::cout << "Shards: " << shards
+                  << " | Throughput: " << m.throughput_ops_per_sec << " ops/sec"
+                  << " | Efficiency: " << efficiency * 100 << "%"
+                  << " | Trades: " << m.total_trades << "\n";
+    }
+
+    // Книги символов независимы и порядок внутри символа сохраняется,
+    // поэтому результат матчинга не зависит от числа шардов.
+    // Масштабирование не проверяем: на машине может быть одно ядро.
+    for (const ShardedMetrics& m : results) {
+        EXPECT_EQ(m.processed, NUM_ORDERS);
+        EXPECT_EQ(m.total_trades, results.front().total_trades);
+        EXPECT_EQ(m.traded_volume, results.front().traded_volume);
+        EXPECT_GT(m.throughput_ops_per_sec, 1000);
+    }
+}
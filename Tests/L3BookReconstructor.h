@@ -0,0 +1,137 @@
+#pragma once
+#include "../EngineConcept/MarketData.h"
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ============================================================================
+// Consumer-side book built only from the L3 feed.
+//
+// apply() keeps FIFO queues per level and checks what the feed promises:
+// sequences are gap-free per symbol, an execution always hits the order at
+// the front of the best level, cancels and replaces name live orders.
+// The first violation is kept in error(); depth() is compared against the
+// engine's own getDepth by the tests.
+// ============================================================================
+
+class L3BookReconstructor {
+public:
+    bool apply(const L3Event& event) {
+        if (!error_.empty()) return false;
+        uint64_t& last = last_sequence_[event.symbol_id];
+        if (event.sequence != last + 1) {
+            return fail("sequence gap", event);
+        }
+        last = event.sequence;
+
+        Book& book = books_[event.symbol_id];
+        switch (event.type) {
+            case L3Event::Type::ADD: {
+                if (book.orders.contains(event.order_id)) return fail("duplicate add", event);
+                auto& queue = book.levels(event.side)[event.price];
+                queue.push_back({event.order_id, event.quantity});
+                book.orders[event.order_id] = {event.side, event.price, std::prev(queue.end())};
+                return true;
+            }
+            case L3Event::Type::EXECUTE: {
+                auto& levels = book.levels(event.side);
+                if (levels.empty()) return fail("execute on empty side", event);
+                auto best = event.side == Side::BUY ? std::prev(levels.end()) : levels.begin();
+                RestingOrder& front = best->second.front();
+                if (best->first != event.price || front.order_id != event.order_id) {
+                    return fail("execute not at front of best level", event);
+                }
+                if (front.quantity < event.quantity) return fail("overfill", event);
+                front.quantity -= event.quantity;
+                if (front.quantity == 0) {
+                    book.orders.erase(event.order_id);
+                    best->second.pop_front();
+                    if (best->second.empty()) levels.erase(best);
+                }
+                return true;
+            }
+            case L3Event::Type::CANCEL:
+            case L3Event::Type::REPLACE: {
+                auto it = book.orders.find(event.order_id);
+                if (it == book.orders.end()) return fail("unknown order", event);
+                Location location = it->second;
+                if (location.side != event.side || location.price != event.price) {
+                    return fail("order moved", event);
+                }
+                if (event.type == L3Event::Type::REPLACE) {
+                    if (event.quantity > location.order->quantity) return fail("replace grows order", event);
+                    location.order->quantity = event.quantity;
+                    return true;
+                }
+                if (location.order->quantity != event.quantity) return fail("cancel quantity", event);
+                auto& levels = book.levels(event.side);
+                auto level = levels.find(event.price);
+                level->second.erase(location.order);
+                if (level->second.empty()) levels.erase(level);
+                book.orders.erase(it);
+                return true;
+            }
+        }
+        return fail("unknown event type", event);
+    }
+
+    // Лучшие уровни первыми, как в getDepth
+    [[nodiscard]] std::vector<DepthLevel> depth(SymbolId symbol_id, Side side) const {
+        std::vector<DepthLevel> out;
+        auto book = books_.find(symbol_id);
+        if (book == books_.end()) return out;
+        auto append = [&](const auto& level) {
+            uint64_t quantity = 0;
+            for (const RestingOrder& order : level.second) quantity += order.quantity;
+            out.push_back({level.first, static_cast<uint32_t>(level.second.size()), quantity});
+        };
+        if (side == Side::BUY) {
+            for (auto it = book->second.bids.rbegin(); it != book->second.bids.rend(); ++it) append(*it);
+        } else {
+            for (const auto& level : book->second.asks) append(level);
+        }
+        return out;
+    }
+
+    [[nodiscard]] const std::string& error() const {
+        return error_;
+    }
+
+private:
+    struct RestingOrder {
+        uint64_t order_id;
+        uint64_t quantity;
+    };
+
+    using Queue = std::list<RestingOrder>;
+
+    struct Location {
+        Side side;
+        int price;
+        Queue::iterator order;
+    };
+
+    struct Book {
+        std::map<int, Queue> bids;
+        std::map<int, Queue> asks;
+        std::unordered_map<uint64_t, Location> orders;
+
+        std::map<int, Queue>& levels(Side side) {
+            return side == Side::BUY ? bids : asks;
+        }
+    };
+
+    bool fail(const char* what, const L3Event& event) {
+        error_ = std::string(what) + " at sequence " + std::to_string(event.sequence) +
+                 ", order " + std::to_string(event.order_id);
+        return false;
+    }
+
+    std::unordered_map<SymbolId, Book> books_;
+    std::unordered_map<SymbolId, uint64_t> last_sequence_;
+    std::string error_;
+};
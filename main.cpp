@@ -1,115 +1,361 @@
 #include "./EngineConcept/MatchingEngineConcept.h"
 #include "EnginImpl/V4/MatchingEngineV4.h"
 #include "EnginImpl/V3/MatchingEngineV3.h"
+#include "EnginImpl/V5/MatchingEngineV5.h"
+#include "Benchmarks/WorkloadGenerator.h"
+#include "Benchmarks/BenchmarkResults.h"
+#include "Benchmarks/PerfCounters.h"
 #include <chrono>
 #include <random>
 #include <iomanip>
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <type_traits>
 
-struct BenchmarkMetrics {
-    double avg_latency_ns;
-    double p50_latency_ns;
-    double p95_latency_ns;
-    double p99_latency_ns;
-    double p999_latency_ns;
-    double max_latency_ns;
-    double throughput_ops_per_sec;
-    size_t total_orders;
-    const char* engine_name;
-
-    void print(const std::string& test_name) const {
-        std::cout << "\n╔════════════════════════════════════════════════════════════╗\n";
-        std::cout << "║ " << std::left << std::setw(56) << test_name << " ║\n";
-        std::cout << "║ Engine: " << std::left << std::setw(49) << engine_name << " ║\n";
-        std::cout << "╠════════════════════════════════════════════════════════════╣\n";
-        std::cout << std::fixed << std::setprecision(2);
-        std::cout << "║ Total Orders:    " << std::setw(38) << total_orders << " ║\n";
-        std::cout << "╟────────────────────────────────────────────────────────────╢\n";
-        std::cout << "║ LATENCY (nanoseconds)                                      ║\n";
-        std::cout << "║   Average:       " << std::setw(38) << avg_latency_ns << " ns ║\n";
-        std::cout << "║   P50 (median):  " << std::setw(38) << p50_latency_ns << " ns ║\n";
-        std::cout << "║   P95:           " << std::setw(38) << p95_latency_ns << " ns ║\n";
-        std::cout << "║   P99:           " << std::setw(38) << p99_latency_ns << " ns ║\n";
-        std::cout << "║   P99.9:         " << std::setw(38) << p999_latency_ns << " ns ║\n";
-        std::cout << "║   Max:           " << std::setw(38) << max_latency_ns << " ns ║\n";
-        std::cout << "╟────────────────────────────────────────────────────────────╢\n";
-        std::cout << "║ THROUGHPUT                                                 ║\n";
-        std::cout << "║   " << std::setw(54) << throughput_ops_per_sec << " ops/sec ║\n";
-        std::cout << "╚════════════════════════════════════════════════════════════╝\n";
+// OrderLayout: Order (unique_ptr или по значению) либо компактный OrderRecord.
+// Команды сгенерированы заранее: в замер попадает только движок
+template<MatchingEngineConcept Engine, typename OrderLayout = Order>
+BenchmarkMetrics runBenchmark(const Workload& workload, const WorkloadConfig& config) {
+    const uint64_t rss_before = residentBytes();
+    Engine engine;
+    registerWorkloadSymbols(engine, workload);
+    const size_t num_orders = workload.commands.size();
+    LatencyRecorder latency;
+    PerfCounters& counters = threadPerfCounters();
+
+    const double cpu_before = cpuSeconds();
+    counters.start();
+    auto start_total = std::chrono::steady_clock::now();
+
+    for (const IngressMessage& command : workload.commands) {
+        if (command.kind != IngressMessage::Kind::NEW_ORDER) {
+            latency.measure([&] { applyCommand(engine, command.kind, command.order); });
+        } else if constexpr (std::is_same_v<OrderLayout, OrderRecord>) {
+            latency.measure([&] { engine.submitOrder(command.order); });
+        } else if constexpr (requires(const Order& value) { engine.submitOrder(value); }) {
+            // Движок с пулом ордеров: без make_unique на каждый ордер
+            Order order(command.order);
+
+            latency.measure([&] { engine.submitOrder(order); });
+        } else {
+            auto order = std::make_unique<Order>(command.order);
+
+            latency.measure([&] { engine.submitOrder(std::move(order)); });
+        }
+    }
+
+    auto end_total = std::chrono::steady_clock::now();
+    const PerfReading reading = counters.stop();
+    double total_time_sec = std::chrono::duration<double>(end_total - start_total).count();
+    const double cpu_time_sec = cpuSeconds() - cpu_before;
+
+    BenchmarkMetrics metrics;
+    metrics.benchmark = std::string("baseline/") + config.name + "/" +
+                        (std::is_same_v<OrderLayout, OrderRecord> ? "OrderRecord" : "Order") + "/" +
+                        std::to_string(num_orders);
+    metrics.total_orders = num_orders;
+    metrics.engine_name = engine.name();
+    metrics.setWorkload(config);
+    metrics.setLatency(latency);
+    metrics.throughput_ops_per_sec = num_orders / total_time_sec;
+    const uint64_t rss_after = residentBytes();
+    metrics.rss_growth_bytes = rss_after - std::min(rss_after, rss_before);
+    metrics.cpu_seconds = cpu_time_sec;
+    metrics.counters = reading.perOperation(num_orders);  // вместе с замерами TSC
+
+    if constexpr (requires { engine.poolStats(); }) {
+        auto pool = engine.poolStats();
+        std::cout << engine.name() << " order pool: capacity " << pool.capacity
+                  << ", in use " << pool.in_use
+                  << ", high-water mark " << pool.high_water_mark
+                  << ", slabs " << pool.slabs << "\n";
+    }
+
+    return metrics;
+}
+
+// ============================================================================
+// TRADE SINK: std::function callback vs inlined sink policy vs batched span
+// ============================================================================
+
+// Обработчик известен на этапе компиляции: onTrade инлайнится в цикл матчинга
+struct VolumeTradeSink {
+    uint64_t trades = 0;
+    uint64_t volume = 0;
+
+    void onTrade(const Trade& trade) {
+        ++trades;
+        volume += trade.quantity;
     }
 };
 
-template<MatchingEngineConcept Engine>
-BenchmarkMetrics runBenchmark(size_t num_orders) {
-    Engine engine;
-    std::vector<double> latencies_ns;
-    latencies_ns.reserve(num_orders);
+// Лимитные ордера не пересекают спред и копят глубину мелкими заявками,
+// каждый рыночный ордер проходит по ней и дает порядка десятка сделок
+template<typename Engine>
+double runSweepWorkload(Engine& engine, size_t num_orders) {
+    const SymbolId symbol_id = engine.registerSymbol("TEST");
 
-    std::mt19937 rng(42);
-    std::uniform_int_distribution<int> price_dist(9998, 10003);
-    std::uniform_int_distribution<uint64_t> qty_dist(1, 100);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> offset_dist(0, 9);
+    std::uniform_int_distribution<uint64_t> limit_qty_dist(1, 10);
+    std::uniform_int_distribution<uint64_t> market_qty_dist(20, 80);
     std::uniform_int_distribution<int> side_dist(0, 1);
     std::uniform_int_distribution<int> type_dist(0, 9);
 
-    auto start_total = std::chrono::high_resolution_clock::now();
-
+    // Генерируем заранее, чтобы не мерить RNG
+    std::vector<OrderRecord> orders;
+    orders.reserve(num_orders);
     for (size_t i = 0; i < num_orders; ++i) {
         Side side = side_dist(rng) == 0 ? Side::BUY : Side::SELL;
-        OrderType type = type_dist(rng) < 9 ? OrderType::LIMIT : OrderType::MARKET;
-        int price = type == OrderType::LIMIT ? price_dist(rng) : 0;
-        uint64_t qty = qty_dist(rng);
+        if (type_dist(rng) < 9) {
+            int price = side == Side::BUY ? 9999 - offset_dist(rng) : 10001 + offset_dist(rng);
+            orders.push_back(makeOrderRecord(i, symbol_id, side, OrderType::LIMIT,
+                                             price, limit_qty_dist(rng), 0));
+        } else {
+            orders.push_back(makeOrderRecord(i, symbol_id, side, OrderType::MARKET,
+                                             0, market_qty_dist(rng), 0));
+        }
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const OrderRecord& order : orders) {
+        engine.submitOrder(order);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    return num_orders / std::chrono::duration<double>(end - start).count();
+}
+
+template<template<TradeSink> class BasicEngine>
+void compareTradeSinks(size_t num_orders) {
+    BasicEngine<CallbackTradeSink> callback_engine;
+    uint64_t callback_trades = 0;
+    uint64_t callback_volume = 0;
+    callback_engine.setTradeCallback([&](const Trade& trade) {
+        ++callback_trades;
+        callback_volume += trade.quantity;
+    });
+    double callback_ops = runSweepWorkload(callback_engine, num_orders);
+
+    BasicEngine<VolumeTradeSink> inline_engine;
+    double inline_ops = runSweepWorkload(inline_engine, num_orders);
+    const VolumeTradeSink& sink = inline_engine.tradeSink();
 
-        auto order = std::make_unique<Order>(i, "TEST", side, type, price, qty, 0);
+    // Пачка сделок на каждый ордер: потребитель обходит непрерывный span
+    BufferedTradeSink buffered_sink;
+    uint64_t buffered_volume = 0;
+    buffered_sink.setBatchCallback([&](std::span<const Trade> batch) {
+        for (const Trade& trade : batch) buffered_volume += trade.quantity;
+    });
+    BasicEngine<BufferedTradeSink> buffered_engine(std::move(buffered_sink));
+    double buffered_ops = runSweepWorkload(buffered_engine, num_orders);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "\nTrade sink - " << inline_engine.name() << " (" << num_orders << " orders, "
+              << sink.trades << " trades)\n";
+    std::cout << "  std::function callback: " << std::setw(14) << callback_ops << " ops/sec\n";
+    std::cout << "  inlined TradeSink:      " << std::setw(14) << inline_ops << " ops/sec ("
+              << inline_ops / callback_ops << "x)\n";
+    std::cout << "  BufferedTradeSink span: " << std::setw(14) << buffered_ops << " ops/sec ("
+              << buffered_ops / callback_ops << "x)\n";
+    if (callback_trades != sink.trades || callback_volume != sink.volume ||
+        buffered_volume != sink.volume) {
+        std::cout << "  MISMATCH: sinks observed different trade streams\n";
+    }
+}
+
+// Пропускная способность одного движка на разных смесях команд
+template<MatchingEngineConcept Engine>
+void compareWorkloads(size_t num_commands) {
+    struct Mix {
+        const char* label;
+        WorkloadConfig config;
+    };
+    Mix mixes[] = {
+            {"default", WorkloadConfig{}},
+            {"sweep-heavy", WorkloadConfig::sweepHeavy()},
+            {"cancel-heavy", WorkloadConfig::cancelHeavy()},
+    };
+
+    std::cout << "\nWorkload mix - " << Engine::name() << " (" << num_commands << " commands)\n";
+    for (Mix& mix : mixes) {
+        mix.config.num_commands = num_commands;
+        const Workload workload = generateWorkload(mix.config);
+        Engine engine;
+        registerWorkloadSymbols(engine, workload);
 
         auto start = std::chrono::high_resolution_clock::now();
-        engine.submitOrder(std::move(order));
+        for (const IngressMessage& command : workload.commands) {
+            applyCommand(engine, command.kind, command.order);
+        }
         auto end = std::chrono::high_resolution_clock::now();
 
-        double latency_ns = std::chrono::duration<double, std::nano>(end - start).count();
-        latencies_ns.push_back(latency_ns);
+        std::cout << "  " << std::left << std::setw(14) << mix.label << std::right << std::fixed
+                  << std::setprecision(0) << std::setw(14)
+                  << num_commands / std::chrono::duration<double>(end - start).count() << " ops/sec"
+                  << "  new " << workload.new_orders << ", aggressive " << workload.aggressive_orders
+                  << ", cancels " << workload.cancels << ", modifies " << workload.modifies
+                  << ", resting at end " << engine.getBuyOrderCount() + engine.getSellOrderCount() << "\n";
     }
+}
 
-    auto end_total = std::chrono::high_resolution_clock::now();
-    double total_time_sec = std::chrono::duration<double>(end_total - start_total).count();
+// Аппаратные счетчики на команду по фазам: наполнение книги (первые 20%
+// потока, растут уровни и пулы) и установившийся матчинг. Без замера каждой
+// операции, чтобы в счетчики не попадал rdtsc
+template<MatchingEngineConcept Engine>
+void compareCounters(const Workload& workload) {
+    PerfCounters& counters = threadPerfCounters();
+    std::cout << "\nHardware counters - " << Engine::name() << " (per command)\n";
+    if (!counters.available()) {
+        std::cout << "  unavailable: " << counters.error() << "\n";
+        return;
+    }
 
-    std::sort(latencies_ns.begin(), latencies_ns.end());
+    Engine engine;
+    registerWorkloadSymbols(engine, workload);
+    const size_t build_end = workload.commands.size() / 5;
+    PerfPhases phases;
+    std::vector<double> phase_ns;
+    auto run = [&](const char* phase, size_t begin, size_t end) {
+        counters.start();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = begin; i < end; ++i) {
+            applyCommand(engine, workload.commands[i].kind, workload.commands[i].order);
+        }
+        auto stop = std::chrono::steady_clock::now();
+        phases.add(phase, counters.stop(), end - begin);
+        phase_ns.push_back(std::chrono::duration<double, std::nano>(stop - start).count());
+    };
+    run("build", 0, build_end);
+    run("steady", build_end, workload.commands.size());
 
-    BenchmarkMetrics metrics;
-    metrics.total_orders = num_orders;
-    metrics.engine_name = engine.name();
+    std::cout << "  " << std::left << std::setw(8) << "phase" << std::right << std::setw(10) << "ns";
+    for (size_t e = 0; e < PerfReading::EVENT_COUNT; ++e) {
+        std::cout << std::setw(15) << PerfReading::name(static_cast<PerfReading::Event>(e));
+    }
+    std::cout << std::setw(8) << "IPC" << "\n";
+    for (size_t p = 0; p < phases.phases().size(); ++p) {
+        const PerfPhases::Phase& phase = phases.phases()[p];
+        const double ops = static_cast<double>(phase.operations);
+        std::cout << "  " << std::left << std::setw(8) << phase.name << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(10) << phase_ns[p] / ops << std::setprecision(3);
+        for (size_t e = 0; e < PerfReading::EVENT_COUNT; ++e) {
+            if (phase.reading.present[e]) {
+                std::cout << std::setw(15) << phase.reading.values[e] / ops;
+            } else {
+                std::cout << std::setw(15) << "n/a";
+            }
+        }
+        const PerfReading& r = phase.reading;
+        if (r.has(PerfReading::CYCLES) && r.has(PerfReading::INSTRUCTIONS) && r.values[PerfReading::CYCLES] > 0) {
+            std::cout << std::setprecision(2) << std::setw(8)
+                      << r.values[PerfReading::INSTRUCTIONS] / r.values[PerfReading::CYCLES];
+        } else {
+            std::cout << std::setw(8) << "n/a";
+        }
+        std::cout << "\n";
+    }
+    if (!counters.error().empty()) std::cout << "  (" << counters.error() << ")\n";
+}
 
-    double sum = 0;
-    for (double lat : latencies_ns) sum += lat;
-    metrics.avg_latency_ns = sum / latencies_ns.size();
+// Стоимость политики EngineStats: тот же поток команд без статистики и со
+// статистикой, прогоны чередуются, берется лучший из трех
+template<MatchingEngineConcept Engine>
+void compareEngineStats(const Workload& workload) {
+    using StatsEngine = RebindEngineStatsT<Engine, EngineStats>;
+    auto run = [&](auto& engine) {
+        registerWorkloadSymbols(engine, workload);
+        auto start = std::chrono::steady_clock::now();
+        for (const IngressMessage& command : workload.commands) {
+            applyCommand(engine, command.kind, command.order);
+        }
+        auto end = std::chrono::steady_clock::now();
+        return workload.commands.size() / std::chrono::duration<double>(end - start).count();
+    };
 
-    metrics.p50_latency_ns = latencies_ns[latencies_ns.size() / 2];
-    metrics.p95_latency_ns = latencies_ns[latencies_ns.size() * 95 / 100];
-    metrics.p99_latency_ns = latencies_ns[latencies_ns.size() * 99 / 100];
-    metrics.p999_latency_ns = latencies_ns[latencies_ns.size() * 999 / 1000];
-    metrics.max_latency_ns = latencies_ns.back();
-    metrics.throughput_ops_per_sec = num_orders / total_time_sec;
+    double plain_ops = 0;
+    double stats_ops = 0;
+    EngineStatsSnapshot stats{};
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        Engine plain;
+        plain_ops = std::max(plain_ops, run(plain));
+        StatsEngine counted;
+        stats_ops = std::max(stats_ops, run(counted));
+        counted.publishStats();
+        stats = counted.getStats();
+    }
 
-    return metrics;
+    std::cout << "\nEngine stats - " << Engine::name() << " (" << workload.commands.size() << " commands)\n"
+              << std::fixed << std::setprecision(0)
+              << "  NoEngineStats: " << std::setw(14) << plain_ops << " ops/sec\n"
+              << "  EngineStats:   " << std::setw(14) << stats_ops << " ops/sec (" << std::showpos
+              << std::setprecision(1) << (stats_ops / plain_ops - 1) * 100 << "%)" << std::noshowpos << "\n"
+              << "  orders " << stats.orders << ", cancels " << stats.cancels << ", modifies " << stats.modifies
+              << ", aggressive " << stats.aggressive_orders << std::setprecision(2) << ", fills/aggressive "
+              << stats.fillsPerAggressiveOrder() << ", avg sweep depth " << stats.averageSweepDepth()
+              << ", max sweep depth " << stats.max_sweep_depth << "\n"
+              << "  levels " << stats.price_levels << ", max level queue " << stats.max_level_queue
+              << ", level resizes " << stats.level_resizes << "\n";
 }
 
-int main() {
+// Аргументы - файлы отчета: out.json и/или out.csv (см. Benchmarks/BenchmarkResults.h)
+int main(int argc, char** argv) {
     const size_t NUM_ORDERS = 5'000'000;
 
     std::cout << "Starting baseline performance test...\n";
-    std::cout << "Testing with " << NUM_ORDERS << " orders\n\n";
+    std::cout << "Testing with " << NUM_ORDERS << " commands\n\n";
 
-    auto metrics1 = runBenchmark<MatchingEngineV4>(NUM_ORDERS);
+    WorkloadConfig config;
+    config.num_commands = NUM_ORDERS;
+    const Workload workload = generateWorkload(config);
+    BenchmarkReport report;
+
+    auto metrics1 = runBenchmark<MatchingEngineV4>(workload, config);
     metrics1.print("BASELINE - MatchingEngineV4");
-    auto metrics2 = runBenchmark<MatchingEngineV3>(NUM_ORDERS);
+    report.add(metrics1);
+    auto metrics2 = runBenchmark<MatchingEngineV3>(workload, config);
     metrics2.print("BASELINE - MatchingEngineV3");
-    auto metrics3 = runBenchmark<MatchingEngineV4>(NUM_ORDERS);
+    report.add(metrics2);
+    auto metrics3 = runBenchmark<MatchingEngineV4>(workload, config);
     metrics3.print("BASELINE - MatchingEngineV4");
-    auto metrics4 = runBenchmark<MatchingEngineV3>(NUM_ORDERS);
+    report.add(metrics3);
+    auto metrics4 = runBenchmark<MatchingEngineV3>(workload, config);
     metrics4.print("BASELINE - MatchingEngineV3");
+    report.add(metrics4);
+    auto metrics5 = runBenchmark<MatchingEngineV5>(workload, config);
+    metrics5.print("BASELINE - MatchingEngineV5");
+    report.add(metrics5);
+
+    auto metrics6 = runBenchmark<MatchingEngineV3, OrderRecord>(workload, config);
+    metrics6.print("BASELINE - MatchingEngineV3 (OrderRecord)");
+    report.add(metrics6);
+    auto metrics7 = runBenchmark<MatchingEngineV4, OrderRecord>(workload, config);
+    metrics7.print("BASELINE - MatchingEngineV4 (OrderRecord)");
+    report.add(metrics7);
+
+    compareTradeSinks<BasicMatchingEngineV4>(NUM_ORDERS);
+    compareTradeSinks<BasicMatchingEngineV5>(NUM_ORDERS);
+
+    compareWorkloads<MatchingEngineV4>(NUM_ORDERS);
+    compareWorkloads<MatchingEngineV5>(NUM_ORDERS);
+
+    compareCounters<MatchingEngineV3>(workload);
+    compareCounters<MatchingEngineV4>(workload);
+    compareCounters<MatchingEngineV5>(workload);
+
+    compareEngineStats<MatchingEngineV4>(workload);
+    compareEngineStats<MatchingEngineV5>(workload);
+
+    for (int i = 1; i < argc; ++i) {
+        if (report.write(argv[i])) {
+            std::cout << "\nResults written to " << argv[i] << "\n";
+        } else {
+            std::cerr << "\nCannot write results to " << argv[i] << "\n";
+        }
+    }
 
     std::cout << "\n📝 Baseline complete.\n";
 
     return 0;
-}
\ No newline at end of file
+}